@@ -0,0 +1,1216 @@
+/*
+ * Geoclue
+ * gc-http.c - Main loop driven HTTP client used by GcWebService
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * A minimal HTTP GET client that never blocks on the socket: connecting,
+ * sending the request and reading the response are all driven by
+ * GIOChannel watches attached to a GMainContext. Any number of requests
+ * can be in flight at the same time.
+ *
+ * Requests are sent as HTTP/1.1. When the server keeps the connection
+ * open, the socket is parked in a per-process pool keyed by host:port
+ * and handed to the next request for the same server. Idle sockets are
+ * closed after GC_HTTP_POOL_IDLE_TIMEOUT or as soon as the server
+ * closes them, and at most GC_HTTP_POOL_MAX_CONNECTIONS sockets are kept
+ * open: when the limit is reached the oldest idle socket is evicted, and
+ * a socket released while the pool is still over the limit is closed.
+ * Requests may run in different contexts and threads, so the pool and
+ * its statistics are guarded by pool_lock.
+ *
+ * Responses may be gzip or deflate encoded; they are inflated as they
+ * arrive, so callers only ever see the decoded body.
+ *
+ * Host names are looked up with GResolver, whose answer is delivered
+ * to the request's context like any other event.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <zlib.h>
+
+#include "gc-http.h"
+#include "geoclue-error.h"
+
+#define GC_HTTP_DEFAULT_PORT 80
+#define GC_HTTP_READ_SIZE 4096
+#define GC_HTTP_MAX_REDIRECTS 5
+
+/* Largest response body accepted, and the most that is allocated up
+ * front on the strength of a Content-Length header */
+#define GC_HTTP_MAX_RESPONSE_SIZE (4 * 1024 * 1024)
+#define GC_HTTP_MAX_PREALLOC (GC_HTTP_READ_SIZE * 16)
+
+/* Largest body accepted after gzip/deflate decoding */
+#define GC_HTTP_MAX_DECODED_SIZE (16 * 1024 * 1024)
+
+#define GC_HTTP_POOL_MAX_CONNECTIONS 8
+#define GC_HTTP_POOL_IDLE_TIMEOUT 30
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef enum {
+	GC_HTTP_ENCODING_IDENTITY,
+	GC_HTTP_ENCODING_GZIP,
+	GC_HTTP_ENCODING_DEFLATE
+} GcHttpEncoding;
+
+/* An idle keep-alive connection waiting in the pool */
+typedef struct _GcHttpConnection {
+	char *key;
+	int fd;
+	GSource *watch;
+	GSource *timeout;
+} GcHttpConnection;
+
+typedef struct _GcHttpLookup GcHttpLookup;
+
+typedef struct _GcHttpRequest {
+	char *url;
+	char *host;
+	int port;
+	char *path;
+	int redirects;
+
+	GMainContext *context;
+	GcHttpCallback callback;
+	gpointer user_data;
+
+	GcHttpLookup *lookup;
+	int fd;
+	gboolean reused;
+	gboolean retried;
+	gboolean no_pool;       /* connect afresh on the next start */
+	GSource *source;
+	GSource *deadline;
+
+	GString *out;
+	gsize out_pos;
+	GString *in;
+
+	/* response framing, valid once header_len > 0 */
+	gsize header_len;
+	int status;
+	gboolean keep_alive;
+	gssize content_length;
+	gboolean chunked;
+	gsize chunk_scan;
+	gsize body_len;
+
+	/* content decoding */
+	GcHttpEncoding encoding;
+	z_stream *zstream;
+	gsize inflated;         /* body bytes fed to zstream so far */
+	gboolean stream_end;    /* zstream has seen the end of the data */
+	GString *decoded;
+} GcHttpRequest;
+
+/* A host name lookup in progress. It outlives its request when that
+ * is closed before the resolver answers, in which case req is NULL */
+struct _GcHttpLookup {
+	GcHttpRequest *req;
+	GCancellable *cancellable;
+};
+
+/* Idle connections, oldest first */
+static GQueue pool = G_QUEUE_INIT;
+static GcHttpPoolStats pool_stats;
+static GMutex pool_lock;
+
+static void gc_http_request_start (GcHttpRequest *req);
+
+static char *
+gc_http_pool_key (const char *host, int port)
+{
+	return g_strdup_printf ("%s:%d", host, port);
+}
+
+/* Call with pool_lock held */
+static void
+gc_http_socket_close (int fd)
+{
+	close (fd);
+	pool_stats.open_sockets--;
+}
+
+static void
+gc_http_connection_free (GcHttpConnection *conn)
+{
+	g_source_destroy (conn->watch);
+	g_source_unref (conn->watch);
+	g_source_destroy (conn->timeout);
+	g_source_unref (conn->timeout);
+	g_free (conn->key);
+	g_free (conn);
+}
+
+/* Removes @conn from the pool and closes the socket.
+ * Call with pool_lock held. */
+static void
+gc_http_connection_evict (GcHttpConnection *conn)
+{
+	g_queue_remove (&pool, conn);
+	gc_http_socket_close (conn->fd);
+	gc_http_connection_free (conn);
+	pool_stats.evicted++;
+}
+
+/* Evicts @conn unless another thread has taken it from the pool
+ * since its source was dispatched, in which case it is gone */
+static void
+gc_http_connection_evict_current (GcHttpConnection *conn)
+{
+	g_mutex_lock (&pool_lock);
+	if (!g_source_is_destroyed (g_main_current_source ())) {
+		gc_http_connection_evict (conn);
+	}
+	g_mutex_unlock (&pool_lock);
+}
+
+static gboolean
+gc_http_connection_expired (GcHttpConnection *conn)
+{
+	gc_http_connection_evict_current (conn);
+	return FALSE;
+}
+
+/* An idle connection should never become readable: the server
+ * either closed it or sent something we did not ask for */
+static gboolean
+gc_http_connection_readable (GIOChannel       *channel,
+                             GIOCondition      condition,
+                             GcHttpConnection *conn)
+{
+	gc_http_connection_evict_current (conn);
+	return FALSE;
+}
+
+/* Returns an idle socket connected to @key, or -1.
+ * Call with pool_lock held. */
+static int
+gc_http_pool_take (const char *key)
+{
+	GList *l;
+
+	for (l = pool.tail; l; l = l->prev) {
+		GcHttpConnection *conn = l->data;
+		int fd;
+
+		if (strcmp (conn->key, key) != 0) {
+			continue;
+		}
+		fd = conn->fd;
+		g_queue_delete_link (&pool, l);
+		gc_http_connection_free (conn);
+		return fd;
+	}
+	return -1;
+}
+
+/* Parks a connected socket for reuse, or closes it if the pool is full.
+ * The idle socket is watched from @context, the one the request ran
+ * in, so that it is evicted on the same thread that would reuse it. */
+static void
+gc_http_pool_release (const char *key, int fd, GMainContext *context)
+{
+	GcHttpConnection *conn;
+	GIOChannel *channel;
+
+	g_mutex_lock (&pool_lock);
+	if (pool_stats.open_sockets > GC_HTTP_POOL_MAX_CONNECTIONS) {
+		gc_http_socket_close (fd);
+		g_mutex_unlock (&pool_lock);
+		return;
+	}
+
+	conn = g_new0 (GcHttpConnection, 1);
+	conn->key = g_strdup (key);
+	conn->fd = fd;
+
+	channel = g_io_channel_unix_new (fd);
+	conn->watch = g_io_create_watch (channel, G_IO_IN | G_IO_ERR | G_IO_HUP);
+	g_io_channel_unref (channel);
+	g_source_set_callback (conn->watch,
+	                       (GSourceFunc) gc_http_connection_readable, conn, NULL);
+	g_source_attach (conn->watch, context);
+
+	conn->timeout = g_timeout_source_new (GC_HTTP_POOL_IDLE_TIMEOUT * 1000);
+	g_source_set_callback (conn->timeout,
+	                       (GSourceFunc) gc_http_connection_expired, conn, NULL);
+	g_source_attach (conn->timeout, context);
+
+	g_queue_push_tail (&pool, conn);
+	g_mutex_unlock (&pool_lock);
+}
+
+static gboolean
+gc_http_parse_url (const char  *url,
+                   char       **host,
+                   int         *port,
+                   char       **path)
+{
+	const char *start, *end, *colon;
+
+	if (!g_str_has_prefix (url, "http://")) {
+		return FALSE;
+	}
+	start = url + strlen ("http://");
+	end = strchr (start, '/');
+	if (!end) {
+		end = start + strlen (start);
+	}
+	colon = memchr (start, ':', end - start);
+	if (colon) {
+		*host = g_strndup (start, colon - start);
+		*port = atoi (colon + 1);
+	} else {
+		*host = g_strndup (start, end - start);
+		*port = GC_HTTP_DEFAULT_PORT;
+	}
+	*path = g_strdup (*end ? end : "/");
+
+	if (**host == '\0' || *port <= 0) {
+		g_free (*host);
+		g_free (*path);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Returns a newly allocated value of header @name, or NULL */
+static char *
+gc_http_get_header (const char *headers, const char *name)
+{
+	char **lines;
+	char *value = NULL;
+	gsize len = strlen (name);
+	int i;
+
+	lines = g_strsplit (headers, "\r\n", 0);
+	for (i = 0; lines[i] && !value; i++) {
+		if (g_ascii_strncasecmp (lines[i], name, len) == 0 &&
+		    lines[i][len] == ':') {
+			value = g_strstrip (g_strdup (lines[i] + len + 1));
+		}
+	}
+	g_strfreev (lines);
+	return value;
+}
+
+/* Closes the socket, or returns it to the pool if @keep is set */
+static void
+gc_http_request_close (GcHttpRequest *req, gboolean keep)
+{
+	if (req->lookup) {
+		GCancellable *cancellable = g_object_ref (req->lookup->cancellable);
+
+		/* detach first: the resolver may answer from within cancel */
+		req->lookup->req = NULL;
+		req->lookup = NULL;
+		g_cancellable_cancel (cancellable);
+		g_object_unref (cancellable);
+	}
+	if (req->source) {
+		g_source_destroy (req->source);
+		g_source_unref (req->source);
+		req->source = NULL;
+	}
+	if (req->fd >= 0) {
+		if (keep) {
+			char *key = gc_http_pool_key (req->host, req->port);
+			gc_http_pool_release (key, req->fd, req->context);
+			g_free (key);
+		} else {
+			g_mutex_lock (&pool_lock);
+			gc_http_socket_close (req->fd);
+			g_mutex_unlock (&pool_lock);
+		}
+		req->fd = -1;
+	}
+	if (req->out) {
+		g_string_free (req->out, TRUE);
+		req->out = NULL;
+	}
+	if (req->in) {
+		g_string_free (req->in, TRUE);
+		req->in = NULL;
+	}
+	if (req->zstream) {
+		inflateEnd (req->zstream);
+		g_free (req->zstream);
+		req->zstream = NULL;
+	}
+	if (req->decoded) {
+		g_string_free (req->decoded, TRUE);
+		req->decoded = NULL;
+	}
+	req->out_pos = 0;
+	req->header_len = 0;
+}
+
+static void
+gc_http_request_free (GcHttpRequest *req)
+{
+	gc_http_request_close (req, FALSE);
+
+	if (req->deadline) {
+		g_source_destroy (req->deadline);
+		g_source_unref (req->deadline);
+	}
+	if (req->context) {
+		g_main_context_unref (req->context);
+	}
+	g_free (req->url);
+	g_free (req->host);
+	g_free (req->path);
+	g_free (req);
+}
+
+/* Hands the result to the callback and frees the request.
+ * Takes ownership of @body and @error. */
+static void
+gc_http_request_finish (GcHttpRequest *req,
+                        GBytes        *body,
+                        GError        *error)
+{
+	req->callback (body, error, req->user_data);
+
+	if (error) {
+		g_error_free (error);
+	}
+	gc_http_request_free (req);
+}
+
+static void
+gc_http_request_fail (GcHttpRequest *req, GError *error)
+{
+	gc_http_request_finish (req, NULL, error);
+}
+
+static void
+gc_http_request_watch (GcHttpRequest *req,
+                       GIOCondition   condition,
+                       GIOFunc        func)
+{
+	GIOChannel *channel;
+
+	if (req->source) {
+		g_source_destroy (req->source);
+		g_source_unref (req->source);
+	}
+
+	channel = g_io_channel_unix_new (req->fd);
+	req->source = g_io_create_watch (channel, condition | G_IO_ERR | G_IO_HUP);
+	g_io_channel_unref (channel);
+
+	g_source_set_callback (req->source, (GSourceFunc) func, req, NULL);
+	g_source_attach (req->source, req->context);
+}
+
+/* Parses status line and headers once they are all in req->in.
+ * Returns FALSE and sets @error if the response is malformed or
+ * larger than we are willing to read. */
+static gboolean
+gc_http_request_parse_headers (GcHttpRequest *req, GError **error)
+{
+	char *headers_end, *value;
+	int major, minor;
+
+	headers_end = strstr (req->in->str, "\r\n\r\n");
+	if (!headers_end) {
+		return TRUE;
+	}
+	if (sscanf (req->in->str, "HTTP/%d.%d %d",
+	            &major, &minor, &req->status) != 3) {
+		g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "Malformed HTTP response from %s", req->url);
+		return FALSE;
+	}
+	req->header_len = headers_end - req->in->str + 4;
+
+	/* interim responses are followed by the real one on the same
+	 * connection: drop them and parse whatever comes next */
+	if (req->status >= 100 && req->status < 200 && req->status != 101) {
+		g_string_erase (req->in, 0, req->header_len);
+		req->header_len = 0;
+		return gc_http_request_parse_headers (req, error);
+	}
+
+	/* terminate the headers temporarily for gc_http_get_header () */
+	*headers_end = '\0';
+
+	req->keep_alive = (major > 1 || (major == 1 && minor >= 1));
+	value = gc_http_get_header (req->in->str, "Connection");
+	if (value) {
+		if (g_ascii_strcasecmp (value, "close") == 0) {
+			req->keep_alive = FALSE;
+		} else if (g_ascii_strcasecmp (value, "keep-alive") == 0) {
+			req->keep_alive = TRUE;
+		}
+		g_free (value);
+	}
+
+	req->content_length = -1;
+	req->chunked = FALSE;
+	value = gc_http_get_header (req->in->str, "Transfer-Encoding");
+	if (value) {
+		req->chunked = (g_ascii_strcasecmp (value, "chunked") == 0);
+		g_free (value);
+	}
+	if (!req->chunked) {
+		value = gc_http_get_header (req->in->str, "Content-Length");
+		if (value) {
+			req->content_length = g_ascii_strtoll (value, NULL, 10);
+			g_free (value);
+		}
+	}
+	req->encoding = GC_HTTP_ENCODING_IDENTITY;
+	req->inflated = 0;
+	req->stream_end = FALSE;
+	value = gc_http_get_header (req->in->str, "Content-Encoding");
+	if (value) {
+		if (g_ascii_strcasecmp (value, "gzip") == 0 ||
+		    g_ascii_strcasecmp (value, "x-gzip") == 0) {
+			req->encoding = GC_HTTP_ENCODING_GZIP;
+		} else if (g_ascii_strcasecmp (value, "deflate") == 0) {
+			req->encoding = GC_HTTP_ENCODING_DEFLATE;
+		}
+		g_free (value);
+	}
+	if (req->encoding != GC_HTTP_ENCODING_IDENTITY) {
+		/* XML usually compresses to a fifth or less */
+		req->decoded = g_string_sized_new (req->content_length > 0 ?
+		                                   MIN (req->content_length * 5,
+		                                        GC_HTTP_MAX_PREALLOC) :
+		                                   GC_HTTP_READ_SIZE * 4);
+	}
+
+	if (req->status == 204 || req->status == 304 ||
+	    (req->status >= 100 && req->status < 200)) {
+		req->content_length = 0;
+	}
+
+	*headers_end = '\r';
+
+	if (req->content_length > GC_HTTP_MAX_RESPONSE_SIZE) {
+		g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "Response from %s is too large (%" G_GINT64_FORMAT " bytes)",
+		             req->url, (gint64) req->content_length);
+		return FALSE;
+	}
+
+	/* without framing the body ends when the server closes */
+	if (req->content_length < 0 && !req->chunked) {
+		req->keep_alive = FALSE;
+	}
+
+	req->chunk_scan = req->header_len;
+	req->body_len = 0;
+
+	/* allocate the response at once instead of growing the buffer
+	 * read by read, but don't trust the header with more than
+	 * GC_HTTP_MAX_PREALLOC */
+	if (req->content_length > 0) {
+		gsize len = req->in->len;
+
+		g_string_set_size (req->in, req->header_len +
+		                   MIN (req->content_length, GC_HTTP_MAX_PREALLOC));
+		g_string_set_size (req->in, len);
+	}
+	return TRUE;
+}
+
+/* Decodes the complete chunks received so far in place, so that the
+ * decoded body always starts right after the headers. Returns TRUE
+ * once the last chunk and trailer have arrived. */
+static gboolean
+gc_http_request_dechunk (GcHttpRequest *req, gboolean *error)
+{
+	char *buf = req->in->str;
+	gsize len = req->in->len;
+
+	while (req->chunk_scan < len) {
+		char *line_end, *end;
+		guint64 size;
+		gsize data_start;
+
+		line_end = g_strstr_len (buf + req->chunk_scan,
+		                         len - req->chunk_scan, "\r\n");
+		if (!line_end) {
+			return FALSE;
+		}
+		size = g_ascii_strtoull (buf + req->chunk_scan, &end, 16);
+		if (end == buf + req->chunk_scan) {
+			*error = TRUE;
+			return FALSE;
+		}
+		data_start = line_end - buf + 2;
+
+		if (size == 0) {
+			/* skip trailer headers up to the empty line */
+			char *trailer_end;
+
+			if (len - data_start >= 2 &&
+			    buf[data_start] == '\r' && buf[data_start + 1] == '\n') {
+				return TRUE;
+			}
+			trailer_end = g_strstr_len (buf + data_start,
+			                            len - data_start, "\r\n\r\n");
+			return trailer_end != NULL;
+		}
+
+		if (len - data_start < size + 2) {
+			return FALSE;
+		}
+		memmove (buf + req->header_len + req->body_len,
+		         buf + data_start, size);
+		req->body_len += size;
+		req->chunk_scan = data_start + size + 2;
+	}
+	return FALSE;
+}
+
+/* Inflates the body bytes received since the last call into 
+ * req->decoded. Returns FALSE and sets @error if the data is corrupt
+ * or inflates to more than GC_HTTP_MAX_DECODED_SIZE. */
+static gboolean
+gc_http_request_inflate (GcHttpRequest *req, GError **error)
+{
+	z_stream *z;
+	int ret;
+
+	if (req->inflated == req->body_len || req->stream_end) {
+		return TRUE;
+	}
+
+	if (!req->zstream) {
+		const guchar *data = (guchar *) req->in->str + req->header_len;
+		int window_bits;
+
+		if (req->encoding == GC_HTTP_ENCODING_GZIP) {
+			window_bits = 15 + 16;
+		} else {
+			/* "deflate" should be zlib-wrapped, but some servers
+			 * send raw deflate data: check for a zlib header */
+			if (req->body_len < 2) {
+				return TRUE;
+			}
+			if ((data[0] & 0x0f) == Z_DEFLATED &&
+			    ((data[0] << 8) | data[1]) % 31 == 0) {
+				window_bits = 15;
+			} else {
+				window_bits = -15;
+			}
+		}
+		req->zstream = g_new0 (z_stream, 1);
+		if (inflateInit2 (req->zstream, window_bits) != Z_OK) {
+			g_free (req->zstream);
+			req->zstream = NULL;
+			g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_FAILED,
+			             "Could not set up decoding of %s", req->url);
+			return FALSE;
+		}
+	}
+	z = req->zstream;
+
+	z->next_in = (Bytef *) req->in->str + req->header_len + req->inflated;
+	z->avail_in = req->body_len - req->inflated;
+	do {
+		gsize old_len = req->decoded->len;
+		gsize space = CLAMP (z->avail_in * 4,
+		                     GC_HTTP_READ_SIZE, GC_HTTP_MAX_PREALLOC);
+
+		if (old_len >= GC_HTTP_MAX_DECODED_SIZE) {
+			g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+			             "Response from %s inflates to more than %d bytes",
+			             req->url, GC_HTTP_MAX_DECODED_SIZE);
+			return FALSE;
+		}
+		space = MIN (space, GC_HTTP_MAX_DECODED_SIZE - old_len + 1);
+
+		g_string_set_size (req->decoded, old_len + space);
+		z->next_out = (Bytef *) req->decoded->str + old_len;
+		z->avail_out = space;
+
+		ret = inflate (z, Z_NO_FLUSH);
+		g_string_set_size (req->decoded, old_len + space - z->avail_out);
+		if (ret == Z_BUF_ERROR) {
+			/* no progress possible until more input arrives */
+			break;
+		}
+		if (ret != Z_OK && ret != Z_STREAM_END) {
+			g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+			             "Corrupt compressed response from %s", req->url);
+			return FALSE;
+		}
+		/* a full output buffer may leave output pending in zlib */
+	} while (ret != Z_STREAM_END && (z->avail_in > 0 || z->avail_out == 0));
+	if (req->decoded->len > GC_HTTP_MAX_DECODED_SIZE) {
+		g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "Response from %s inflates to more than %d bytes",
+		             req->url, GC_HTTP_MAX_DECODED_SIZE);
+		return FALSE;
+	}
+	/* anything after the end of the stream is ignored */
+	req->stream_end = (ret == Z_STREAM_END);
+	req->inflated = req->body_len;
+	return TRUE;
+}
+
+/* Hands the complete response on to the callback,
+ * or restarts the request if it was redirected */
+static void
+gc_http_request_complete (GcHttpRequest *req)
+{
+	GString *buf;
+	GBytes *body;
+
+	if (req->status >= 300 && req->status < 400) {
+		char *location;
+
+		req->in->str[req->header_len - 2] = '\0';
+		location = gc_http_get_header (req->in->str, "Location");
+		if (location && req->redirects < GC_HTTP_MAX_REDIRECTS) {
+			req->redirects++;
+			gc_http_request_close (req, req->keep_alive);
+			if (location[0] == '/') {
+				g_free (req->path);
+				req->path = location;
+			} else {
+				g_free (req->url);
+				req->url = location;
+				g_free (req->host);
+				g_free (req->path);
+				req->host = req->path = NULL;
+			}
+			gc_http_request_start (req);
+			return;
+		}
+		g_free (location);
+		req->in->str[req->header_len - 2] = '\r';
+	}
+
+	if (req->status >= 500) {
+		gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+		                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+		                                        "HTTP error %d from %s",
+		                                        req->status, req->url));
+		return;
+	}
+
+	if (req->decoded) {
+		/* GString keeps the decoded body NUL-terminated */
+		buf = req->decoded;
+		req->decoded = NULL;
+		body = g_bytes_new_with_free_func (buf->str, buf->len,
+		                                   g_free, buf->str);
+	} else {
+		/* hand out a view of the receive buffer instead of a copy; 
+		 * truncating keeps the body NUL-terminated in place */
+		g_string_truncate (req->in, req->header_len + req->body_len);
+		buf = req->in;
+		req->in = NULL;
+		body = g_bytes_new_with_free_func (buf->str + req->header_len,
+		                                   req->body_len,
+		                                   g_free, buf->str);
+	}
+	g_string_free (buf, FALSE);
+	g_mutex_lock (&pool_lock);
+	pool_stats.bytes_decoded += g_bytes_get_size (body);
+	g_mutex_unlock (&pool_lock);
+
+	/* the socket is free for the next request now */
+	gc_http_request_close (req, req->keep_alive);
+
+	gc_http_request_finish (req, body, NULL);
+}
+
+/* Returns TRUE once the whole response has been read.
+ * Sets @error if the response is malformed or too large. */
+static gboolean
+gc_http_request_process (GcHttpRequest *req, GError **error)
+{
+	gboolean complete = FALSE;
+	gboolean malformed = FALSE;
+
+	if (req->header_len == 0) {
+		if (!gc_http_request_parse_headers (req, error)) {
+			return FALSE;
+		}
+		if (req->header_len == 0) {
+			return FALSE;
+		}
+	}
+
+	/* chunked and close-delimited bodies carry no length up front */
+	if (req->in->len - req->header_len > GC_HTTP_MAX_RESPONSE_SIZE) {
+		g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "Response from %s is too large", req->url);
+		return FALSE;
+	}
+
+	if (req->chunked) {
+		complete = gc_http_request_dechunk (req, &malformed);
+	} else {
+		req->body_len = req->in->len - req->header_len;
+		if (req->content_length >= 0 &&
+		    req->body_len >= (gsize) req->content_length) {
+			req->body_len = req->content_length;
+			complete = TRUE;
+		}
+	}
+
+	if (malformed) {
+		g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "Malformed HTTP response from %s", req->url);
+		return FALSE;
+	}
+	if (req->encoding != GC_HTTP_ENCODING_IDENTITY) {
+		if (!gc_http_request_inflate (req, error)) {
+			return FALSE;
+		}
+		/* a body that stops short of the end of the compressed
+		 * stream has been truncated */
+		if (complete && req->body_len > 0 && !req->stream_end) {
+			g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+			             "Truncated compressed response from %s", req->url);
+			return FALSE;
+		}
+	}
+	return complete;
+}
+
+/* Retries a request whose pooled connection turned out to be dead,
+ * on a new connection. A request is only ever retried once. */
+static gboolean
+gc_http_request_retry (GcHttpRequest *req)
+{
+	if (req->retried || !req->reused || (req->in && req->in->len > 0)) {
+		return FALSE;
+	}
+	req->retried = TRUE;
+	req->no_pool = TRUE;
+	g_debug ("Pooled connection to %s:%d was closed, reconnecting",
+	         req->host, req->port);
+	gc_http_request_close (req, FALSE);
+	gc_http_request_start (req);
+	return TRUE;
+}
+
+static gboolean
+gc_http_request_can_read (GIOChannel    *channel,
+                          GIOCondition   condition,
+                          GcHttpRequest *req)
+{
+	gssize len;
+	gsize old_len = req->in->len;
+	gsize size = GC_HTTP_READ_SIZE;
+	GError *error = NULL;
+	int read_errno;
+
+	/* don't read past the announced length, so that the buffer 
+	 * allocated for it only grows for very large responses */
+	if (req->header_len > 0 && req->content_length > 0 &&
+	    req->header_len + req->content_length > old_len) {
+		size = MIN (size, req->header_len + req->content_length - old_len);
+	}
+
+	g_string_set_size (req->in, old_len + size);
+	len = read (req->fd, req->in->str + old_len, size);
+	read_errno = errno;
+	if (len < 0) {
+		g_string_set_size (req->in, old_len);
+		if (read_errno == EAGAIN || read_errno == EINTR) {
+			return TRUE;
+		}
+		if (gc_http_request_retry (req)) {
+			return FALSE;
+		}
+		gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+		                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+		                                        "Error reading from %s: %s",
+		                                        req->host, g_strerror (read_errno)));
+		return FALSE;
+	}
+	g_string_set_size (req->in, old_len + len);
+	g_mutex_lock (&pool_lock);
+	pool_stats.bytes_received += len;
+	g_mutex_unlock (&pool_lock);
+
+	if (len > 0) {
+		if (gc_http_request_process (req, &error)) {
+			gc_http_request_complete (req);
+			return FALSE;
+		}
+		if (!error) {
+			return TRUE;
+		}
+		gc_http_request_fail (req, error);
+		return FALSE;
+	} else if (gc_http_request_retry (req)) {
+		return FALSE;
+	} else if (req->header_len > 0 &&
+	           req->content_length < 0 && !req->chunked) {
+		/* connection closed by server, response is complete */
+		req->keep_alive = FALSE;
+		if (req->encoding != GC_HTTP_ENCODING_IDENTITY &&
+		    req->body_len > 0 && !req->stream_end) {
+			gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+			                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+			                                        "Truncated compressed response from %s",
+			                                        req->url));
+			return FALSE;
+		}
+		gc_http_request_complete (req);
+		return FALSE;
+	}
+
+	gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+	                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+	                                        "Malformed HTTP response from %s",
+	                                        req->url));
+	return FALSE;
+}
+
+static gboolean
+gc_http_request_can_write (GIOChannel    *channel,
+                           GIOCondition   condition,
+                           GcHttpRequest *req)
+{
+	gssize len;
+
+	if (req->out_pos == 0 && !req->reused) {
+		int sock_error = 0;
+		socklen_t sock_error_len = sizeof (sock_error);
+
+		/* first writable event: the non-blocking connect has finished */
+		if (getsockopt (req->fd, SOL_SOCKET, SO_ERROR,
+		                &sock_error, &sock_error_len) < 0) {
+			sock_error = errno;
+		}
+		if (sock_error != 0) {
+			gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+			                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+			                                        "Could not connect to %s: %s",
+			                                        req->host, g_strerror (sock_error)));
+			return FALSE;
+		}
+	}
+
+	len = send (req->fd, req->out->str + req->out_pos,
+	            req->out->len - req->out_pos, MSG_NOSIGNAL);
+	if (len < 0) {
+		int write_errno = errno;
+
+		if (write_errno == EAGAIN || write_errno == EINTR) {
+			return TRUE;
+		}
+		if (gc_http_request_retry (req)) {
+			return FALSE;
+		}
+		gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+		                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+		                                        "Error writing to %s: %s",
+		                                        req->host, g_strerror (write_errno)));
+		return FALSE;
+	}
+	req->out_pos += len;
+	if (req->out_pos < req->out->len) {
+		return TRUE;
+	}
+
+	gc_http_request_watch (req, G_IO_IN, (GIOFunc) gc_http_request_can_read);
+	return FALSE;
+}
+
+/* Connects a non-blocking socket to the first of @addresses that
+ * accepts it */
+static gboolean
+gc_http_request_connect (GcHttpRequest *req, GList *addresses, GError **error)
+{
+	GList *l;
+	int fd = -1;
+
+	/* make room by dropping the least recently used idle socket */
+	g_mutex_lock (&pool_lock);
+	if (pool_stats.open_sockets >= GC_HTTP_POOL_MAX_CONNECTIONS &&
+	    pool.head) {
+		gc_http_connection_evict (pool.head->data);
+	}
+	g_mutex_unlock (&pool_lock);
+
+	for (l = addresses; l && fd < 0; l = l->next) {
+		GSocketAddress *address;
+		struct sockaddr_storage native;
+		gssize native_len;
+
+		address = g_inet_socket_address_new (l->data, req->port);
+		native_len = g_socket_address_get_native_size (address);
+		if (native_len < 0 ||
+		    !g_socket_address_to_native (address, &native,
+		                                 sizeof (native), NULL)) {
+			g_object_unref (address);
+			continue;
+		}
+		g_object_unref (address);
+
+		fd = socket (native.ss_family, SOCK_STREAM, 0);
+		if (fd < 0) {
+			continue;
+		}
+		fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+		fcntl (fd, F_SETFD, FD_CLOEXEC);
+		if (connect (fd, (struct sockaddr *) &native, native_len) != 0 &&
+		    errno != EINPROGRESS) {
+			close (fd);
+			fd = -1;
+		}
+	}
+
+	if (fd < 0) {
+		g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "Could not connect to %s", req->host);
+		return FALSE;
+	}
+	g_mutex_lock (&pool_lock);
+	pool_stats.opened++;
+	pool_stats.open_sockets++;
+	g_mutex_unlock (&pool_lock);
+	req->fd = fd;
+	return TRUE;
+}
+
+/* Writes the request once req->fd is connected, or connecting */
+static void
+gc_http_request_send (GcHttpRequest *req)
+{
+	req->out = g_string_new (NULL);
+	g_string_append_printf (req->out, "GET %s HTTP/1.1\r\n", req->path);
+	if (req->port == GC_HTTP_DEFAULT_PORT) {
+		g_string_append_printf (req->out, "Host: %s\r\n", req->host);
+	} else {
+		g_string_append_printf (req->out, "Host: %s:%d\r\n", req->host, req->port);
+	}
+	g_string_append (req->out,
+	                 "User-Agent: geoclue/" PACKAGE_VERSION "\r\n"
+	                 "Accept-Encoding: gzip, deflate\r\n"
+	                 "\r\n");
+	req->out_pos = 0;
+	req->in = g_string_sized_new (GC_HTTP_READ_SIZE);
+	req->header_len = 0;
+
+	gc_http_request_watch (req, G_IO_OUT, (GIOFunc) gc_http_request_can_write);
+}
+
+static void
+gc_http_request_resolved (GObject      *resolver,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+	GcHttpLookup *lookup = user_data;
+	GcHttpRequest *req = lookup->req;
+	GList *addresses;
+	GError *error = NULL;
+
+	addresses = g_resolver_lookup_by_name_finish (G_RESOLVER (resolver),
+	                                              result, &error);
+	g_object_unref (lookup->cancellable);
+	g_free (lookup);
+
+	if (!req) {
+		/* the request was closed in the meantime */
+		if (addresses) {
+			g_resolver_free_addresses (addresses);
+		}
+		g_clear_error (&error);
+		return;
+	}
+	req->lookup = NULL;
+
+	if (!addresses) {
+		gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+		                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+		                                        "Could not resolve %s: %s",
+		                                        req->host, error->message));
+		g_error_free (error);
+		return;
+	}
+
+	if (!gc_http_request_connect (req, addresses, &error)) {
+		g_resolver_free_addresses (addresses);
+		gc_http_request_fail (req, error);
+		return;
+	}
+	g_resolver_free_addresses (addresses);
+
+	gc_http_request_send (req);
+}
+
+static void
+gc_http_request_start (GcHttpRequest *req)
+{
+	GResolver *resolver;
+	char *key;
+	int fd;
+
+	if (!req->host &&
+	    !gc_http_parse_url (req->url, &req->host, &req->port, &req->path)) {
+		gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+		                                        GEOCLUE_ERROR_FAILED,
+		                                        "Unsupported url %s",
+		                                        req->url));
+		return;
+	}
+
+	key = gc_http_pool_key (req->host, req->port);
+	g_mutex_lock (&pool_lock);
+	pool_stats.requests++;
+	/* a retry connects afresh: the other pooled sockets to the
+	 * server are likely as stale as the one it gave up on */
+	fd = req->no_pool ? -1 : gc_http_pool_take (key);
+	if (fd >= 0) {
+		pool_stats.reused++;
+	}
+	g_mutex_unlock (&pool_lock);
+	g_free (key);
+	req->no_pool = FALSE;
+	if (fd >= 0) {
+		req->fd = fd;
+		req->reused = TRUE;
+		gc_http_request_send (req);
+		return;
+	}
+	req->reused = FALSE;
+
+	req->lookup = g_new0 (GcHttpLookup, 1);
+	req->lookup->req = req;
+	req->lookup->cancellable = g_cancellable_new ();
+
+	/* the resolver answers in the thread-default context */
+	g_main_context_push_thread_default (req->context ?
+	                                    req->context : g_main_context_default ());
+	resolver = g_resolver_get_default ();
+	g_resolver_lookup_by_name_async (resolver, req->host,
+	                                 req->lookup->cancellable,
+	                                 gc_http_request_resolved, req->lookup);
+	g_object_unref (resolver);
+	g_main_context_pop_thread_default (req->context ?
+	                                   req->context : g_main_context_default ());
+}
+
+/* The whole request, redirects included, must be done by now */
+static gboolean
+gc_http_request_expired (GcHttpRequest *req)
+{
+	g_source_unref (req->deadline);
+	req->deadline = NULL;
+
+	/* a socket with a request half way through cannot be reused */
+	gc_http_request_fail (req, g_error_new (GEOCLUE_ERROR,
+	                                        GEOCLUE_ERROR_NOT_AVAILABLE,
+	                                        "Timed out fetching %s",
+	                                        req->url));
+	return FALSE;
+}
+
+static gboolean
+gc_http_request_start_idle (GcHttpRequest *req)
+{
+	g_source_unref (req->source);
+	req->source = NULL;
+
+	gc_http_request_start (req);
+	return FALSE;
+}
+
+/**
+ * gc_http_get:
+ * @url: A http:// url
+ * @context: #GMainContext to run the request in, or %NULL for the default
+ * @timeout: Deadline for the whole request in milliseconds, or 0 for none
+ * @callback: Function to call when the request has finished
+ * @user_data: Data to pass to @callback
+ *
+ * Starts fetching @url. @callback is always called from @context,
+ * never from within gc_http_get() itself. If the request has not
+ * finished within @timeout it is cancelled and fails with
+ * %GEOCLUE_ERROR_NOT_AVAILABLE.
+ */
+void
+gc_http_get (const char     *url,
+             GMainContext   *context,
+             guint           timeout,
+             GcHttpCallback  callback,
+             gpointer        user_data)
+{
+	GcHttpRequest *req;
+
+	g_return_if_fail (url);
+	g_return_if_fail (callback);
+
+	req = g_new0 (GcHttpRequest, 1);
+	req->url = g_strdup (url);
+	req->fd = -1;
+	req->context = context ? g_main_context_ref (context) : NULL;
+	req->callback = callback;
+	req->user_data = user_data;
+
+	req->source = g_idle_source_new ();
+	g_source_set_callback (req->source,
+	                       (GSourceFunc) gc_http_request_start_idle, req, NULL);
+	g_source_attach (req->source, req->context);
+
+	if (timeout > 0) {
+		req->deadline = g_timeout_source_new (timeout);
+		g_source_set_callback (req->deadline,
+		                       (GSourceFunc) gc_http_request_expired, req, NULL);
+		g_source_attach (req->deadline, req->context);
+	}
+}
+
+/**
+ * gc_http_pool_get_stats:
+ * @stats: Return location for the connection pool statistics
+ *
+ * Copies the statistics of the process wide connection pool to @stats.
+ * May be called from any thread.
+ */
+void
+gc_http_pool_get_stats (GcHttpPoolStats *stats)
+{
+	g_return_if_fail (stats);
+
+	g_mutex_lock (&pool_lock);
+	*stats = pool_stats;
+	stats->idle_sockets = g_queue_get_length (&pool);
+	g_mutex_unlock (&pool_lock);
+}
@@ -0,0 +1,58 @@
+/*
+ * Geoclue
+ * gc-http.h - Main loop driven HTTP client used by GcWebService
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+#ifndef GC_HTTP_H
+#define GC_HTTP_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Called once per request from the request's main context. On success
+ * @body holds the response body, NUL-terminated just past its size;
+ * the reference is owned by the callee. On failure @body is NULL and
+ * @error is set; @error is owned by the HTTP code and must not be freed. */
+typedef void (*GcHttpCallback) (GBytes   *body,
+                                GError   *error,
+                                gpointer  user_data);
+
+/* Process wide statistics of the connection pool and transfers */
+typedef struct _GcHttpPoolStats {
+	guint requests;      /* connections asked for */
+	guint reused;        /* ...of which were served from the pool */
+	guint opened;        /* new connections made */
+	guint evicted;       /* idle connections closed by the pool */
+	guint open_sockets;  /* currently open, busy or idle */
+	guint idle_sockets;  /* currently waiting in the pool */
+	guint64 bytes_received; /* read from sockets, headers included */
+	guint64 bytes_decoded;  /* response bodies after content decoding */
+} GcHttpPoolStats;
+
+void gc_http_get (const char     *url,
+                  GMainContext   *context,
+                  guint           timeout,
+                  GcHttpCallback  callback,
+                  gpointer        user_data);
+
+void gc_http_pool_get_stats (GcHttpPoolStats *stats);
+
+G_END_DECLS
+
+#endif /* GC_HTTP_H */
@@ -40,7 +40,7 @@ static gboolean
 gc_iface_address_get_address (GcIfaceAddress   *gc,
 			      int              *timestamp,
 			      GHashTable      **address,
-			      GeoclueAccuracy **accuracy,
+			      GValueArray     **accuracy,
 			      GError          **error);
 #include "gc-iface-address-glue.h"
 
@@ -90,11 +90,19 @@ static gboolean
 gc_iface_address_get_address (GcIfaceAddress   *gc,
 			      int              *timestamp,
 			      GHashTable      **address,
-			      GeoclueAccuracy **accuracy,
+			      GValueArray     **accuracy,
 			      GError          **error)
 {
-	return GC_IFACE_ADDRESS_GET_CLASS (gc)->get_address 
-		(gc, timestamp, address, accuracy, error);
+	GeoclueAccuracy *acc = NULL;
+	gboolean ret;
+	
+	ret = GC_IFACE_ADDRESS_GET_CLASS (gc)->get_address 
+		(gc, timestamp, address, &acc, error);
+	if (ret) {
+		*accuracy = geoclue_accuracy_to_value_array (acc);
+	}
+	geoclue_accuracy_free (acc);
+	return ret;
 }
 
 void
@@ -103,6 +111,10 @@ gc_iface_address_emit_address_changed (GcIfaceAddress  *gc,
 				       GHashTable      *address,
 				       GeoclueAccuracy *accuracy)
 {
+	GValueArray *vals;
+	
+	vals = geoclue_accuracy_to_value_array (accuracy);
 	g_signal_emit (gc, signals[ADDRESS_CHANGED], 0, timestamp,
-		       address, accuracy);
+		       address, vals);
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
 }
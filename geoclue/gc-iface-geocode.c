@@ -40,7 +40,7 @@ gc_iface_geocode_address_to_position (GcIfaceGeocode   *gc,
 				      double           *latitude,
 				      double           *longitude,
 				      double           *altitude,
-				      GeoclueAccuracy **accuracy,
+				      GValueArray     **accuracy,
 				      GError          **error);
 
 static gboolean
@@ -50,7 +50,7 @@ gc_iface_geocode_freeform_address_to_position (GcIfaceGeocode   *gc,
                                                double           *latitude,
                                                double           *longitude,
                                                double           *altitude,
-                                               GeoclueAccuracy **accuracy,
+                                               GValueArray     **accuracy,
                                                GError          **error);
 #include "gc-iface-geocode-glue.h"
 
@@ -94,12 +94,20 @@ gc_iface_geocode_address_to_position (GcIfaceGeocode   *gc,
 				      double           *latitude,
 				      double           *longitude,
 				      double           *altitude,
-				      GeoclueAccuracy **accuracy,
+				      GValueArray     **accuracy,
 				      GError          **error)
 {
-	return GC_IFACE_GEOCODE_GET_CLASS (gc)->address_to_position 
+	GeoclueAccuracy *acc = NULL;
+	gboolean ret;
+	
+	ret = GC_IFACE_GEOCODE_GET_CLASS (gc)->address_to_position 
 		(gc, address, (GeocluePositionFields *) fields,
-		 latitude, longitude, altitude, accuracy, error);
+		 latitude, longitude, altitude, &acc, error);
+	if (ret) {
+		*accuracy = geoclue_accuracy_to_value_array (acc);
+	}
+	geoclue_accuracy_free (acc);
+	return ret;
 }
 
 static gboolean
@@ -109,10 +117,18 @@ gc_iface_geocode_freeform_address_to_position (GcIfaceGeocode   *gc,
                                                double           *latitude,
                                                double           *longitude,
                                                double           *altitude,
-                                               GeoclueAccuracy **accuracy,
+                                               GValueArray     **accuracy,
                                                GError          **error)
 {
-	return GC_IFACE_GEOCODE_GET_CLASS (gc)->freeform_address_to_position
+	GeoclueAccuracy *acc = NULL;
+	gboolean ret;
+	
+	ret = GC_IFACE_GEOCODE_GET_CLASS (gc)->freeform_address_to_position
 		(gc, address, (GeocluePositionFields *) fields,
-		 latitude, longitude, altitude, accuracy, error);
+		 latitude, longitude, altitude, &acc, error);
+	if (ret) {
+		*accuracy = geoclue_accuracy_to_value_array (acc);
+	}
+	geoclue_accuracy_free (acc);
+	return ret;
 }
@@ -43,7 +43,7 @@ gc_iface_position_get_position (GcIfacePosition       *position,
 				double                *latitude,
 				double                *longitude,
 				double                *altitude,
-				GeoclueAccuracy      **accuracy,
+				GValueArray          **accuracy,
 				GError               **error);
 
 #include "gc-iface-position-glue.h"
@@ -101,12 +101,20 @@ gc_iface_position_get_position (GcIfacePosition  *gc,
 				double           *latitude,
 				double           *longitude,
 				double           *altitude,
-				GeoclueAccuracy **accuracy,
+				GValueArray     **accuracy,
 				GError          **error)
 {
-	return GC_IFACE_POSITION_GET_CLASS (gc)->get_position 
+	GeoclueAccuracy *acc = NULL;
+	gboolean ret;
+	
+	ret = GC_IFACE_POSITION_GET_CLASS (gc)->get_position 
 		(gc, (GeocluePositionFields *) fields, timestamp,
-		 latitude, longitude, altitude, accuracy, error);
+		 latitude, longitude, altitude, &acc, error);
+	if (ret) {
+		*accuracy = geoclue_accuracy_to_value_array (acc);
+	}
+	geoclue_accuracy_free (acc);
+	return ret;
 }
 
 void
@@ -118,6 +126,10 @@ gc_iface_position_emit_position_changed (GcIfacePosition      *gc,
 					 double                altitude,
 					 GeoclueAccuracy      *accuracy)
 {
+	GValueArray *vals;
+	
+	vals = geoclue_accuracy_to_value_array (accuracy);
 	g_signal_emit (gc, signals[POSITION_CHANGED], 0, fields, timestamp,
-		       latitude, longitude, altitude, accuracy);
+		       latitude, longitude, altitude, vals);
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
 }
@@ -33,9 +33,9 @@ static gboolean
 gc_iface_reverse_geocode_position_to_address (GcIfaceReverseGeocode  *gc,
 					      double                  latitude,
 					      double                  longitude,
-					      GeoclueAccuracy        *position_accuracy,
+					      GValueArray            *position_accuracy,
 					      GHashTable            **address,
-					      GeoclueAccuracy       **address_accuracy,
+					      GValueArray           **address_accuracy,
 					      GError                **error);
 #include "gc-iface-reverse-geocode-glue.h"
 
@@ -76,12 +76,22 @@ static gboolean
 gc_iface_reverse_geocode_position_to_address (GcIfaceReverseGeocode  *gc,
 					      double                  latitude,
 					      double                  longitude,
-					      GeoclueAccuracy        *position_accuracy,
+					      GValueArray            *position_accuracy,
 					      GHashTable            **address,
-					      GeoclueAccuracy       **address_accuracy,
+					      GValueArray           **address_accuracy,
 					      GError                **error)
 {
-	return GC_IFACE_REVERSE_GEOCODE_GET_CLASS (gc)->position_to_address 
-		(gc, latitude, longitude, position_accuracy, 
-		 address, address_accuracy, error);
+	GeoclueAccuracy *pos_acc, *addr_acc = NULL;
+	gboolean ret;
+	
+	pos_acc = geoclue_accuracy_new_from_value_array (position_accuracy);
+	ret = GC_IFACE_REVERSE_GEOCODE_GET_CLASS (gc)->position_to_address 
+		(gc, latitude, longitude, pos_acc, 
+		 address, &addr_acc, error);
+	if (ret) {
+		*address_accuracy = geoclue_accuracy_to_value_array (addr_acc);
+	}
+	geoclue_accuracy_free (pos_acc);
+	geoclue_accuracy_free (addr_acc);
+	return ret;
 }
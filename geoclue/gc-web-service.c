@@ -76,18 +76,51 @@
  * g_object_unref (G_OBJECT (web_service));
  * </programlisting>
  * </informalexample>
+ *
+ * gc_web_service_query() blocks until the document has been fetched.
+ * Providers that should keep serving D-Bus calls meanwhile can use 
+ * gc_web_service_query_async() instead: the getters can then be used 
+ * in the #GcWebServiceCallback, which is called from the main loop.
+ * Any number of asynchronous queries may be in flight at the same time.
+ * 
+ * All requests run in one helper thread. Identical queries, blocking 
+ * or not, made while a request for the same url is in progress share 
+ * that request instead of starting another one.
+ *
+ * Responses can optionally be cached in memory, see 
+ * gc_web_service_set_cache(). A query whose url (with GET parameters in 
+ * canonical order) was fetched less than the time-to-live ago is then 
+ * answered from the cache without touching the network, and the parsed 
+ * document is cached along with the raw data so it is not parsed again.
+ * 
+ * Every query has a deadline, see gc_web_service_set_timeout(): a query
+ * that has not finished in time is cancelled and fails with
+ * %GEOCLUE_ERROR_NOT_AVAILABLE.
+ * 
+ * Providers can let users tune the cache and the deadline through 
+ * SetOptions by calling gc_web_service_set_options() from their 
+ * set_options implementation. The master passes the [Options] group of
+ * the .provider file along with the main options.
  */
 
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <glib-object.h>
 
-#include <libxml/nanohttp.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/xmlreader.h>
 #include <libxml/uri.h>      /* for xmlURIEscapeStr */
 
 #include "gc-web-service.h"
+#include "gc-http.h"
 #include "geoclue-error.h"
 
+#define GC_WEB_SERVICE_DEFAULT_CACHE_SIZE (256 * 1024)
+/* stay below the default D-Bus method call timeout of the callers */
+#define GC_WEB_SERVICE_DEFAULT_TIMEOUT (20 * 1000)
+
 G_DEFINE_TYPE (GcWebService, gc_web_service, G_TYPE_OBJECT)
 
 typedef struct _XmlNamespace {
@@ -95,6 +128,206 @@ typedef struct _XmlNamespace {
 	gchar *uri;
 }XmlNamespace;
 
+/* A fetched document. Shared between the cache and the services 
+ * that have it as their current response */
+typedef struct _GcWebServiceResponse {
+	int ref_count;
+	GBytes *bytes;          /* NUL-terminated past its size */
+	gsize length;
+	xmlDocPtr doc;          /* parsed on first use */
+	
+	gchar *key;             /* set while in the cache */
+	time_t expires;
+	GList *lru_link;
+} GcWebServiceResponse;
+
+typedef struct _GcWebServiceCache {
+	guint ttl;
+	gsize max_bytes;
+	gsize bytes;
+	GHashTable *responses;  /* key -> GcWebServiceResponse */
+	GQueue lru;             /* least recently used first */
+	guint hits;
+	guint misses;
+} GcWebServiceCache;
+
+/* One step of a simple location path, e.g. "//ns:name[1]" */
+typedef struct _GcWebServiceStep {
+	gchar *prefix;          /* NULL if the name has no namespace */
+	gchar *name;
+	gboolean descendant;    /* preceded by "//" instead of "/" */
+	gboolean first;         /* "[1]" predicate */
+} GcWebServiceStep;
+
+/* An XPath expression that gc_web_service_extract() can match while 
+ * walking the document. n_steps is 0 for expressions it cannot handle */
+typedef struct _GcWebServicePath {
+	GcWebServiceStep *steps;
+	guint n_steps;
+	gchar *attribute;       /* trailing "@name", or NULL */
+} GcWebServicePath;
+
+typedef struct _GcWebServiceAsyncData {
+	GcWebService *self;
+	GcWebServiceCallback callback;
+	gpointer user_data;
+	gchar *key;
+	GcWebServiceResponse *cached;
+} GcWebServiceAsyncData;
+
+/* A request in progress, shared by all identical queries made before 
+ * it finishes. The request runs in the HTTP thread; blocking queries 
+ * wait for it on flights_cond, asynchronous ones are answered from an
+ * idle in the default main context. All fields are protected by 
+ * flights_lock. */
+typedef struct _GcWebServiceFlight {
+	int ref_count;          /* blocking queries, plus the request */
+	gchar *key;
+	GSList *waiters;        /* GcWebServiceAsyncData, newest first */
+	
+	gboolean done;
+	GBytes *body;
+	GError *error;
+	GcWebServiceResponse *response;  /* made from body on first use */
+} GcWebServiceFlight;
+
+/* canonical url -> GcWebServiceFlight, while the request runs */
+static GHashTable *flights = NULL;
+static GMutex flights_lock;
+static GCond flights_cond;
+
+/* Takes ownership of @bytes */
+static GcWebServiceResponse *
+gc_web_service_response_new (GBytes *bytes)
+{
+	GcWebServiceResponse *response;
+	
+	response = g_new0 (GcWebServiceResponse, 1);
+	response->ref_count = 1;
+	response->bytes = bytes;
+	response->length = g_bytes_get_size (bytes);
+	return response;
+}
+
+static GcWebServiceResponse *
+gc_web_service_response_ref (GcWebServiceResponse *response)
+{
+	response->ref_count++;
+	return response;
+}
+
+static void
+gc_web_service_response_unref (GcWebServiceResponse *response)
+{
+	if (--response->ref_count > 0) {
+		return;
+	}
+	if (response->doc) {
+		xmlFreeDoc (response->doc);
+	}
+	g_bytes_unref (response->bytes);
+	g_free (response->key);
+	g_free (response);
+}
+
+static void
+gc_web_service_cache_remove (GcWebServiceCache    *cache,
+                             GcWebServiceResponse *response)
+{
+	gchar *key = response->key;
+	
+	cache->bytes -= response->length;
+	g_queue_delete_link (&cache->lru, response->lru_link);
+	response->lru_link = NULL;
+	response->key = NULL;
+	
+	/* the table owns the reference the cache has */
+	g_hash_table_remove (cache->responses, key);
+	g_free (key);
+}
+
+static void
+gc_web_service_cache_clear (GcWebServiceCache *cache, const gchar *prefix)
+{
+	GList *l, *next;
+	
+	for (l = cache->lru.head; l; l = next) {
+		GcWebServiceResponse *response = l->data;
+		
+		next = l->next;
+		if (!prefix || g_str_has_prefix (response->key, prefix)) {
+			gc_web_service_cache_remove (cache, response);
+		}
+	}
+}
+
+static void
+gc_web_service_cache_free (GcWebServiceCache *cache)
+{
+	gc_web_service_cache_clear (cache, NULL);
+	g_hash_table_destroy (cache->responses);
+	g_free (cache);
+}
+
+/* Returns the unexpired cached response for @key, or NULL */
+static GcWebServiceResponse *
+gc_web_service_cache_lookup (GcWebService *self, const gchar *key)
+{
+	GcWebServiceCache *cache = self->cache;
+	GcWebServiceResponse *response;
+	
+	if (!cache) {
+		return NULL;
+	}
+	
+	response = g_hash_table_lookup (cache->responses, key);
+	if (response && response->expires <= time (NULL)) {
+		gc_web_service_cache_remove (cache, response);
+		response = NULL;
+	}
+	if (!response) {
+		cache->misses++;
+		return NULL;
+	}
+	
+	cache->hits++;
+	g_queue_unlink (&cache->lru, response->lru_link);
+	g_queue_push_tail_link (&cache->lru, response->lru_link);
+	return response;
+}
+
+/* Adds @response to the cache, evicting least recently used
+ * responses until the cache fits its byte budget again */
+static void
+gc_web_service_cache_store (GcWebService         *self,
+                            const gchar          *key,
+                            GcWebServiceResponse *response)
+{
+	GcWebServiceCache *cache = self->cache;
+	GcWebServiceResponse *old;
+	
+	if (!cache || response->key || response->length > cache->max_bytes) {
+		return;
+	}
+	
+	old = g_hash_table_lookup (cache->responses, key);
+	if (old) {
+		gc_web_service_cache_remove (cache, old);
+	}
+	
+	response->key = g_strdup (key);
+	response->expires = time (NULL) + cache->ttl;
+	g_hash_table_insert (cache->responses, response->key,
+	                     gc_web_service_response_ref (response));
+	g_queue_push_tail (&cache->lru, response);
+	response->lru_link = cache->lru.tail;
+	cache->bytes += response->length;
+	
+	while (cache->bytes > cache->max_bytes) {
+		gc_web_service_cache_remove (cache, cache->lru.head->data);
+	}
+}
+
 /* GFunc, use with g_list_foreach */
 static void
 gc_web_service_register_ns (gpointer data, gpointer user_data)
@@ -129,17 +362,18 @@ gc_web_service_register_namespaces (GcWebService *self)
 static void
 gc_web_service_reset (GcWebService *self)
 {
-	g_free (self->response);
-	self->response = NULL;
-	self->response_length = 0;
-	
+	/* the document belongs to the response */
 	if (self->xpath_ctx) {
-		if (self->xpath_ctx->doc) {
-			xmlFreeDoc (self->xpath_ctx->doc);
-		}
 		xmlXPathFreeContext (self->xpath_ctx);
 		self->xpath_ctx = NULL;
 	}
+	
+	if (self->current) {
+		gc_web_service_response_unref (self->current);
+		self->current = NULL;
+	}
+	self->response = NULL;
+	self->response_length = 0;
 }
 
 /* Parse data (self->response), build xpath context and register 
@@ -148,22 +382,27 @@ static gboolean
 gc_web_service_build_xpath_context (GcWebService *self)
 {
 	xmlDocPtr doc;
-	xmlChar *tmp;
 	
 	/* don't rebuild if there's no need */
 	if (self->xpath_ctx) {
 		return TRUE;
 	}
+	if (!self->current) {
+		return FALSE;
+	}
 	
-	/* make sure response is NULL-terminated */
-	tmp = xmlStrndup(self->response, self->response_length);
-	doc = xmlParseDoc (tmp);
+	/* a cached response may have been parsed already */
+	doc = self->current->doc;
 	if (!doc) {
-		/* TODO: error handling */
-		g_free (tmp);
-		return FALSE;
+		/* parse straight from the receive buffer */
+		doc = xmlReadMemory ((const char *) self->response,
+		                     self->response_length, NULL, NULL, 0);
+		if (!doc) {
+			/* TODO: error handling */
+			return FALSE;
+		}
+		self->current->doc = doc;
 	}
-	xmlFree (tmp);
 	
 	self->xpath_ctx = xmlXPathNewContext(doc);
 	if (!self->xpath_ctx) {
@@ -174,54 +413,276 @@ gc_web_service_build_xpath_context (GcWebService *self)
 	return TRUE;
 }
 
+/* Makes @response the current response, adding a reference */
+static void
+gc_web_service_use_response (GcWebService *self, GcWebServiceResponse *response)
+{
+	gc_web_service_response_ref (response);
+	gc_web_service_reset (self);
+	self->current = response;
+	self->response = (guchar *) g_bytes_get_data (response->bytes, NULL);
+	self->response_length = response->length;
+}
+
+/* Takes ownership of @body */
+static void
+gc_web_service_set_response (GcWebService *self, GBytes *body)
+{
+	GcWebServiceResponse *response;
+	
+	response = gc_web_service_response_new (body);
+	gc_web_service_use_response (self, response);
+	gc_web_service_response_unref (response);
+}
+
+static gpointer
+gc_web_service_http_thread (gpointer data)
+{
+	GMainContext *context = data;
+	
+	for (;;) {
+		g_main_context_iteration (context, TRUE);
+	}
+	return NULL;
+}
+
+/* Returns the context of the thread that runs all requests */
+static GMainContext *
+gc_web_service_get_http_context (void)
+{
+	static gsize initialized = 0;
+	static GMainContext *context = NULL;
+	
+	if (g_once_init_enter (&initialized)) {
+		context = g_main_context_new ();
+		g_thread_unref (g_thread_new ("gc-web-service",
+		                              gc_web_service_http_thread,
+		                              context));
+		g_once_init_leave (&initialized, 1);
+	}
+	return context;
+}
+
+static void
+gc_web_service_flight_unref (GcWebServiceFlight *flight)
+{
+	int ref_count;
+	
+	g_mutex_lock (&flights_lock);
+	ref_count = --flight->ref_count;
+	g_mutex_unlock (&flights_lock);
+	if (ref_count > 0) {
+		return;
+	}
+	
+	if (flight->response) {
+		gc_web_service_response_unref (flight->response);
+	}
+	if (flight->body) {
+		g_bytes_unref (flight->body);
+	}
+	if (flight->error) {
+		g_error_free (flight->error);
+	}
+	g_free (flight->key);
+	g_free (flight);
+}
+
+/* Returns the response of a finished flight, or NULL if it failed.
+ * Call with flights_lock held. */
+static GcWebServiceResponse *
+gc_web_service_flight_get_response (GcWebServiceFlight *flight)
+{
+	if (!flight->response && flight->body) {
+		flight->response = gc_web_service_response_new (flight->body);
+		flight->body = NULL;
+	}
+	return flight->response;
+}
+
+/* GSourceFunc: hands the response to every asynchronous query that 
+ * joined the flight */
+static gboolean
+gc_web_service_flight_dispatch (gpointer user_data)
+{
+	GcWebServiceFlight *flight = user_data;
+	GcWebServiceResponse *response;
+	GSList *waiters, *l;
+	
+	g_mutex_lock (&flights_lock);
+	response = gc_web_service_flight_get_response (flight);
+	waiters = g_slist_reverse (flight->waiters);
+	flight->waiters = NULL;
+	g_mutex_unlock (&flights_lock);
+	
+	for (l = waiters; l; l = l->next) {
+		GcWebServiceAsyncData *data = l->data;
+		
+		if (response) {
+			gc_web_service_use_response (data->self, response);
+			gc_web_service_cache_store (data->self, data->key, response);
+		}
+		data->callback (data->self, flight->error, data->user_data);
+		
+		g_object_unref (data->self);
+		g_free (data->key);
+		g_free (data);
+	}
+	g_slist_free (waiters);
+	
+	/* the reference of the request */
+	gc_web_service_flight_unref (flight);
+	return FALSE;
+}
+
+/* GcHttpCallback, called in the HTTP thread */
+static void
+gc_web_service_flight_done (GBytes   *body,
+                            GError   *error,
+                            gpointer  user_data)
+{
+	GcWebServiceFlight *flight = user_data;
+	
+	g_mutex_lock (&flights_lock);
+	/* queries made from now on start a new flight */
+	g_hash_table_remove (flights, flight->key);
+	flight->body = body;
+	if (error) {
+		flight->error = g_error_copy (error);
+	}
+	flight->done = TRUE;
+	g_cond_broadcast (&flights_cond);
+	
+	if (flight->waiters) {
+		/* the idle takes over the reference of the request */
+		g_idle_add (gc_web_service_flight_dispatch, flight);
+	} else {
+		/* a blocking query still holds a reference, so the 
+		 * flight is always freed in the thread of its queries */
+		flight->ref_count--;
+	}
+	g_mutex_unlock (&flights_lock);
+}
+
+/* Joins the flight for @key, starting it if there is none. @data is 
+ * added to the asynchronous waiters; without it a reference to the 
+ * flight is returned for a blocking query. */
+static GcWebServiceFlight *
+gc_web_service_flight_join (GcWebService          *self,
+                            const gchar           *url,
+                            const gchar           *key,
+                            GcWebServiceAsyncData *data)
+{
+	GcWebServiceFlight *flight;
+	
+	g_mutex_lock (&flights_lock);
+	if (!flights) {
+		flights = g_hash_table_new (g_str_hash, g_str_equal);
+	}
+	flight = g_hash_table_lookup (flights, key);
+	if (flight) {
+		g_debug ("Joining request in flight for %s", url);
+	} else {
+		flight = g_new0 (GcWebServiceFlight, 1);
+		flight->ref_count = 1;
+		flight->key = g_strdup (key);
+		g_hash_table_insert (flights, flight->key, flight);
+		gc_http_get (url, gc_web_service_get_http_context (), self->timeout,
+		             gc_web_service_flight_done, flight);
+	}
+	if (data) {
+		flight->waiters = g_slist_prepend (flight->waiters, data);
+	} else {
+		flight->ref_count++;
+	}
+	g_mutex_unlock (&flights_lock);
+	
+	return flight;
+}
+
 /* fetch data from url, save into self->response */
 static gboolean
-gc_web_service_fetch (GcWebService *self, gchar *url, GError **error)
+gc_web_service_fetch (GcWebService *self,
+                      const gchar  *url,
+                      const gchar  *key,
+                      GError      **error)
 {
-	void* ctxt = NULL;
-	gint len;
-	xmlChar buf[1024];
-	xmlBuffer *output;
+	GcWebServiceFlight *flight;
+	GcWebServiceResponse *response;
 	
 	g_assert (url);
 	
 	gc_web_service_reset (self);
 	
-	xmlNanoHTTPInit();
-	ctxt = xmlNanoHTTPMethod (url, "GET", NULL, NULL, NULL, 0);
-	if (!ctxt) {
-		*error = g_error_new (GEOCLUE_ERROR, 
-		                      GEOCLUE_ERROR_NOT_AVAILABLE,
-		                      g_strdup_printf ("xmlNanoHTTPMethod did not get a response from %s\n", url));
-		return FALSE;
+	/* the caller blocks as before, but nothing else gets 
+	 * dispatched behind its back */
+	flight = gc_web_service_flight_join (self, url, key, NULL);
+	g_mutex_lock (&flights_lock);
+	while (!flight->done) {
+		g_cond_wait (&flights_cond, &flights_lock);
+	}
+	response = gc_web_service_flight_get_response (flight);
+	if (!response) {
+		g_propagate_error (error, g_error_copy (flight->error));
 	}
+	g_mutex_unlock (&flights_lock);
 	
-	output = xmlBufferCreate ();
-	while ((len = xmlNanoHTTPRead (ctxt, buf, sizeof(buf))) > 0) {
-		if (xmlBufferAdd (output, buf, len) != 0) {
-			xmlNanoHTTPClose(ctxt);
-			xmlBufferFree (output);
-			
-			*error = g_error_new (GEOCLUE_ERROR, 
-			                      GEOCLUE_ERROR_FAILED,
-			                      g_strdup_printf ("libxml error (xmlBufferAdd failed)"));
-			
-			return FALSE;
-		}
+	if (response) {
+		gc_web_service_use_response (self, response);
 	}
-	xmlNanoHTTPClose(ctxt);
+	gc_web_service_flight_unref (flight);
 	
-	self->response_length = xmlBufferLength (output);
-	self->response = g_memdup (xmlBufferContent (output), self->response_length);
-	xmlBufferFree (output);
+	return response != NULL;
+}
+
+/* GSourceFunc for gc_web_service_query_async cache hits */
+static gboolean
+gc_web_service_query_async_cached (gpointer user_data)
+{
+	GcWebServiceAsyncData *data = user_data;
 	
-	return TRUE;
+	gc_web_service_use_response (data->self, data->cached);
+	gc_web_service_response_unref (data->cached);
+	data->callback (data->self, NULL, data->user_data);
+	
+	g_object_unref (data->self);
+	g_free (data->key);
+	g_free (data);
+	return FALSE;
+}
+
+/* Returns @xpath in compiled form. Providers use a small set of 
+ * constant expressions, so they are compiled once and kept for the 
+ * lifetime of the process. Namespace prefixes are resolved at 
+ * evaluation time, so one compiled expression serves all services. */
+static xmlXPathCompExprPtr
+gc_web_service_compile_xpath (const gchar *xpath)
+{
+	static GHashTable *compiled = NULL;
+	xmlXPathCompExprPtr comp;
+	
+	if (!compiled) {
+		compiled = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                  (GDestroyNotify) xmlXPathFreeCompExpr);
+	}
+	
+	comp = g_hash_table_lookup (compiled, xpath);
+	if (!comp) {
+		comp = xmlXPathCompile ((xmlChar *) xpath);
+		if (!comp) {
+			g_warning ("Invalid XPath expression %s", xpath);
+			return NULL;
+		}
+		g_hash_table_insert (compiled, g_strdup (xpath), comp);
+	}
+	return comp;
 }
 
 static xmlXPathObject*
 gc_web_service_get_xpath_object (GcWebService *self, gchar* xpath)
 {
 	xmlXPathObject *obj = NULL;
+	xmlXPathCompExprPtr comp;
 	
 	g_return_val_if_fail (xpath, FALSE);
 	
@@ -231,7 +692,11 @@ gc_web_service_get_xpath_object (GcWebService *self, gchar* xpath)
 	}
 	g_assert (self->xpath_ctx);
 	
-	obj = xmlXPathEvalExpression ((xmlChar*)xpath, self->xpath_ctx);
+	comp = gc_web_service_compile_xpath (xpath);
+	if (!comp) {
+		return NULL;
+	}
+	obj = xmlXPathCompiledEval (comp, self->xpath_ctx);
 	if (obj && 
 	    (!obj->nodesetval || xmlXPathNodeSetIsEmpty (obj->nodesetval))) {
 		xmlXPathFreeObject (obj);
@@ -248,6 +713,9 @@ gc_web_service_init (GcWebService *self)
 	self->xpath_ctx = NULL;
 	self->namespaces = NULL;
 	self->base_url = NULL;
+	self->current = NULL;
+	self->cache = NULL;
+	self->timeout = GC_WEB_SERVICE_DEFAULT_TIMEOUT;
 }
 
 
@@ -255,7 +723,22 @@ static void
 gc_web_service_finalize (GObject *obj)
 {
 	GcWebService *self = (GcWebService *) obj;
+	GcHttpPoolStats stats;
 	
+	gc_http_pool_get_stats (&stats);
+	g_debug ("HTTP connection pool: %u of %u connections reused, "
+	         "%u sockets open (%u idle), %u evicted",
+	         stats.reused, stats.requests,
+	         stats.open_sockets, stats.idle_sockets, stats.evicted);
+	g_debug ("HTTP transfers: %" G_GUINT64_FORMAT " bytes received, "
+	         "%" G_GUINT64_FORMAT " bytes after decoding",
+	         stats.bytes_received, stats.bytes_decoded);
+	
+	if (self->cache) {
+		g_debug ("Web service cache for %s: %u hits, %u misses", 
+		         self->base_url, self->cache->hits, self->cache->misses);
+		gc_web_service_cache_free (self->cache);
+	}
 	gc_web_service_reset (self);
 	
 	g_free (self->base_url);
@@ -317,6 +800,57 @@ gc_web_service_add_namespace (GcWebService *self, gchar *namespace, gchar *uri)
 	return TRUE;
 }
 
+static int
+gc_web_service_compare_pairs (const void *a, const void *b)
+{
+	return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static gchar *
+gc_web_service_join_pairs (const gchar *base_url, GPtrArray *pairs)
+{
+	GString *url;
+	guint i;
+	
+	url = g_string_new (base_url);
+	for (i = 0; i < pairs->len; i++) {
+		g_string_append_c (url, i == 0 ? '?' : '&');
+		g_string_append (url, g_ptr_array_index (pairs, i));
+	}
+	return g_string_free (url, FALSE);
+}
+
+/* Builds the query url from base url and key-value pairs in @list:
+ * "base_url?key1=value1&key2=value2&...". @cache_key is set to the 
+ * same url with the pairs sorted, so that queries differing only in 
+ * parameter order share a cache entry. */
+static gchar *
+gc_web_service_build_url (GcWebService *self, va_list list, gchar **cache_key)
+{
+	GPtrArray *pairs;
+	gchar *key, *value, *esc_value, *url;
+	
+	pairs = g_ptr_array_new ();
+	
+	key = va_arg (list, char*);
+	while (key) {
+		value = va_arg (list, char*);
+		esc_value = (gchar *)xmlURIEscapeStr ((xmlChar *)value, NULL);
+		g_ptr_array_add (pairs, g_strdup_printf ("%s=%s", key, esc_value));
+		xmlFree (esc_value);
+		key = va_arg (list, char*);
+	}
+	
+	url = gc_web_service_join_pairs (self->base_url, pairs);
+	qsort (pairs->pdata, pairs->len, sizeof (gpointer),
+	       gc_web_service_compare_pairs);
+	*cache_key = gc_web_service_join_pairs (self->base_url, pairs);
+	
+	g_ptr_array_foreach (pairs, (GFunc) g_free, NULL);
+	g_ptr_array_free (pairs, TRUE);
+	return url;
+}
+
 /**
  * gc_web_service_query:
  * @self: A #GcWebService object
@@ -326,6 +860,10 @@ gc_web_service_add_namespace (GcWebService *self, gchar *namespace, gchar *uri)
  * optional arguments as GET parameters (see example in the 
  * Description-section). Data should be read using 
  * gc_web_service_get_* -functions.
+ * 
+ * A query for a url that is already being fetched, by a blocking or an 
+ * asynchronous query, waits for that request instead of starting 
+ * another one.
  *
  * Return value: %TRUE on success.
  */
@@ -333,39 +871,92 @@ gboolean
 gc_web_service_query (GcWebService *self, GError **error, ...)
 {
 	va_list list;
-	gchar *key, *value, *esc_value, *tmp, *url;
-	gboolean first_pair = TRUE;
+	gchar *url, *key;
+	GcWebServiceResponse *cached;
 	
 	g_return_val_if_fail (self->base_url, FALSE);
 	
-	url = g_strdup (self->base_url);
-	
-	/* read the arguments one key-value pair at a time,
-	   add the pairs to url as "?key1=value1&key2=value2&..." */
 	va_start (list, error);
-	key = va_arg (list, char*);
-	while (key) {
-		value = va_arg (list, char*);
-		esc_value = (gchar *)xmlURIEscapeStr ((xmlChar *)value, NULL);
-		
-		if (first_pair) {
-			tmp = g_strdup_printf ("%s?%s=%s",  url, key, esc_value);
-			first_pair = FALSE;
-		} else {
-			tmp = g_strdup_printf ("%s&%s=%s",  url, key, esc_value);
-		}
-		g_free (esc_value);
-		g_free (url);
-		url = tmp;
-		key = va_arg (list, char*);
-	}
+	url = gc_web_service_build_url (self, list, &key);
 	va_end (list);
 	
-	if (!gc_web_service_fetch (self, url, error)) {
+	cached = gc_web_service_cache_lookup (self, key);
+	if (cached) {
+		gc_web_service_use_response (self, cached);
+	} else if (gc_web_service_fetch (self, url, key, error)) {
+		gc_web_service_cache_store (self, key, self->current);
+	} else {
 		g_free (url);
+		g_free (key);
 		return FALSE;
 	}
 	g_free (url);
+	g_free (key);
+	
+	return TRUE;
+}
+
+/**
+ * GcWebServiceCallback:
+ * @self: The #GcWebService object
+ * @error: A #GError if the query failed, %NULL otherwise
+ * @user_data: User data pointer given to gc_web_service_query_async()
+ * 
+ * Callback function for gc_web_service_query_async(). On success the 
+ * fetched data can be read with gc_web_service_get_* -functions inside
+ * the callback (until the next query on @self finishes). @error is owned
+ * by #GcWebService and must not be freed.
+ */
+
+/**
+ * gc_web_service_query_async:
+ * @self: A #GcWebService object
+ * @callback: A #GcWebServiceCallback to call when data is available
+ * @user_data: User data pointer for @callback
+ * @Varargs: NULL-terminated list of key-value gchar* pairs
+ * 
+ * Like gc_web_service_query(), but returns immediately. @callback is
+ * called from the default main context once the data has been fetched
+ * or the query has failed.
+ * 
+ * Identical queries (same url, in any #GcWebService, blocking or not) 
+ * made while one is still in progress do not cause another request: 
+ * they all get the response of the first one, parsed only once.
+ *
+ * Return value: %TRUE if the query was started.
+ */
+gboolean
+gc_web_service_query_async (GcWebService         *self,
+                            GcWebServiceCallback  callback,
+                            gpointer              user_data,
+                            ...)
+{
+	va_list list;
+	gchar *url;
+	GcWebServiceAsyncData *data;
+	GcWebServiceResponse *cached;
+	
+	g_return_val_if_fail (self->base_url, FALSE);
+	g_return_val_if_fail (callback, FALSE);
+	
+	data = g_new0 (GcWebServiceAsyncData, 1);
+	data->self = g_object_ref (self);
+	data->callback = callback;
+	data->user_data = user_data;
+	
+	va_start (list, user_data);
+	url = gc_web_service_build_url (self, list, &data->key);
+	va_end (list);
+	
+	cached = gc_web_service_cache_lookup (self, data->key);
+	if (cached) {
+		/* still answer from the main loop, like a network query */
+		data->cached = gc_web_service_response_ref (cached);
+		g_idle_add (gc_web_service_query_async_cached, data);
+	} else {
+		gc_web_service_flight_join (self, url, data->key, data);
+	}
+	g_free (url);
 	
 	return TRUE;
 }
@@ -396,6 +987,481 @@ gc_web_service_get_double (GcWebService *self, gdouble *value, gchar *xpath)
 	return TRUE;
 }
 
+/* Parses @xpath into a GcWebServicePath. Only absolute location paths
+ * of plain or prefixed element names, "/" and "//" separators, "[1]" 
+ * predicates and an optional trailing attribute are supported. */
+static GcWebServicePath *
+gc_web_service_parse_path (const gchar *xpath)
+{
+	GcWebServicePath *path;
+	GArray *steps;
+	const gchar *p = xpath;
+	
+	path = g_new0 (GcWebServicePath, 1);
+	steps = g_array_new (FALSE, TRUE, sizeof (GcWebServiceStep));
+	
+	while (*p == '/') {
+		GcWebServiceStep step = {NULL, NULL, FALSE, FALSE};
+		gchar *name, *colon;
+		gsize len;
+		
+		if (p[1] == '/') {
+			step.descendant = TRUE;
+			p += 2;
+		} else {
+			p++;
+		}
+		
+		if (*p == '@' || g_str_has_prefix (p, "attribute::")) {
+			p += (*p == '@') ? 1 : strlen ("attribute::");
+			len = strcspn (p, "/[]()*|=:@ ");
+			if (step.descendant || len == 0 || p[len] != '\0') {
+				goto unsupported;
+			}
+			path->attribute = g_strdup (p);
+			p += len;
+			break;
+		}
+		
+		len = strcspn (p, "/[]()*|=@. ");
+		if (len == 0 || (p[len] != '\0' && p[len] != '/' && p[len] != '[')) {
+			goto unsupported;
+		}
+		name = g_strndup (p, len);
+		p += len;
+		if (*p == '[') {
+			if (!g_str_has_prefix (p, "[1]")) {
+				g_free (name);
+				goto unsupported;
+			}
+			step.first = TRUE;
+			p += 3;
+		}
+		
+		colon = strchr (name, ':');
+		if (colon) {
+			if (strchr (colon + 1, ':') || colon == name || colon[1] == '\0') {
+				g_free (name);
+				goto unsupported;
+			}
+			step.prefix = g_strndup (name, colon - name);
+			step.name = g_strdup (colon + 1);
+			g_free (name);
+		} else {
+			step.name = name;
+		}
+		g_array_append_val (steps, step);
+	}
+	if (*p != '\0' || steps->len == 0) {
+		goto unsupported;
+	}
+	
+	path->n_steps = steps->len;
+	path->steps = (GcWebServiceStep *) g_array_free (steps, FALSE);
+	return path;
+	
+unsupported:
+	while (steps->len > 0) {
+		GcWebServiceStep *step;
+		
+		step = &g_array_index (steps, GcWebServiceStep, steps->len - 1);
+		g_free (step->prefix);
+		g_free (step->name);
+		g_array_set_size (steps, steps->len - 1);
+	}
+	g_array_free (steps, TRUE);
+	g_free (path->attribute);
+	path->attribute = NULL;
+	return path;
+}
+
+/* Returns the parsed form of @xpath, cached like compiled expressions */
+static const GcWebServicePath *
+gc_web_service_get_path (const gchar *xpath)
+{
+	static GHashTable *paths = NULL;
+	GcWebServicePath *path;
+	
+	if (!paths) {
+		paths = g_hash_table_new (g_str_hash, g_str_equal);
+	}
+	path = g_hash_table_lookup (paths, xpath);
+	if (!path) {
+		path = gc_web_service_parse_path (xpath);
+		g_hash_table_insert (paths, g_strdup (xpath), path);
+	}
+	return path;
+}
+
+static const gchar *
+gc_web_service_lookup_ns (GcWebService *self, const gchar *prefix)
+{
+	GList *l;
+	
+	for (l = self->namespaces; l; l = l->next) {
+		XmlNamespace *ns = l->data;
+		
+		if (strcmp (ns->name, prefix) == 0) {
+			return ns->uri;
+		}
+	}
+	return NULL;
+}
+
+/* An open element during gc_web_service_extract(). Names point to the 
+ * document or the reader dictionary and stay valid during the pass. */
+typedef struct _GcWebServiceFrame {
+	const xmlChar *name;
+	const xmlChar *ns_uri;  /* NULL if the element has no namespace */
+	gboolean first;         /* no earlier sibling has the same name */
+	GSList *seen;           /* names of child elements so far, as pairs */
+} GcWebServiceFrame;
+
+typedef struct _GcWebServiceWalk {
+	GcWebService *self;
+	GcWebServiceField *fields;
+	const GcWebServicePath **paths;
+	guint n_fields;
+	guint remaining;
+	GArray *stack;          /* GcWebServiceFrame, document element first */
+	GSList *root_seen;
+} GcWebServiceWalk;
+
+static gboolean
+gc_web_service_step_matches (GcWebService            *self,
+                             const GcWebServiceStep  *step,
+                             const GcWebServiceFrame *frame)
+{
+	if (!xmlStrEqual (frame->name, (xmlChar *) step->name)) {
+		return FALSE;
+	}
+	if (step->prefix) {
+		const gchar *uri = gc_web_service_lookup_ns (self, step->prefix);
+		
+		if (!uri || !frame->ns_uri ||
+		    !xmlStrEqual (frame->ns_uri, (xmlChar *) uri)) {
+			return FALSE;
+		}
+	} else if (frame->ns_uri) {
+		return FALSE;
+	}
+	return !step->first || frame->first;
+}
+
+/* Does step @si of @path match @stack[@di], with the steps before it 
+ * matching its ancestors? */
+static gboolean
+gc_web_service_path_matches (GcWebService            *self,
+                             const GcWebServicePath  *path,
+                             guint                    si,
+                             const GcWebServiceFrame *stack,
+                             guint                    di)
+{
+	const GcWebServiceStep *step = &path->steps[si];
+	guint dj;
+	
+	if (!gc_web_service_step_matches (self, step, &stack[di])) {
+		return FALSE;
+	}
+	if (si == 0) {
+		return step->descendant || di == 0;
+	}
+	if (di == 0) {
+		return FALSE;
+	}
+	if (!step->descendant) {
+		return gc_web_service_path_matches (self, path, si - 1, stack, di - 1);
+	}
+	for (dj = di; dj-- > 0;) {
+		if (gc_web_service_path_matches (self, path, si - 1, stack, dj)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* Pushes a frame for an element that starts at depth @depth */
+static void
+gc_web_service_walk_push (GcWebServiceWalk *walk,
+                          guint             depth,
+                          const xmlChar    *name,
+                          const xmlChar    *ns_uri)
+{
+	GcWebServiceFrame frame;
+	GSList **seen, *l;
+	
+	g_assert (depth == walk->stack->len);
+	
+	if (depth == 0) {
+		seen = &walk->root_seen;
+	} else {
+		seen = &g_array_index (walk->stack, GcWebServiceFrame, depth - 1).seen;
+	}
+	
+	frame.name = name;
+	frame.ns_uri = ns_uri;
+	frame.first = TRUE;
+	frame.seen = NULL;
+	for (l = *seen; l && frame.first; l = l->next->next) {
+		if (xmlStrEqual (l->data, name) &&
+		    xmlStrEqual (l->next->data, ns_uri)) {
+			frame.first = FALSE;
+		}
+	}
+	if (frame.first) {
+		*seen = g_slist_prepend (*seen, (gpointer) ns_uri);
+		*seen = g_slist_prepend (*seen, (gpointer) name);
+	}
+	g_array_append_val (walk->stack, frame);
+}
+
+static void
+gc_web_service_walk_pop (GcWebServiceWalk *walk)
+{
+	GcWebServiceFrame *frame;
+	
+	frame = &g_array_index (walk->stack, GcWebServiceFrame, walk->stack->len - 1);
+	g_slist_free (frame->seen);
+	g_array_set_size (walk->stack, walk->stack->len - 1);
+}
+
+/* Returns the next field whose path ends at the top of the stack, 
+ * starting at index *@i, or NULL */
+static GcWebServiceField *
+gc_web_service_walk_next_match (GcWebServiceWalk *walk, guint *i)
+{
+	for (; *i < walk->n_fields; (*i)++) {
+		const GcWebServicePath *path = walk->paths[*i];
+		
+		if (!walk->fields[*i].found && path->n_steps > 0 &&
+		    gc_web_service_path_matches (walk->self, path, path->n_steps - 1,
+		                                 (GcWebServiceFrame *) walk->stack->data,
+		                                 walk->stack->len - 1)) {
+			return &walk->fields[(*i)++];
+		}
+	}
+	return NULL;
+}
+
+/* Stores the string value of @node in @field */
+static void
+gc_web_service_set_field (GcWebServiceField *field, xmlNodePtr node)
+{
+	xmlChar *content;
+	
+	content = xmlNodeGetContent (node);
+	if (field->type == GC_WEB_SERVICE_FIELD_DOUBLE) {
+		*(gdouble *) field->value = xmlXPathCastStringToNumber (content);
+		xmlFree (content);
+	} else {
+		*(gchar **) field->value = content ? (gchar *) content : g_strdup ("");
+	}
+	field->found = TRUE;
+}
+
+/* Visits @node, its siblings and their descendants in document order,
+ * so the first match of each field is the one XPath would return */
+static void
+gc_web_service_walk_tree (GcWebServiceWalk *walk, xmlNodePtr node)
+{
+	for (; node && walk->remaining > 0; node = node->next) {
+		GcWebServiceField *field;
+		guint i = 0;
+		
+		if (node->type != XML_ELEMENT_NODE) {
+			continue;
+		}
+		gc_web_service_walk_push (walk, walk->stack->len, node->name,
+		                          node->ns ? node->ns->href : NULL);
+		
+		while ((field = gc_web_service_walk_next_match (walk, &i))) {
+			xmlNodePtr match = node;
+			const gchar *attribute = walk->paths[i - 1]->attribute;
+			
+			if (attribute) {
+				match = (xmlNodePtr) xmlHasNsProp (node, (xmlChar *) attribute, NULL);
+				if (!match) {
+					continue;
+				}
+			}
+			gc_web_service_set_field (field, match);
+			walk->remaining--;
+		}
+		
+		gc_web_service_walk_tree (walk, node->children);
+		gc_web_service_walk_pop (walk);
+	}
+}
+
+/* Like gc_web_service_walk_tree(), but reads the raw response with 
+ * xmlTextReader. Only the subtrees of matching elements are built, 
+ * and parsing stops as soon as all fields have been found. */
+static gboolean
+gc_web_service_walk_stream (GcWebServiceWalk *walk)
+{
+	GcWebService *self = walk->self;
+	xmlTextReaderPtr reader;
+	int ret = 1;
+	
+	reader = xmlReaderForMemory ((const char *) self->response,
+	                             self->response_length,
+	                             NULL, NULL, XML_PARSE_NONET);
+	if (!reader) {
+		return FALSE;
+	}
+	
+	while (walk->remaining > 0 && (ret = xmlTextReaderRead (reader)) == 1) {
+		GcWebServiceField *field;
+		guint depth, i = 0;
+		
+		if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT) {
+			continue;
+		}
+		
+		/* closing tags are not needed, depth tells which elements ended */
+		depth = xmlTextReaderDepth (reader);
+		while (walk->stack->len > depth) {
+			gc_web_service_walk_pop (walk);
+		}
+		gc_web_service_walk_push (walk, depth,
+		                          xmlTextReaderConstLocalName (reader),
+		                          xmlTextReaderConstNamespaceUri (reader));
+		
+		while ((field = gc_web_service_walk_next_match (walk, &i))) {
+			const gchar *attribute = walk->paths[i - 1]->attribute;
+			xmlNodePtr node;
+			
+			if (attribute) {
+				xmlChar *value;
+				
+				/* the reader is positioned on the element, so 
+				 * attributes are available without expanding */
+				value = xmlTextReaderGetAttribute (reader, (xmlChar *) attribute);
+				if (!value) {
+					continue;
+				}
+				if (field->type == GC_WEB_SERVICE_FIELD_DOUBLE) {
+					*(gdouble *) field->value = xmlXPathCastStringToNumber (value);
+					xmlFree (value);
+				} else {
+					*(gchar **) field->value = (gchar *) value;
+				}
+				field->found = TRUE;
+			} else {
+				node = xmlTextReaderExpand (reader);
+				if (!node) {
+					continue;
+				}
+				gc_web_service_set_field (field, node);
+			}
+			walk->remaining--;
+		}
+	}
+	xmlFreeTextReader (reader);
+	
+	return walk->remaining == 0 || ret == 0;
+}
+
+/**
+ * gc_web_service_extract:
+ * @self: The #GcWebService object
+ * @fields: Array of #GcWebServiceField
+ * @n_fields: Number of elements in @fields
+ * 
+ * Extracts several values from the data that was fetched in the last 
+ * query in one pass over the document, instead of one 
+ * gc_web_service_get_* call (and one document traversal) per value. 
+ * For each field the first match of its XPath expression is stored in 
+ * @value: a newly allocated string or a double, depending on @type.
+ * @found tells whether a value was found; @value is left untouched 
+ * otherwise.
+ * 
+ * Simple location paths such as "//ns:parent/child[1]/@attr" are matched
+ * during the single pass; other expressions are evaluated separately.
+ * If all expressions are simple and the document has not been parsed 
+ * yet, the response is streamed through a pull parser instead of being
+ * parsed into a tree, and parsing stops once all fields are found.
+ *
+ * Return value: Number of fields found.
+ */
+guint
+gc_web_service_extract (GcWebService      *self,
+                        GcWebServiceField *fields,
+                        guint              n_fields)
+{
+	GcWebServiceWalk walk;
+	gboolean streamable = TRUE;
+	guint i, found = 0;
+	
+	g_return_val_if_fail (GC_IS_WEB_SERVICE (self), 0);
+	
+	for (i = 0; i < n_fields; i++) {
+		fields[i].found = FALSE;
+	}
+	if (!self->current) {
+		return 0;
+	}
+	
+	walk.self = self;
+	walk.fields = fields;
+	walk.n_fields = n_fields;
+	walk.remaining = n_fields;
+	walk.paths = g_new (const GcWebServicePath *, n_fields);
+	walk.stack = g_array_new (FALSE, FALSE, sizeof (GcWebServiceFrame));
+	walk.root_seen = NULL;
+	for (i = 0; i < n_fields; i++) {
+		walk.paths[i] = gc_web_service_get_path (fields[i].xpath);
+		if (walk.paths[i]->n_steps == 0) {
+			streamable = FALSE;
+		}
+	}
+	
+	if (!streamable || self->current->doc || 
+	    !gc_web_service_walk_stream (&walk)) {
+		/* start over on the tree */
+		for (i = 0; i < n_fields; i++) {
+			if (fields[i].found && fields[i].type == GC_WEB_SERVICE_FIELD_STRING) {
+				g_free (*(gchar **) fields[i].value);
+			}
+			fields[i].found = FALSE;
+		}
+		while (walk.stack->len > 0) {
+			gc_web_service_walk_pop (&walk);
+		}
+		g_slist_free (walk.root_seen);
+		walk.root_seen = NULL;
+		walk.remaining = n_fields;
+		
+		if (gc_web_service_build_xpath_context (self)) {
+			gc_web_service_walk_tree (&walk,
+			                          xmlDocGetRootElement (self->current->doc));
+		}
+	}
+	
+	for (i = 0; i < n_fields; i++) {
+		if (walk.paths[i]->n_steps == 0 && self->xpath_ctx) {
+			if (fields[i].type == GC_WEB_SERVICE_FIELD_DOUBLE) {
+				fields[i].found = gc_web_service_get_double (self, fields[i].value,
+				                                             (gchar *) fields[i].xpath);
+			} else {
+				fields[i].found = gc_web_service_get_string (self, fields[i].value,
+				                                             (gchar *) fields[i].xpath);
+			}
+		}
+		if (fields[i].found) {
+			found++;
+		}
+	}
+	
+	while (walk.stack->len > 0) {
+		gc_web_service_walk_pop (&walk);
+	}
+	g_slist_free (walk.root_seen);
+	g_array_free (walk.stack, TRUE);
+	g_free (walk.paths);
+	return found;
+}
+
 /**
  * gc_web_service_get_string:
  * @self: The #GcWebService object
@@ -428,8 +1494,9 @@ gc_web_service_get_string (GcWebService *self, gchar **value, gchar* xpath)
  * @response: returned guchar array
  * @response_length: length of the returned array
  * 
- * Returns the raw data fetched with the last call to 
- * gc_web_service_query(). Data may be unterminated.
+ * Returns a copy of the raw data fetched with the last call to 
+ * gc_web_service_query(). Data may be unterminated. 
+ * gc_web_service_get_response_bytes() avoids the copy.
  *
  * Return value: %TRUE on success.
  */
@@ -440,3 +1507,190 @@ gc_web_service_get_response (GcWebService *self, guchar **response, gint *respon
 	*response_length = self->response_length;
 	return TRUE;
 }
+
+/**
+ * gc_web_service_get_response_bytes:
+ * @self: The #GcWebService object
+ * 
+ * Returns the raw data fetched with the last query without copying it.
+ * The data is NUL-terminated just past its size, and stays valid until
+ * the returned reference is dropped, regardless of later queries.
+ *
+ * Return value: A new reference to the response data (free with 
+ * g_bytes_unref()), or %NULL if there is no response.
+ */
+GBytes *
+gc_web_service_get_response_bytes (GcWebService *self)
+{
+	g_return_val_if_fail (GC_IS_WEB_SERVICE (self), NULL);
+	
+	if (!self->current) {
+		return NULL;
+	}
+	return g_bytes_ref (self->current->bytes);
+}
+
+/**
+ * gc_web_service_set_cache:
+ * @self: The #GcWebService object
+ * @ttl: Time-to-live of cached responses in seconds, 0 disables the cache
+ * @max_bytes: Maximum size of the cached responses, 0 for a default
+ * 
+ * Enables (or disables) caching of responses. Responses are kept for 
+ * @ttl seconds; when the cache grows over @max_bytes, the least recently
+ * used responses are dropped. Changing the settings clears the cache.
+ * Caching is disabled by default.
+ */
+void
+gc_web_service_set_cache (GcWebService *self, guint ttl, gsize max_bytes)
+{
+	g_return_if_fail (GC_IS_WEB_SERVICE (self));
+	
+	if (max_bytes == 0) {
+		max_bytes = GC_WEB_SERVICE_DEFAULT_CACHE_SIZE;
+	}
+	if (self->cache) {
+		if (self->cache->ttl == ttl && self->cache->max_bytes == max_bytes) {
+			return;
+		}
+		gc_web_service_cache_free (self->cache);
+		self->cache = NULL;
+	}
+	if (ttl == 0) {
+		return;
+	}
+	
+	self->cache = g_new0 (GcWebServiceCache, 1);
+	self->cache->ttl = ttl;
+	self->cache->max_bytes = max_bytes;
+	self->cache->responses = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+	                                                (GDestroyNotify) gc_web_service_response_unref);
+	g_queue_init (&self->cache->lru);
+}
+
+/**
+ * gc_web_service_set_timeout:
+ * @self: The #GcWebService object
+ * @msecs: Deadline for each query in milliseconds, 0 for the default
+ * 
+ * Sets how long a query may take, including connecting and redirects.
+ * A query that takes longer is cancelled and fails with 
+ * %GEOCLUE_ERROR_NOT_AVAILABLE. A query, blocking or not, that joins 
+ * one already in flight keeps the deadline of the first one.
+ */
+void
+gc_web_service_set_timeout (GcWebService *self, guint msecs)
+{
+	g_return_if_fail (GC_IS_WEB_SERVICE (self));
+	
+	self->timeout = msecs > 0 ? msecs : GC_WEB_SERVICE_DEFAULT_TIMEOUT;
+}
+
+/**
+ * gc_web_service_set_options:
+ * @self: The #GcWebService object
+ * @options: Options hash table as given to SetOptions
+ * 
+ * Configures the web service from provider options: 
+ * "org.freedesktop.Geoclue.WebServiceCacheTTL" is the cache time-to-live 
+ * in seconds and "org.freedesktop.Geoclue.WebServiceCacheSize" the 
+ * maximum cache size in bytes. Caching is disabled if the TTL option is
+ * not set. "org.freedesktop.Geoclue.WebServiceTimeout" is the query 
+ * deadline in milliseconds.
+ */
+void
+gc_web_service_set_options (GcWebService *self, GHashTable *options)
+{
+	const char *ttl_str, *size_str, *timeout_str;
+	guint ttl = 0;
+	gsize max_bytes = 0;
+	guint timeout = 0;
+	
+	if (options) {
+		ttl_str = g_hash_table_lookup (options, GC_WEB_SERVICE_OPTION_CACHE_TTL);
+		size_str = g_hash_table_lookup (options, GC_WEB_SERVICE_OPTION_CACHE_SIZE);
+		timeout_str = g_hash_table_lookup (options, GC_WEB_SERVICE_OPTION_TIMEOUT);
+		if (ttl_str) {
+			ttl = strtoul (ttl_str, NULL, 10);
+		}
+		if (size_str) {
+			max_bytes = strtoul (size_str, NULL, 10);
+		}
+		if (timeout_str) {
+			timeout = strtoul (timeout_str, NULL, 10);
+		}
+	}
+	gc_web_service_set_cache (self, ttl, max_bytes);
+	gc_web_service_set_timeout (self, timeout);
+}
+
+/**
+ * gc_web_service_invalidate_cache:
+ * @self: The #GcWebService object
+ * @url_prefix: Drop only responses whose url starts with this, or %NULL
+ * 
+ * Drops cached responses, e.g. when the provider knows the answers it 
+ * got earlier are no longer valid. Data fetched with the last query 
+ * stays readable.
+ */
+void
+gc_web_service_invalidate_cache (GcWebService *self, const gchar *url_prefix)
+{
+	g_return_if_fail (GC_IS_WEB_SERVICE (self));
+	
+	if (self->cache) {
+		gc_web_service_cache_clear (self->cache, url_prefix);
+	}
+}
+
+/**
+ * gc_web_service_get_pool_stats:
+ * @connections: Return location for the number of connections requested
+ * @reused: Return location for the number of those served by an idle
+ * keep-alive connection
+ * @open_sockets: Return location for the number of open sockets
+ * 
+ * Reads the statistics of the keep-alive connection pool that all 
+ * #GcWebService objects in the process share. The reuse ratio is 
+ * @reused / @connections. Any of the return locations may be %NULL.
+ */
+void
+gc_web_service_get_pool_stats (guint *connections, guint *reused, guint *open_sockets)
+{
+	GcHttpPoolStats stats;
+	
+	gc_http_pool_get_stats (&stats);
+	if (connections) {
+		*connections = stats.requests;
+	}
+	if (reused) {
+		*reused = stats.reused;
+	}
+	if (open_sockets) {
+		*open_sockets = stats.open_sockets;
+	}
+}
+
+/**
+ * gc_web_service_get_transfer_stats:
+ * @wire_bytes: Return location for the number of bytes received
+ * @decoded_bytes: Return location for the size of the decoded responses
+ * 
+ * Reads the process wide transfer counters. @wire_bytes counts 
+ * everything read from the network, including headers and compressed 
+ * bodies; @decoded_bytes counts response bodies after gzip or deflate 
+ * decoding. Either return location may be %NULL.
+ */
+void
+gc_web_service_get_transfer_stats (guint64 *wire_bytes, guint64 *decoded_bytes)
+{
+	GcHttpPoolStats stats;
+	
+	gc_http_pool_get_stats (&stats);
+	if (wire_bytes) {
+		*wire_bytes = stats.bytes_received;
+	}
+	if (decoded_bytes) {
+		*decoded_bytes = stats.bytes_decoded;
+	}
+}
@@ -28,6 +28,10 @@
 
 G_BEGIN_DECLS
 
+#define GC_WEB_SERVICE_OPTION_CACHE_TTL "org.freedesktop.Geoclue.WebServiceCacheTTL"
+#define GC_WEB_SERVICE_OPTION_CACHE_SIZE "org.freedesktop.Geoclue.WebServiceCacheSize"
+#define GC_WEB_SERVICE_OPTION_TIMEOUT "org.freedesktop.Geoclue.WebServiceTimeout"
+
 #define GC_TYPE_WEB_SERVICE (gc_web_service_get_type ())
 
 #define GC_WEB_SERVICE(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GC_TYPE_WEB_SERVICE, GcWebService))
@@ -46,22 +50,55 @@ typedef struct _GcWebService {
 	gint response_length;
 	GList *namespaces;
 	xmlXPathContext *xpath_ctx;
+	struct _GcWebServiceResponse *current;
+	struct _GcWebServiceCache *cache;
+	guint timeout;
 } GcWebService;
 
 typedef struct _GcWebServiceClass {
 	GObjectClass parent_class;
 } GcWebServiceClass;
 
+typedef enum {
+	GC_WEB_SERVICE_FIELD_STRING,
+	GC_WEB_SERVICE_FIELD_DOUBLE
+} GcWebServiceFieldType;
+
+typedef struct _GcWebServiceField {
+	const gchar *xpath;
+	GcWebServiceFieldType type;
+	gpointer value;  /* gchar ** or gdouble * */
+	gboolean found;
+} GcWebServiceField;
+
+typedef void (*GcWebServiceCallback) (GcWebService *self,
+                                      GError       *error,
+                                      gpointer      user_data);
+
 GType gc_web_service_get_type (void);
 
 void gc_web_service_set_base_url (GcWebService *self, gchar *url);
 gboolean gc_web_service_add_namespace (GcWebService *self, gchar *namespace, gchar *uri);
 
 gboolean gc_web_service_query (GcWebService *self, GError **error, ...);
+gboolean gc_web_service_query_async (GcWebService         *self,
+                                     GcWebServiceCallback  callback,
+                                     gpointer              user_data,
+                                     ...);
 gboolean gc_web_service_get_string (GcWebService *self, gchar **value, gchar *xpath);
 gboolean gc_web_service_get_double (GcWebService *self, gdouble *value, gchar *xpath);
+guint gc_web_service_extract (GcWebService *self, GcWebServiceField *fields, guint n_fields);
 
 gboolean gc_web_service_get_response (GcWebService *self, guchar **response, gint *response_length);
+GBytes *gc_web_service_get_response_bytes (GcWebService *self);
+
+void gc_web_service_set_cache (GcWebService *self, guint ttl, gsize max_bytes);
+void gc_web_service_set_timeout (GcWebService *self, guint msecs);
+void gc_web_service_set_options (GcWebService *self, GHashTable *options);
+void gc_web_service_invalidate_cache (GcWebService *self, const gchar *url_prefix);
+
+void gc_web_service_get_pool_stats (guint *connections, guint *reused, guint *open_sockets);
+void gc_web_service_get_transfer_stats (guint64 *wire_bytes, guint64 *decoded_bytes);
 
 G_END_DECLS
 
@@ -31,12 +31,19 @@
  * accuracy. The last two will only be defined if #GeoclueAccuracyLevel is
  * %GEOCLUE_ACCURACY_LEVEL_DETAILED. These values should be set and queried 
  * using provided functions.
+ *
+ * A #GeoclueAccuracy is a plain structure. It is converted to its D-Bus
+ * wire form, a #GValueArray of type %GEOCLUE_ACCURACY_TYPE, only when a
+ * message is sent or received.
  **/
 
 #include <glib-object.h>
 
 #include <geoclue/geoclue-accuracy.h>
 
+G_DEFINE_BOXED_TYPE (GeoclueAccuracy, geoclue_accuracy,
+                     geoclue_accuracy_copy, geoclue_accuracy_free)
+
 /**
  * geoclue_accuracy_new:
  * @level: A #GeoclueAccuracyLevel
@@ -54,20 +61,14 @@ geoclue_accuracy_new (GeoclueAccuracyLevel level,
 		      double               horizontal_accuracy,
 		      double               vertical_accuracy)
 {
-	GValue accuracy_struct = {0, };
-
-	g_value_init (&accuracy_struct, GEOCLUE_ACCURACY_TYPE);
-	g_value_take_boxed (&accuracy_struct,
-			    dbus_g_type_specialized_construct
-			    (GEOCLUE_ACCURACY_TYPE));
-
-	dbus_g_type_struct_set (&accuracy_struct,
-				0, level,
-				1, horizontal_accuracy,
-				2, vertical_accuracy,
-				G_MAXUINT);
+	GeoclueAccuracy *accuracy;
+	
+	accuracy = g_slice_new (GeoclueAccuracy);
+	accuracy->level = level;
+	accuracy->horizontal_accuracy = horizontal_accuracy;
+	accuracy->vertical_accuracy = vertical_accuracy;
 	
-	return (GeoclueAccuracy *) g_value_get_boxed (&accuracy_struct);
+	return accuracy;
 }
 
 /**
@@ -83,7 +84,7 @@ geoclue_accuracy_free (GeoclueAccuracy *accuracy)
 		return;
 	}
 	
-        g_boxed_free (GEOCLUE_ACCURACY_TYPE, accuracy);
+	g_slice_free (GeoclueAccuracy, accuracy);
 }
 
 /**
@@ -102,17 +103,14 @@ geoclue_accuracy_get_details (GeoclueAccuracy      *accuracy,
 			      double               *horizontal_accuracy,
 			      double               *vertical_accuracy)
 {
-	GValueArray *vals;
-	
-	vals = accuracy;
 	if (level != NULL) {
-		*level = g_value_get_int (g_value_array_get_nth (vals, 0));
+		*level = accuracy->level;
 	}
 	if (horizontal_accuracy != NULL) {
-		*horizontal_accuracy = g_value_get_double (g_value_array_get_nth (vals, 1));
+		*horizontal_accuracy = accuracy->horizontal_accuracy;
 	}
 	if (vertical_accuracy != NULL) {
-		*vertical_accuracy = g_value_get_double (g_value_array_get_nth (vals, 2));
+		*vertical_accuracy = accuracy->vertical_accuracy;
 	}
 }
 
@@ -131,13 +129,9 @@ geoclue_accuracy_set_details (GeoclueAccuracy     *accuracy,
 			      double               horizontal_accuracy,
 			      double               vertical_accuracy)
 {
-	GValueArray *vals = accuracy;
-
-	g_value_set_int (g_value_array_get_nth (vals, 0), level);
-	g_value_set_double (g_value_array_get_nth (vals, 1), 
-			    horizontal_accuracy);
-	g_value_set_double (g_value_array_get_nth (vals, 2),
-			    vertical_accuracy);
+	accuracy->level = level;
+	accuracy->horizontal_accuracy = horizontal_accuracy;
+	accuracy->vertical_accuracy = vertical_accuracy;
 }
 
 /**
@@ -151,11 +145,83 @@ geoclue_accuracy_set_details (GeoclueAccuracy     *accuracy,
 GeoclueAccuracy *
 geoclue_accuracy_copy (GeoclueAccuracy *accuracy)
 {
-	GeoclueAccuracyLevel level;
-	double hor, ver;
+	return g_slice_dup (GeoclueAccuracy, accuracy);
+}
+
+/**
+ * geoclue_accuracy_new_from_value_array:
+ * @vals: A #GValueArray of type %GEOCLUE_ACCURACY_TYPE, as received over D-Bus
+ *
+ * Creates a #GeoclueAccuracy from its D-Bus wire form. @vals is not freed.
+ *
+ * Return value: A newly allocated #GeoclueAccuracy, or %NULL if @vals is %NULL
+ */
+GeoclueAccuracy *
+geoclue_accuracy_new_from_value_array (GValueArray *vals)
+{
+	GeoclueAccuracy *accuracy;
+	
+	if (!vals) {
+		return NULL;
+	}
+	
+	accuracy = g_slice_new (GeoclueAccuracy);
+	geoclue_accuracy_set_from_value_array (accuracy, vals);
+	return accuracy;
+}
+
+/**
+ * geoclue_accuracy_set_from_value_array:
+ * @accuracy: A #GeoclueAccuracy
+ * @vals: A #GValueArray of type %GEOCLUE_ACCURACY_TYPE or %NULL
+ *
+ * Replaces @accuracy values with the ones in @vals, so that a received
+ * accuracy can be read into a #GeoclueAccuracy on the stack. A %NULL 
+ * @vals sets %GEOCLUE_ACCURACY_LEVEL_NONE.
+ */
+void
+geoclue_accuracy_set_from_value_array (GeoclueAccuracy *accuracy,
+                                       GValueArray     *vals)
+{
+	if (!vals) {
+		geoclue_accuracy_set_details (accuracy, GEOCLUE_ACCURACY_LEVEL_NONE, 
+		                              0.0, 0.0);
+		return;
+	}
+	
+	geoclue_accuracy_set_details (accuracy,
+	                              g_value_get_int (g_value_array_get_nth (vals, 0)),
+	                              g_value_get_double (g_value_array_get_nth (vals, 1)),
+	                              g_value_get_double (g_value_array_get_nth (vals, 2)));
+}
+
+/**
+ * geoclue_accuracy_to_value_array:
+ * @accuracy: A #GeoclueAccuracy or %NULL
+ *
+ * Creates the D-Bus wire form of @accuracy. A %NULL @accuracy is sent 
+ * as %GEOCLUE_ACCURACY_LEVEL_NONE. Free the result with 
+ * g_boxed_free (%GEOCLUE_ACCURACY_TYPE, ...).
+ *
+ * Return value: A newly allocated #GValueArray of type %GEOCLUE_ACCURACY_TYPE
+ */
+GValueArray *
+geoclue_accuracy_to_value_array (GeoclueAccuracy *accuracy)
+{
+	GValue accuracy_struct = {0, };
+
+	g_value_init (&accuracy_struct, GEOCLUE_ACCURACY_TYPE);
+	g_value_take_boxed (&accuracy_struct,
+			    dbus_g_type_specialized_construct
+			    (GEOCLUE_ACCURACY_TYPE));
+
+	dbus_g_type_struct_set (&accuracy_struct,
+				0, accuracy ? accuracy->level : GEOCLUE_ACCURACY_LEVEL_NONE,
+				1, accuracy ? accuracy->horizontal_accuracy : 0.0,
+				2, accuracy ? accuracy->vertical_accuracy : 0.0,
+				G_MAXUINT);
 	
-	geoclue_accuracy_get_details (accuracy, &level, &hor, &ver);
-	return geoclue_accuracy_new (level, hor, ver);
+	return (GValueArray *) g_value_get_boxed (&accuracy_struct);
 }
 
 /**
@@ -32,9 +32,18 @@
 
 G_BEGIN_DECLS
 
+/* the D-Bus wire form of a GeoclueAccuracy */
 #define GEOCLUE_ACCURACY_TYPE (dbus_g_type_get_struct ("GValueArray", G_TYPE_INT, G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_INVALID))
 
-typedef GValueArray GeoclueAccuracy;
+#define GEOCLUE_TYPE_ACCURACY (geoclue_accuracy_get_type ())
+
+typedef struct _GeoclueAccuracy {
+	GeoclueAccuracyLevel level;
+	double horizontal_accuracy;
+	double vertical_accuracy;
+} GeoclueAccuracy;
+
+GType geoclue_accuracy_get_type (void);
 
 GeoclueAccuracy *geoclue_accuracy_new (GeoclueAccuracyLevel level,
 				       double               horizontal_accuracy,
@@ -51,6 +60,11 @@ void geoclue_accuracy_set_details (GeoclueAccuracy      *accuracy,
 
 GeoclueAccuracy *geoclue_accuracy_copy (GeoclueAccuracy *accuracy);
 
+GeoclueAccuracy *geoclue_accuracy_new_from_value_array (GValueArray *vals);
+void geoclue_accuracy_set_from_value_array (GeoclueAccuracy *accuracy,
+                                            GValueArray     *vals);
+GValueArray *geoclue_accuracy_to_value_array (GeoclueAccuracy *accuracy);
+
 G_END_DECLS
 
 #endif
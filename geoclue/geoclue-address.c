@@ -77,11 +77,14 @@ static void
 address_changed (DBusGProxy      *proxy,
 		 int              timestamp,
 		 GHashTable      *details,
-		 GeoclueAccuracy *accuracy,
-		 GeoclueAddress *address)
+		 GValueArray     *vals,
+		 GeoclueAddress  *address)
 {
+	GeoclueAccuracy accuracy;
+	
+	geoclue_accuracy_set_from_value_array (&accuracy, vals);
 	g_signal_emit (address, signals[ADDRESS_CHANGED], 0, 
-		       timestamp, details, accuracy);
+		       timestamp, details, &accuracy);
 }
 
 static GObject *
@@ -198,13 +201,19 @@ geoclue_address_get_address (GeoclueAddress   *address,
 			     GError          **error)
 {
 	GeoclueProvider *provider = GEOCLUE_PROVIDER (address);
+	GValueArray *acc;
 
 	if (!org_freedesktop_Geoclue_Address_get_address (provider->proxy,
 							  timestamp, details,
-							  accuracy, error)) {
+							  &acc, error)) {
 		return FALSE;
 	}
 
+	if (accuracy != NULL) {
+		*accuracy = geoclue_accuracy_new_from_value_array (acc);
+	}
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, acc);
+
 	return TRUE;
 }
 
@@ -219,10 +228,16 @@ static void
 get_address_async_callback (DBusGProxy              *proxy, 
 			    int                      timestamp,
 			    GHashTable              *details,
-			    GeoclueAccuracy         *accuracy,
+			    GValueArray             *vals,
 			    GError                  *error,
 			    GeoclueAddressAsyncData *data)
 {
+	GeoclueAccuracy *accuracy = NULL;
+	
+	if (!error) {
+		accuracy = geoclue_accuracy_new_from_value_array (vals);
+		g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
+	}
 	(*(GeoclueAddressCallback)data->callback) (data->address,
 	                                           timestamp,
 	                                           details,
@@ -138,7 +138,7 @@ geoclue_geocode_address_to_position (GeoclueGeocode   *geocode,
 	GeoclueProvider *provider = GEOCLUE_PROVIDER (geocode);
 	int fields;
 	double la, lo, al;
-	GeoclueAccuracy *acc;
+	GValueArray *acc;
 	
 	if (!org_freedesktop_Geoclue_Geocode_address_to_position (provider->proxy,
 								  details, &fields,
@@ -160,8 +160,9 @@ geoclue_geocode_address_to_position (GeoclueGeocode   *geocode,
 	}
 
 	if (accuracy != NULL) {
-		*accuracy = acc;
+		*accuracy = geoclue_accuracy_new_from_value_array (acc);
 	}
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, acc);
 
 	return fields;
 }
@@ -178,10 +179,16 @@ address_to_position_callback (DBusGProxy              *proxy,
 			      double                   latitude,
 			      double                   longitude,
 			      double                   altitude,
-			      GeoclueAccuracy         *accuracy,
+			      GValueArray             *vals,
 			      GError                  *error,
 			      GeoclueGeocodeAsyncData *data)
 {
+	GeoclueAccuracy *accuracy = NULL;
+	
+	if (!error) {
+		accuracy = geoclue_accuracy_new_from_value_array (vals);
+		g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
+	}
 	(*(GeoclueGeocodeCallback)data->callback) (data->geocode,
 	                                           fields,
 	                                           latitude,
@@ -273,7 +280,7 @@ geoclue_geocode_freeform_address_to_position (GeoclueGeocode   *geocode,
 	GeoclueProvider *provider = GEOCLUE_PROVIDER (geocode);
 	int fields;
 	double la, lo, al;
-	GeoclueAccuracy *acc;
+	GValueArray *acc;
 
 	if (!org_freedesktop_Geoclue_Geocode_freeform_address_to_position
 			(provider->proxy,
@@ -296,8 +303,9 @@ geoclue_geocode_freeform_address_to_position (GeoclueGeocode   *geocode,
 	}
 
 	if (accuracy != NULL) {
-		*accuracy = acc;
+		*accuracy = geoclue_accuracy_new_from_value_array (acc);
 	}
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, acc);
 
 	return fields;
 }
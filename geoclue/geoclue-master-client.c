@@ -333,7 +333,7 @@ geoclue_master_client_init (GeoclueMasterClient *client)
  * geoclue_master_client_set_requirements:
  * @client: A #GeoclueMasterClient
  * @min_accuracy: The required minimum accuracy as a #GeoclueAccuracyLevel.
- * @min_time: The minimum time between update signals (currently not implemented)
+ * @min_time: The minimum time between update signals in seconds, 0 for no limit. Updates arriving faster are coalesced and only the latest one is sent
  * @require_updates: Whether the updates (signals) are required. Only applies to interfaces with signals
  * @allowed_resources: The resources that are allowed to be used as a #GeoclueResourceFlags
  * @error: A pointer to returned #GError or %NULL.
@@ -385,7 +385,7 @@ set_requirements_callback (DBusGProxy                   *proxy,
  * geoclue_master_client_set_requirements_async:
  * @client: A #GeoclueMasterClient
  * @min_accuracy: The required minimum accuracy as a #GeoclueAccuracyLevel.
- * @min_time: The minimum time between update signals (currently not implemented)
+ * @min_time: The minimum time between update signals in seconds, 0 for no limit. Updates arriving faster are coalesced and only the latest one is sent
  * @require_updates: Whether the updates (signals) are required. Only applies to interfaces with signals
  * @allowed_resources: The resources that are allowed to be used as a #GeoclueResourceFlags
  * @callback: #GeoclueSetRequirementsCallback function to call when requirements have been set
@@ -420,6 +420,151 @@ geoclue_master_client_set_requirements_async (GeoclueMasterClient           *cli
 			 data);
 }
 
+/**
+ * geoclue_master_client_set_allow_old_data:
+ * @client: A #GeoclueMasterClient
+ * @allow_old_data: Whether old data may be returned
+ * @max_age: Maximum age of returned data in seconds, or 0 for any age
+ * @error: A pointer to returned #GError or %NULL.
+ *
+ * Lets the master answer position and address queries with the last 
+ * data it got from a provider, as long as it is not older than 
+ * @max_age. The data is refreshed in the background after such an 
+ * answer. Clients can tell old data by its timestamp. Old data is 
+ * also returned when no provider is currently available.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+geoclue_master_client_set_allow_old_data (GeoclueMasterClient  *client,
+                                          gboolean              allow_old_data,
+                                          int                   max_age,
+                                          GError              **error)
+{
+	GeoclueMasterClientPrivate *priv;
+
+	priv = GET_PRIVATE (client);
+	if (!org_freedesktop_Geoclue_MasterClient_set_allow_old_data 
+	    (priv->proxy, allow_old_data, max_age, error)) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * geoclue_master_client_set_position_fusion:
+ * @client: A #GeoclueMasterClient
+ * @enable: Whether positions of all providers should be combined
+ * @error: A pointer to returned #GError or %NULL.
+ *
+ * Makes the master use every position provider that meets the 
+ * requirements, instead of only the best available one, and combine 
+ * their positions into one estimate. The estimate gets more accurate 
+ * as more providers agree, and is updated whenever any of them 
+ * reports a position. The accuracy of the estimate is the standard 
+ * deviation in meters. Running all providers uses more resources.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+geoclue_master_client_set_position_fusion (GeoclueMasterClient  *client,
+                                           gboolean              enable,
+                                           GError              **error)
+{
+	GeoclueMasterClientPrivate *priv;
+
+	priv = GET_PRIVATE (client);
+	if (!org_freedesktop_Geoclue_MasterClient_set_position_fusion 
+	    (priv->proxy, enable, error)) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * geoclue_master_client_set_position_thresholds:
+ * @client: A #GeoclueMasterClient
+ * @min_distance: Distance in meters the position must move, or 0
+ * @min_interval: Time in seconds that must pass, or 0
+ * @error: A pointer to returned #GError or %NULL.
+ *
+ * Limits the "position-changed" signals of the client to positions 
+ * that are at least @min_distance meters and @min_interval seconds 
+ * away from the last one emitted. Positions with different fields or 
+ * accuracy level are always emitted, as are the ones sent when the 
+ * position provider changes. By default every position is emitted.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+geoclue_master_client_set_position_thresholds (GeoclueMasterClient  *client,
+                                               double                min_distance,
+                                               int                   min_interval,
+                                               GError              **error)
+{
+	GeoclueMasterClientPrivate *priv;
+
+	priv = GET_PRIVATE (client);
+	if (!org_freedesktop_Geoclue_MasterClient_set_position_thresholds 
+	    (priv->proxy, min_distance, min_interval, error)) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * geoclue_master_client_get_position_history:
+ * @client: A #GeoclueMasterClient
+ * @since: Unix time of the oldest position to return
+ * @max: Maximum number of positions to return (the newest ones), or 0 for all
+ * @fields: Return location for a #GArray of #GeocluePositionFields (int)
+ * @timestamps: Return location for a #GArray of timestamps (int)
+ * @latitudes: Return location for a #GArray of latitudes (double)
+ * @longitudes: Return location for a #GArray of longitudes (double)
+ * @altitudes: Return location for a #GArray of altitudes (double)
+ * @accuracy_levels: Return location for a #GArray of #GeoclueAccuracyLevel (int)
+ * @horizontal_accuracies: Return location for a #GArray of horizontal accuracies (double)
+ * @vertical_accuracies: Return location for a #GArray of vertical accuracies (double)
+ * @error: A pointer to returned #GError or %NULL.
+ *
+ * Gets the positions the current position provider has reported since
+ * @since, oldest first. Element i of each array belongs to the i:th 
+ * position. The master keeps a limited number of positions per 
+ * provider. The arrays should be freed with g_array_free().
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+geoclue_master_client_get_position_history (GeoclueMasterClient  *client,
+                                            int                   since,
+                                            int                   max,
+                                            GArray              **fields,
+                                            GArray              **timestamps,
+                                            GArray              **latitudes,
+                                            GArray              **longitudes,
+                                            GArray              **altitudes,
+                                            GArray              **accuracy_levels,
+                                            GArray              **horizontal_accuracies,
+                                            GArray              **vertical_accuracies,
+                                            GError              **error)
+{
+	GeoclueMasterClientPrivate *priv;
+
+	priv = GET_PRIVATE (client);
+	if (!org_freedesktop_Geoclue_MasterClient_get_position_history 
+	    (priv->proxy, since, max, 
+	     fields, timestamps, latitudes, longitudes, altitudes,
+	     accuracy_levels, horizontal_accuracies, vertical_accuracies,
+	     error)) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 /**
  * geoclue_master_client_create_address:
  * @client: A #GeoclueMasterClient
@@ -77,6 +77,33 @@ void geoclue_master_client_set_requirements_async (GeoclueMasterClient
 						   GeoclueSetRequirementsCallback callback,
 						   gpointer                       userdata);
 
+gboolean geoclue_master_client_set_allow_old_data (GeoclueMasterClient  *client,
+                                                   gboolean              allow_old_data,
+                                                   int                   max_age,
+                                                   GError              **error);
+
+gboolean geoclue_master_client_set_position_fusion (GeoclueMasterClient  *client,
+                                                    gboolean              enable,
+                                                    GError              **error);
+
+gboolean geoclue_master_client_set_position_thresholds (GeoclueMasterClient  *client,
+                                                        double                min_distance,
+                                                        int                   min_interval,
+                                                        GError              **error);
+
+gboolean geoclue_master_client_get_position_history (GeoclueMasterClient  *client,
+                                                     int                   since,
+                                                     int                   max,
+                                                     GArray              **fields,
+                                                     GArray              **timestamps,
+                                                     GArray              **latitudes,
+                                                     GArray              **longitudes,
+                                                     GArray              **altitudes,
+                                                     GArray              **accuracy_levels,
+                                                     GArray              **horizontal_accuracies,
+                                                     GArray              **vertical_accuracies,
+                                                     GError              **error);
+
 GeoclueAddress *geoclue_master_client_create_address (GeoclueMasterClient *client, GError **error);
 typedef void (*CreateAddressCallback) (GeoclueMasterClient *client,
 				       GeoclueAddress      *address,
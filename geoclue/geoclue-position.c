@@ -75,11 +75,14 @@ position_changed (DBusGProxy      *proxy,
 		  double           latitude,
 		  double           longitude,
 		  double           altitude,
-		  GeoclueAccuracy *accuracy,
+		  GValueArray     *vals,
 		  GeocluePosition *position)
 {
+	GeoclueAccuracy accuracy;
+	
+	geoclue_accuracy_set_from_value_array (&accuracy, vals);
 	g_signal_emit (position, signals[POSITION_CHANGED], 0, fields,
-		       timestamp, latitude, longitude, altitude, accuracy);
+		       timestamp, latitude, longitude, altitude, &accuracy);
 }
 
 static GObject *
@@ -200,7 +203,7 @@ geoclue_position_get_position (GeocluePosition  *position,
 	GeoclueProvider *provider = GEOCLUE_PROVIDER (position);
 	double la, lo, al;
 	int ts, fields;
-	GeoclueAccuracy *acc;
+	GValueArray *acc;
 	if (!org_freedesktop_Geoclue_Position_get_position (provider->proxy,
 							    &fields, &ts,
 							    &la, &lo, &al,
@@ -225,8 +228,9 @@ geoclue_position_get_position (GeocluePosition  *position,
 	}
 
 	if (accuracy != NULL) {
-		*accuracy = acc;
+		*accuracy = geoclue_accuracy_new_from_value_array (acc);
 	}
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, acc);
 
 	return fields;
 }
@@ -245,10 +249,16 @@ get_position_async_callback (DBusGProxy               *proxy,
 			     double                    latitude,
 			     double                    longitude,
 			     double                    altitude,
-			     GeoclueAccuracy          *accuracy,
+			     GValueArray              *vals,
 			     GError                   *error,
 			     GeocluePositionAsyncData *data)
 {
+	GeoclueAccuracy *accuracy = NULL;
+	
+	if (!error) {
+		accuracy = geoclue_accuracy_new_from_value_array (vals);
+		g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
+	}
 	(*(GeocluePositionCallback)data->callback) (data->position,
 	                                            fields,
 	                                            timestamp,
@@ -128,10 +128,24 @@ geoclue_reverse_geocode_position_to_address (GeoclueReverseGeocode   *geocode,
 					     GError                 **error)
 {
 	GeoclueProvider *provider = GEOCLUE_PROVIDER (geocode);
+	GValueArray *pos_acc, *addr_acc;
+	gboolean ret;
 	
-	return org_freedesktop_Geoclue_ReverseGeocode_position_to_address 
-		(provider->proxy, latitude, longitude, position_accuracy, 
-		 details, address_accuracy, error);
+	pos_acc = geoclue_accuracy_to_value_array (position_accuracy);
+	ret = org_freedesktop_Geoclue_ReverseGeocode_position_to_address 
+		(provider->proxy, latitude, longitude, pos_acc, 
+		 details, &addr_acc, error);
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, pos_acc);
+	if (!ret) {
+		return FALSE;
+	}
+	
+	if (address_accuracy != NULL) {
+		*address_accuracy = geoclue_accuracy_new_from_value_array (addr_acc);
+	}
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, addr_acc);
+	
+	return TRUE;
 }
 
 
@@ -144,10 +158,16 @@ typedef struct _GeoclueRevGeocodeAsyncData {
 static void
 position_to_address_callback (DBusGProxy                 *proxy, 
 			      GHashTable                 *details,
-			      GeoclueAccuracy            *accuracy,
+			      GValueArray                *vals,
 			      GError                     *error,
 			      GeoclueRevGeocodeAsyncData *data)
 {
+	GeoclueAccuracy *accuracy = NULL;
+	
+	if (!error) {
+		accuracy = geoclue_accuracy_new_from_value_array (vals);
+		g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
+	}
 	(*(GeoclueReverseGeocodeCallback)data->callback) (data->revgeocode,
 	                                                  details,
 	                                                  accuracy,
@@ -192,17 +212,21 @@ geoclue_reverse_geocode_position_to_address_async (GeoclueReverseGeocode
 {
 	GeoclueProvider *provider = GEOCLUE_PROVIDER (revgeocode);
 	GeoclueRevGeocodeAsyncData *data;
+	GValueArray *vals;
 	
 	data = g_new (GeoclueRevGeocodeAsyncData, 1);
 	data->revgeocode = revgeocode;
 	data->callback = G_CALLBACK (callback);
 	data->userdata = userdata;
 	
+	/* the message is built before the call returns */
+	vals = geoclue_accuracy_to_value_array (accuracy);
 	org_freedesktop_Geoclue_ReverseGeocode_position_to_address_async
 			(provider->proxy,
 			 latitude,
 			 longitude,
-			 accuracy,
+			 vals,
 			 (org_freedesktop_Geoclue_ReverseGeocode_position_to_address_reply)position_to_address_callback,
 			 data);
+	g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
 }
@@ -123,6 +123,13 @@ geoclue_geonames_address_to_position (GcIfaceGeocode        *iface,
 {
 	GeoclueGeonames *obj = GEOCLUE_GEONAMES (iface);
 	gchar *countrycode, *locality, *postalcode;
+	GcWebServiceField position[] = {
+		{ NULL, GC_WEB_SERVICE_FIELD_DOUBLE },
+		{ NULL, GC_WEB_SERVICE_FIELD_DOUBLE },
+	};
+	
+	position[0].value = latitude;
+	position[1].value = longitude;
 	
 	countrycode = g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_COUNTRYCODE);
 	locality = g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_LOCALITY);
@@ -139,10 +146,10 @@ geoclue_geonames_address_to_position (GcIfaceGeocode        *iface,
 		                           (char *)0)) {
 			return FALSE;
 		}
-		if (gc_web_service_get_double (obj->postalcode_geocoder, 
-		                               latitude, POSTALCODE_LAT) &&
-		    gc_web_service_get_double (obj->postalcode_geocoder, 
-		                               longitude, POSTALCODE_LON)) {
+		position[0].xpath = POSTALCODE_LAT;
+		position[1].xpath = POSTALCODE_LON;
+		if (gc_web_service_extract (obj->postalcode_geocoder, 
+		                            position, G_N_ELEMENTS (position)) == 2) {
 			*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
 			*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
 			*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_POSTALCODE,
@@ -157,10 +164,10 @@ geoclue_geonames_address_to_position (GcIfaceGeocode        *iface,
 		                           (char *)0)) {
 			return FALSE;
 		}
-		if (gc_web_service_get_double (obj->place_geocoder, 
-		                               latitude, GEONAME_LAT) &&
-		    gc_web_service_get_double (obj->place_geocoder, 
-		                               longitude, GEONAME_LON)) {
+		position[0].xpath = GEONAME_LAT;
+		position[1].xpath = GEONAME_LON;
+		if (gc_web_service_extract (obj->place_geocoder, 
+		                            position, G_N_ELEMENTS (position)) == 2) {
 			*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
 			*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
 			*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_LOCALITY,
@@ -184,6 +191,16 @@ geoclue_geonames_freeform_address_to_position (GcIfaceGeocode        *iface,
                                                GError               **error)
 {
 	GeoclueGeonames *obj = GEOCLUE_GEONAMES (iface);
+	char *fclass = NULL;
+	GcWebServiceField result[] = {
+		{ GEONAME_LAT, GC_WEB_SERVICE_FIELD_DOUBLE },
+		{ GEONAME_LON, GC_WEB_SERVICE_FIELD_DOUBLE },
+		{ GEONAME_FEATURE_CLASS, GC_WEB_SERVICE_FIELD_STRING },
+	};
+
+	result[0].value = latitude;
+	result[1].value = longitude;
+	result[2].value = &fclass;
 
 	if (fields) {
 		*fields = GEOCLUE_POSITION_FIELDS_NONE;
@@ -197,31 +214,26 @@ geoclue_geonames_freeform_address_to_position (GcIfaceGeocode        *iface,
 		                           (char *)0)) {
 			return FALSE;
 		}
-		if (gc_web_service_get_double (obj->place_geocoder,
-		                               latitude, GEONAME_LAT) &&
-			gc_web_service_get_double (obj->place_geocoder,
-			                           longitude, GEONAME_LON)) {
+		gc_web_service_extract (obj->place_geocoder,
+		                        result, G_N_ELEMENTS (result));
+		if (result[0].found && result[1].found) {
 			if (fields) {
 				*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
 				*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
 			}
 			if (accuracy) {
-				char *fclass = NULL;
 				GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
 
 				/* this is crude but should cover most results from geonames */
-				if (gc_web_service_get_string (obj->place_geocoder,
-				                               &fclass, GEONAME_FEATURE_CLASS)) {
-					if (g_strcmp0 (fclass, "A") == 0) {
-						level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
-					}else if (g_strcmp0 (fclass, "P") == 0) {
-						level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
-					}
-					g_free (fclass);
+				if (g_strcmp0 (fclass, "A") == 0) {
+					level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
+				}else if (g_strcmp0 (fclass, "P") == 0) {
+					level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
 				}
 				*accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
 			}
 		}
+		g_free (fclass);
 	}
 
 	if (accuracy && *accuracy == NULL) {
@@ -248,6 +260,12 @@ geoclue_geonames_position_to_address (GcIfaceReverseGeocode  *iface,
 	gchar *region = NULL;
 	gchar *country = NULL;
 	gchar *countrycode = NULL;
+	GcWebServiceField fields[] = {
+		{ GEONAME_COUNTRYCODE, GC_WEB_SERVICE_FIELD_STRING },
+		{ GEONAME_COUNTRY, GC_WEB_SERVICE_FIELD_STRING },
+		{ GEONAME_ADMIN1, GC_WEB_SERVICE_FIELD_STRING },
+		{ GEONAME_NAME, GC_WEB_SERVICE_FIELD_STRING },
+	};
 	GeoclueAccuracyLevel in_acc = GEOCLUE_ACCURACY_LEVEL_DETAILED;
 	
 	if (!address) {
@@ -277,40 +295,38 @@ geoclue_geonames_position_to_address (GcIfaceReverseGeocode  *iface,
 	
 	*address = g_hash_table_new (g_str_hash, g_str_equal);
 	
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
-	                               &countrycode, GEONAME_COUNTRYCODE)) {
+	fields[0].value = &countrycode;
+	fields[1].value = &country;
+	fields[2].value = &region;
+	fields[3].value = &locality;
+	gc_web_service_extract (obj->rev_place_geocoder, fields, G_N_ELEMENTS (fields));
+	
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && countrycode) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
 		                                countrycode);
-		g_free (countrycode);
 		geoclue_address_details_set_country_from_code (*address);
 	}
 	if (!g_hash_table_lookup (*address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
-	    in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
-	                               &country, GEONAME_COUNTRY)) {
+	    in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && country) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRY,
 		                                country);
-		g_free (country);
 	}
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_REGION && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
-	                               &region, GEONAME_ADMIN1)) {
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_REGION && region) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_REGION,
 		                                region);
-		g_free (region);
 	}
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_LOCALITY && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
-	                               &locality, GEONAME_NAME)) {
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_LOCALITY && locality) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_LOCALITY,
 		                                locality);
-		g_free (locality);
 	}
+	g_free (countrycode);
+	g_free (country);
+	g_free (region);
+	g_free (locality);
 	
 	if (address_accuracy) { 
 		GeoclueAccuracyLevel level = geoclue_address_details_get_accuracy_level (*address);
@@ -353,6 +369,20 @@ geoclue_geonames_dispose (GObject *obj)
 	((GObjectClass *) geoclue_geonames_parent_class)->dispose (obj);
 }
 
+static gboolean
+set_options (GcIfaceGeoclue *gc,
+             GHashTable     *options,
+             GError        **error)
+{
+	GeoclueGeonames *obj = GEOCLUE_GEONAMES (gc);
+	
+	gc_web_service_set_options (obj->place_geocoder, options);
+	gc_web_service_set_options (obj->postalcode_geocoder, options);
+	gc_web_service_set_options (obj->rev_place_geocoder, options);
+	gc_web_service_set_options (obj->rev_street_geocoder, options);
+	return TRUE;
+}
+
 /* Initialization */
 
 static void
@@ -363,6 +393,7 @@ geoclue_geonames_class_init (GeoclueGeonamesClass *klass)
 	
 	p_class->shutdown = shutdown;
 	p_class->get_status = geoclue_geonames_get_status;
+	p_class->set_options = set_options;
 
 	o_class->finalize = geoclue_geonames_finalize;
 	o_class->dispose = geoclue_geonames_dispose;
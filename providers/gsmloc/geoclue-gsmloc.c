@@ -86,6 +86,7 @@ struct _GeoclueGsmloc {
 	GeoclueAccuracyLevel last_accuracy_level;
 	double last_lat;
 	double last_lon;
+	int pending_queries;
 
 	GHashTable *address;
 };
@@ -135,49 +136,13 @@ shutdown (GcProvider *provider)
 	g_main_loop_quit (gsmloc->loop);
 }
 
-static gboolean
-geoclue_gsmloc_query_opencellid (GeoclueGsmloc *gsmloc)
+static void
+geoclue_gsmloc_set_position (GeoclueGsmloc         *gsmloc,
+                             GeocluePositionFields  fields,
+                             double                 lat,
+                             double                 lon,
+                             GeoclueAccuracyLevel   level)
 {
-	double lat, lon;
-	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
-	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
-
-	if (gsmloc->mcc && gsmloc->mnc &&
-	    gsmloc->lac && gsmloc->cid) {
-
-		if (gc_web_service_query (gsmloc->web_service, NULL,
-		                          "mcc", gsmloc->mcc,
-		                          "mnc", gsmloc->mnc,
-		                          "lac", gsmloc->lac,
-		                          "cellid", gsmloc->cid,
-		                          (char *)0)) {
-
-			if (gc_web_service_get_double (gsmloc->web_service, 
-			                               &lat, OPENCELLID_LAT)) {
-				fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-			}
-			if (gc_web_service_get_double (gsmloc->web_service, 
-			                               &lon, OPENCELLID_LON)) {
-				fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
-			}
-
-			if (fields != GEOCLUE_POSITION_FIELDS_NONE) {
-				char *retval_cid;
-				/* if cellid is not present, location is for the local area code.
-				 * the accuracy might be an overstatement -- I have no idea how 
-				 * big LACs typically are */
-				level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
-				if (gc_web_service_get_string (gsmloc->web_service, 
-				                               &retval_cid, OPENCELLID_CID)) {
-					if (retval_cid && strlen (retval_cid) != 0) {
-						level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
-					}
-					g_free (retval_cid);
-				}
-			}
-		}
-	}
-
 	if (fields != gsmloc->last_position_fields ||
 	    (fields != GEOCLUE_POSITION_FIELDS_NONE &&
 	     (lat != gsmloc->last_lat ||
@@ -199,10 +164,78 @@ geoclue_gsmloc_query_opencellid (GeoclueGsmloc *gsmloc)
 		                                         lat, lon, 0.0,
 		                                         acc);
 		geoclue_accuracy_free (acc);
-		return TRUE;
+	}
+}
+
+static void
+geoclue_gsmloc_opencellid_done (GcWebService *web_service,
+                                GError       *error,
+                                gpointer      user_data)
+{
+	GeoclueGsmloc *gsmloc = user_data;
+	double lat = 0.0, lon = 0.0;
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+
+	gsmloc->pending_queries--;
+	if (gsmloc->pending_queries > 0) {
+		/* cell has changed since this query was made, 
+		 * the latest query will update the position */
+		return;
+	}
+
+	if (!error) {
+		if (gc_web_service_get_double (web_service, 
+		                               &lat, OPENCELLID_LAT)) {
+			fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+		}
+		if (gc_web_service_get_double (web_service, 
+		                               &lon, OPENCELLID_LON)) {
+			fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
+		}
+
+		if (fields != GEOCLUE_POSITION_FIELDS_NONE) {
+			char *retval_cid;
+			/* if cellid is not present, location is for the local area code.
+			 * the accuracy might be an overstatement -- I have no idea how 
+			 * big LACs typically are */
+			level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
+			if (gc_web_service_get_string (web_service, 
+			                               &retval_cid, OPENCELLID_CID)) {
+				if (retval_cid && strlen (retval_cid) != 0) {
+					level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
+				}
+				g_free (retval_cid);
+			}
+		}
+	}
+
+	geoclue_gsmloc_set_position (gsmloc, fields, lat, lon, level);
+}
+
+/* Starts an opencellid lookup for the current cell. Position-changed 
+ * is emitted from the main loop when the answer arrives. */
+static void
+geoclue_gsmloc_query_opencellid (GeoclueGsmloc *gsmloc)
+{
+	if (gsmloc->mcc && gsmloc->mnc &&
+	    gsmloc->lac && gsmloc->cid) {
+
+		if (gc_web_service_query_async (gsmloc->web_service,
+		                                geoclue_gsmloc_opencellid_done,
+		                                gsmloc,
+		                                "mcc", gsmloc->mcc,
+		                                "mnc", gsmloc->mnc,
+		                                "lac", gsmloc->lac,
+		                                "cellid", gsmloc->cid,
+		                                (char *)0)) {
+			gsmloc->pending_queries++;
+		}
+		return;
 	}
 
-	return FALSE;
+	geoclue_gsmloc_set_position (gsmloc, GEOCLUE_POSITION_FIELDS_NONE,
+	                             0.0, 0.0, GEOCLUE_ACCURACY_LEVEL_NONE);
 }
 
 static void
@@ -298,8 +331,10 @@ geoclue_gsmloc_get_position (GcIfacePosition        *iface,
 
 	gsmloc = (GEOCLUE_GSMLOC (iface));
 
-	if (gsmloc->last_position_fields == GEOCLUE_POSITION_FIELDS_NONE) {
-		/* re-query in case there was a network problem */
+	if (gsmloc->last_position_fields == GEOCLUE_POSITION_FIELDS_NONE &&
+	    gsmloc->pending_queries == 0) {
+		/* re-query in case there was a network problem, the 
+		 * result will be delivered with position-changed */
 		geoclue_gsmloc_query_opencellid (gsmloc);
 	}
 
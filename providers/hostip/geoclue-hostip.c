@@ -78,6 +78,17 @@ shutdown (GcProvider *provider)
 	g_main_loop_quit (obj->loop);
 }
 
+static gboolean
+set_options (GcIfaceGeoclue *gc,
+             GHashTable     *options,
+             GError        **error)
+{
+	GeoclueHostip *obj = GEOCLUE_HOSTIP (gc);
+	
+	gc_web_service_set_options (obj->web_service, options);
+	return TRUE;
+}
+
 /* Position interface implementation */
 
 static gboolean 
@@ -226,6 +237,7 @@ geoclue_hostip_class_init (GeoclueHostipClass *klass)
 	
 	p_class->shutdown = shutdown;
 	p_class->get_status = geoclue_hostip_get_status;
+	p_class->set_options = set_options;
 	
 	o_class->finalize = geoclue_hostip_finalize;
 }
@@ -103,38 +103,72 @@ search_string_append (GString *str, const char *val)
 	g_string_append (str, val);
 }
 
-static GeoclueAccuracy*
-get_geocode_accuracy (GcWebService *geocoder)
+/* Reads the position of the first search result and derives the 
+ * accuracy from the most detailed address part it has, in one pass 
+ * over the response */
+static void
+get_geocode_result (GcWebService           *geocoder,
+                    GeocluePositionFields  *fields,
+                    double                 *latitude,
+                    double                 *longitude,
+                    GeoclueAccuracy       **accuracy)
 {
-	char *str;
+	double lat = 0.0, lon = 0.0;
+	gchar *parts[9] = { NULL };
+	GcWebServiceField result[] = {
+		{ NOMINATIM_LAT, GC_WEB_SERVICE_FIELD_DOUBLE },
+		{ NOMINATIM_LON, GC_WEB_SERVICE_FIELD_DOUBLE },
+		{ NOMINATIM_LATLON_HOUSE, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_ROAD, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_SUBURB, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_POSTCODE, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_VILLAGE, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_CITY, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_COUNTY, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_COUNTRY, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_LATLON_COUNTRYCODE, GC_WEB_SERVICE_FIELD_STRING },
+	};
+	/* accuracy of each address part above, most detailed first */
+	static const GeoclueAccuracyLevel part_levels[9] = {
+		GEOCLUE_ACCURACY_LEVEL_DETAILED,
+		GEOCLUE_ACCURACY_LEVEL_STREET,
+		GEOCLUE_ACCURACY_LEVEL_POSTALCODE,
+		GEOCLUE_ACCURACY_LEVEL_POSTALCODE,
+		GEOCLUE_ACCURACY_LEVEL_POSTALCODE,
+		GEOCLUE_ACCURACY_LEVEL_LOCALITY,
+		GEOCLUE_ACCURACY_LEVEL_REGION,
+		GEOCLUE_ACCURACY_LEVEL_COUNTRY,
+		GEOCLUE_ACCURACY_LEVEL_COUNTRY,
+	};
 	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	guint i;
 
-	if (gc_web_service_get_string (geocoder, &str, NOMINATIM_LATLON_HOUSE)) {
-		level = GEOCLUE_ACCURACY_LEVEL_DETAILED;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_ROAD)) {
-		level = GEOCLUE_ACCURACY_LEVEL_STREET;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_SUBURB) ||
-	           gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_POSTCODE) ||
-	           gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_VILLAGE)) {
-		level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_CITY)) {
-		level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_COUNTY)) {
-		level = GEOCLUE_ACCURACY_LEVEL_REGION;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_COUNTRY) ||
-	           gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_COUNTRYCODE)) {
-		level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
+	result[0].value = &lat;
+	result[1].value = &lon;
+	for (i = 0; i < G_N_ELEMENTS (parts); i++) {
+		result[i + 2].value = &parts[i];
 	}
+	gc_web_service_extract (geocoder, result, G_N_ELEMENTS (result));
 
-	return geoclue_accuracy_new (level, 0, 0);
+	*fields = GEOCLUE_POSITION_FIELDS_NONE;
+	if (latitude && result[0].found) {
+		*latitude = lat;
+		*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+	}
+	if (longitude && result[1].found) {
+		*longitude = lon;
+		*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (parts); i++) {
+		if (parts[i] && level == GEOCLUE_ACCURACY_LEVEL_NONE) {
+			level = part_levels[i];
+		}
+		g_free (parts[i]);
+	}
+	if (accuracy) {
+		*accuracy = geoclue_accuracy_new (level, 0, 0);
+	}
 }
 
 /* Geocode interface implementation */
@@ -176,20 +210,7 @@ geoclue_nominatim_address_to_position (GcIfaceGeocode        *iface,
 	}
 	g_string_free (str, TRUE);
 
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	if (latitude && gc_web_service_get_double (obj->geocoder, 
-	                                           latitude, NOMINATIM_LAT)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-	}
-
-	if (longitude &&  gc_web_service_get_double (obj->geocoder, 
-	                                             longitude, NOMINATIM_LON)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
-	}
-
-	if (accuracy) {
-		*accuracy = get_geocode_accuracy (obj->geocoder); 
-	}
+	get_geocode_result (obj->geocoder, fields, latitude, longitude, accuracy);
 
 	return TRUE;
 }
@@ -215,20 +236,7 @@ geoclue_nominatim_freeform_address_to_position (GcIfaceGeocode        *iface,
 		return FALSE;
 	}
 
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	if (latitude && gc_web_service_get_double (obj->geocoder,
-	                                           latitude, NOMINATIM_LAT)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-	}
-
-	if (longitude &&  gc_web_service_get_double (obj->geocoder,
-	                                             longitude, NOMINATIM_LON)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
-	}
-
-	if (accuracy) {
-		*accuracy = get_geocode_accuracy (obj->geocoder);
-	}
+	get_geocode_result (obj->geocoder, fields, latitude, longitude, accuracy);
 
 	return TRUE;
 }
@@ -251,7 +259,18 @@ geoclue_nominatim_position_to_address (GcIfaceReverseGeocode  *iface,
 	gchar *countrycode = NULL;
 	gchar *area = NULL;
 	gchar *street = NULL;
+	gchar *house = NULL;
 	gchar *postcode = NULL;
+	GcWebServiceField fields[] = {
+		{ NOMINATIM_COUNTRYCODE, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_COUNTRY, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_COUNTY, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_CITY, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_VILLAGE, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_POSTCODE, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_ROAD, GC_WEB_SERVICE_FIELD_STRING },
+		{ NOMINATIM_HOUSE, GC_WEB_SERVICE_FIELD_STRING },
+	};
 
 	GeoclueAccuracyLevel in_acc = GEOCLUE_ACCURACY_LEVEL_DETAILED;
 	gchar lat[G_ASCII_DTOSTR_BUF_SIZE];
@@ -279,77 +298,71 @@ geoclue_nominatim_position_to_address (GcIfaceReverseGeocode  *iface,
 
 	*address = geoclue_address_details_new ();
 
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &countrycode, NOMINATIM_COUNTRYCODE)) {
+	fields[0].value = &countrycode;
+	fields[1].value = &country;
+	fields[2].value = &region;
+	fields[3].value = &locality;
+	fields[4].value = &area;
+	fields[5].value = &postcode;
+	fields[6].value = &street;
+	fields[7].value = &house;
+	gc_web_service_extract (obj->rev_geocoder, fields, G_N_ELEMENTS (fields));
+
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && countrycode) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
 		                                countrycode);
-		g_free (countrycode);
 		geoclue_address_details_set_country_from_code (*address);
 	}
 	if (!g_hash_table_lookup (*address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
-	    in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &country, NOMINATIM_COUNTRY)) {
+	    in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && country) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRY,
 		                                country);
-		g_free (country);
 	}
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_REGION && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &region, NOMINATIM_COUNTY)) {
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_REGION && region) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_REGION,
 		                                region);
-		g_free (region);
 	}
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_LOCALITY && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &locality, NOMINATIM_CITY)) {
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_LOCALITY && locality) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_LOCALITY,
 		                                locality);
-		g_free (locality);
 	}
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_POSTALCODE && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &area, NOMINATIM_VILLAGE)) {
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_POSTALCODE && area) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_AREA,
 		                                area);
-		g_free (area);
 	}
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_POSTALCODE && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &postcode, NOMINATIM_POSTCODE)) {
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_POSTALCODE && postcode) {
 		geoclue_address_details_insert (*address,
 		                                GEOCLUE_ADDRESS_KEY_POSTALCODE,
 		                                postcode);
-		g_free (postcode);
 	}
-	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_STREET && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &street, NOMINATIM_ROAD)) {
-		char *nr;
-
-		if (gc_web_service_get_string (obj->rev_geocoder,
-		                               &nr, NOMINATIM_HOUSE)) {
-			char *full_street = g_strdup_printf ("%s %s", street, nr);
+	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_STREET && street) {
+		if (house) {
+			char *full_street = g_strdup_printf ("%s %s", street, house);
 			geoclue_address_details_insert (*address,
 			                                GEOCLUE_ADDRESS_KEY_STREET,
 			                                full_street);
-			g_free (nr);
 			g_free (full_street);
 		} else  {
 			geoclue_address_details_insert (*address,
 			                                GEOCLUE_ADDRESS_KEY_STREET,
 			                                street);
 		}
-		g_free (street);
 	}
 
+	g_free (countrycode);
+	g_free (country);
+	g_free (region);
+	g_free (locality);
+	g_free (area);
+	g_free (postcode);
+	g_free (street);
+	g_free (house);
+
 	if (address_accuracy) { 
 		GeoclueAccuracyLevel level = geoclue_address_details_get_accuracy_level (*address);
 		*address_accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
@@ -381,6 +394,18 @@ geoclue_nominatim_dispose (GObject *obj)
 	((GObjectClass *) geoclue_nominatim_parent_class)->dispose (obj);
 }
 
+static gboolean
+set_options (GcIfaceGeoclue *gc,
+             GHashTable     *options,
+             GError        **error)
+{
+	GeoclueNominatim *obj = GEOCLUE_NOMINATIM (gc);
+	
+	gc_web_service_set_options (obj->geocoder, options);
+	gc_web_service_set_options (obj->rev_geocoder, options);
+	return TRUE;
+}
+
 /* Initialization */
 
 static void
@@ -391,6 +416,7 @@ geoclue_nominatim_class_init (GeoclueNominatimClass *klass)
 	
 	p_class->shutdown = shutdown;
 	p_class->get_status = geoclue_nominatim_get_status;
+	p_class->set_options = set_options;
 
 	o_class->finalize = geoclue_nominatim_finalize;
 	o_class->dispose = geoclue_nominatim_dispose;
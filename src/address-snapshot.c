@@ -0,0 +1,130 @@
+/*
+ * Geoclue
+ * address-snapshot.c - Immutable address details shared by the master
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+/* A snapshot is one allocation: the struct, the field table and an 
+ * arena holding the values back to back. Keys are interned, there are 
+ * only a handful of them. */
+
+#include <string.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-address-details.h>
+
+#include "address-snapshot.h"
+
+GcAddressSnapshot *
+gc_address_snapshot_new (GHashTable *details)
+{
+	GcAddressSnapshot *snapshot;
+	GHashTableIter iter;
+	gpointer key, value;
+	gsize arena_size = 0;
+	guint n_fields = 0;
+	char *arena;
+	
+	if (details) {
+		g_hash_table_iter_init (&iter, details);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			arena_size += strlen (value) + 1;
+			n_fields++;
+		}
+	}
+	
+	snapshot = g_malloc (sizeof (GcAddressSnapshot) + 
+	                     n_fields * sizeof (GcAddressField) + 
+	                     arena_size);
+	snapshot->ref_count = 1;
+	snapshot->n_fields = 0;
+	snapshot->fields = (GcAddressField *) (snapshot + 1);
+	snapshot->table = NULL;
+	
+	arena = (char *) (snapshot->fields + n_fields);
+	if (details) {
+		g_hash_table_iter_init (&iter, details);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			GcAddressField *field = &snapshot->fields[snapshot->n_fields++];
+			gsize len = strlen (value) + 1;
+			
+			field->key = g_intern_string (key);
+			field->value = memcpy (arena, value, len);
+			arena += len;
+		}
+	}
+	
+	return snapshot;
+}
+
+GcAddressSnapshot *
+gc_address_snapshot_ref (GcAddressSnapshot *snapshot)
+{
+	snapshot->ref_count++;
+	return snapshot;
+}
+
+void
+gc_address_snapshot_unref (GcAddressSnapshot *snapshot)
+{
+	if (!snapshot || --snapshot->ref_count > 0) {
+		return;
+	}
+	if (snapshot->table) {
+		g_hash_table_destroy (snapshot->table);
+	}
+	g_free (snapshot);
+}
+
+/* The table borrows the snapshot's strings and belongs to it: it is 
+ * for passing on while the snapshot is referenced, e.g. to a signal 
+ * emission, and must not be modified. */
+GHashTable *
+gc_address_snapshot_get_table (GcAddressSnapshot *snapshot)
+{
+	guint i;
+	
+	if (!snapshot->table) {
+		snapshot->table = g_hash_table_new (g_str_hash, g_str_equal);
+		for (i = 0; i < snapshot->n_fields; i++) {
+			g_hash_table_insert (snapshot->table,
+			                     (char *) snapshot->fields[i].key,
+			                     (char *) snapshot->fields[i].value);
+		}
+	}
+	return snapshot->table;
+}
+
+/* a table of the caller's own, e.g. for returning over D-Bus */
+GHashTable *
+gc_address_snapshot_to_hash_table (GcAddressSnapshot *snapshot)
+{
+	GHashTable *details;
+	guint i;
+	
+	details = geoclue_address_details_new ();
+	if (snapshot) {
+		for (i = 0; i < snapshot->n_fields; i++) {
+			geoclue_address_details_insert (details,
+			                                snapshot->fields[i].key,
+			                                snapshot->fields[i].value);
+		}
+	}
+	return details;
+}
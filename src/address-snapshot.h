@@ -0,0 +1,54 @@
+/*
+ * Geoclue
+ * address-snapshot.h - Immutable address details shared by the master
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _ADDRESS_SNAPSHOT_H_
+#define _ADDRESS_SNAPSHOT_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GcAddressField {
+	const char *key;   /* interned */
+	const char *value; /* in the snapshot's arena */
+} GcAddressField;
+
+/* Address details as received from a provider. A snapshot never 
+ * changes once made, so the provider cache and every client share it 
+ * by reference; it turns into a GHashTable only for D-Bus. */
+typedef struct _GcAddressSnapshot {
+	guint ref_count;
+	guint n_fields;
+	GcAddressField *fields;
+	GHashTable *table; /* view for emitting, made on first use */
+} GcAddressSnapshot;
+
+GcAddressSnapshot *gc_address_snapshot_new (GHashTable *details);
+GcAddressSnapshot *gc_address_snapshot_ref (GcAddressSnapshot *snapshot);
+void gc_address_snapshot_unref (GcAddressSnapshot *snapshot);
+
+GHashTable *gc_address_snapshot_get_table (GcAddressSnapshot *snapshot);
+GHashTable *gc_address_snapshot_to_hash_table (GcAddressSnapshot *snapshot);
+
+G_END_DECLS
+
+#endif /* _ADDRESS_SNAPSHOT_H_ */
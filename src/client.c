@@ -34,6 +34,9 @@
 
 #include <config.h>
 
+#include <math.h>
+#include <time.h>
+
 #include <geoclue/geoclue-error.h>
 #include <geoclue/geoclue-marshal.h>
 
@@ -42,10 +45,18 @@
 #include <geoclue/gc-iface-address.h>
 
 #include "client.h"
+#include "position-fusion.h"
+#include "selection-group.h"
+#include "timer-wheel.h"
 
 #define GEOCLUE_POSITION_INTERFACE_NAME "org.freedesktop.Geoclue.Position"
 #define GEOCLUE_ADDRESS_INTERFACE_NAME "org.freedesktop.Geoclue.Address"
 
+/* process noise of position fusion, in m/s^2: enough for a car */
+#define FUSION_ACCELERATION 3.0
+
+#define METRES_PER_DEGREE (6371000.0 * G_PI / 180.0)
+
 enum {
 	ADDRESS_PROVIDER_CHANGED,
 	POSITION_PROVIDER_CHANGED,
@@ -67,21 +78,51 @@ typedef struct _GcMasterClientPrivate {
 	int min_time;
 	gboolean require_updates;
 	GeoclueResourceFlags allowed_resources;
+	gboolean allow_old_data;
+	int max_age; /* of old data in seconds, 0 for any */
+	
+	/* when fusing, every position provider is used, not only the current */
+	GcPositionFusion *fusion;
+	GHashTable *fusion_signals; /* provider -> position-changed handler id */
+	
+	/* position-changed is only emitted after moving min_distance 
+	 * metres and min_interval seconds from the last emitted position */
+	double min_distance;
+	int min_interval;
+	gboolean emitted;
+	time_t emitted_time;
+	GeocluePositionFields emitted_fields;
+	GeoclueAccuracyLevel emitted_level;
+	double emitted_latitude;
+	double emitted_longitude;
+	
+	/* positions arriving less than min_time seconds after the last 
+	 * emitted one wait here, the newest replacing older ones */
+	GcTimerWheelEntry pending_timer;
+	gboolean pending;
+	GeocluePositionFields pending_fields;
+	int pending_timestamp;
+	double pending_latitude;
+	double pending_longitude;
+	double pending_altitude;
+	GeoclueAccuracy *pending_accuracy;
 	
 	gboolean position_started;
 	GcMasterProvider *position_provider;
-	GList *position_providers;
-	gboolean position_provider_choice_in_progress;
+	GcSelectionGroup *position_group;
 	
 	gboolean address_started;
 	GcMasterProvider *address_provider;
-	GList *address_providers;
-	gboolean address_provider_choice_in_progress;
+	GcSelectionGroup *address_group;
 	
 } GcMasterClientPrivate;
 
 #define GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), GC_TYPE_MASTER_CLIENT, GcMasterClientPrivate))
 
+/* the ranked providers, shared with clients of the same requirements */
+#define POSITION_PROVIDERS(priv) gc_selection_group_get_providers ((priv)->position_group)
+#define ADDRESS_PROVIDERS(priv) gc_selection_group_get_providers ((priv)->address_group)
+
 
 
 static gboolean gc_iface_master_client_set_requirements (GcMasterClient       *client, 
@@ -90,6 +131,29 @@ static gboolean gc_iface_master_client_set_requirements (GcMasterClient       *c
                                                          gboolean              require_updates, 
                                                          GeoclueResourceFlags  allowed_resources, 
                                                          GError              **error);
+static gboolean gc_iface_master_client_set_allow_old_data (GcMasterClient  *client,
+                                                           gboolean         allow_old_data,
+                                                           int              max_age,
+                                                           GError         **error);
+static gboolean gc_iface_master_client_set_position_fusion (GcMasterClient  *client,
+                                                            gboolean         enable,
+                                                            GError         **error);
+static gboolean gc_iface_master_client_set_position_thresholds (GcMasterClient  *client,
+                                                               double           min_distance,
+                                                               int              min_interval,
+                                                               GError         **error);
+static gboolean gc_iface_master_client_get_position_history (GcMasterClient  *client,
+                                                             int              since,
+                                                             int              max,
+                                                             GArray         **fields,
+                                                             GArray         **timestamps,
+                                                             GArray         **latitudes,
+                                                             GArray         **longitudes,
+                                                             GArray         **altitudes,
+                                                             GArray         **accuracy_levels,
+                                                             GArray         **horizontal_accuracies,
+                                                             GArray         **vertical_accuracies,
+                                                             GError         **error);
 static gboolean gc_iface_master_client_position_start (GcMasterClient *client, GError **error);
 static gboolean gc_iface_master_client_address_start (GcMasterClient *client, GError **error);
 static gboolean gc_iface_master_client_get_address_provider (GcMasterClient  *client,
@@ -120,98 +184,172 @@ G_DEFINE_TYPE_WITH_CODE (GcMasterClient, gc_master_client, G_TYPE_OBJECT,
 #include "gc-iface-master-client-glue.h"
 
 
-static gboolean status_change_requires_provider_change (GList            *provider_list,
-                                                        GcMasterProvider *current_provider,
-                                                        GcMasterProvider *changed_provider,
-                                                        GeoclueStatus     status);
 static void gc_master_client_emit_position_changed (GcMasterClient *client);
 static void gc_master_client_emit_address_changed (GcMasterClient *client);
-static gboolean gc_master_client_choose_position_provider (GcMasterClient  *client, 
-                                                           GList           *providers);
-static gboolean gc_master_client_choose_address_provider (GcMasterClient  *client, 
-                                                          GList           *providers);
+static gboolean gc_master_client_set_position_provider (GcMasterClient   *client, 
+                                                        GcMasterProvider *new_p);
+static gboolean gc_master_client_set_address_provider (GcMasterClient   *client, 
+                                                       GcMasterProvider *new_p);
+
+
 
 
 static void
-status_changed (GcMasterProvider *provider,
-                GeoclueStatus     status,
-                GcMasterClient   *client)
+gc_master_client_remember_position (GcMasterClient       *client,
+                                    GeocluePositionFields fields,
+                                    double                latitude,
+                                    double                longitude,
+                                    GeoclueAccuracy      *accuracy)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
 	
-	g_debug ("client: provider %s status changed: %d", gc_master_provider_get_name (provider), status);
+	if (accuracy) {
+		geoclue_accuracy_get_details (accuracy, &level, NULL, NULL);
+	}
+	priv->emitted = TRUE;
+	priv->emitted_time = time (NULL);
+	
+	/* anything pending is older than this */
+	priv->pending = FALSE;
+	gc_timer_wheel_cancel (&priv->pending_timer);
+	priv->emitted_fields = fields;
+	priv->emitted_level = level;
+	priv->emitted_latitude = latitude;
+	priv->emitted_longitude = longitude;
+}
+
+/* Is the position far and late enough from the last emitted one for 
+ * this client to hear about it? Changes in fields or accuracy level 
+ * always pass. Remembers the position if it passes. */
+static gboolean
+gc_master_client_position_passes_thresholds (GcMasterClient       *client,
+                                             GeocluePositionFields fields,
+                                             double                latitude,
+                                             double                longitude,
+                                             GeoclueAccuracy      *accuracy)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	double east, north;
 	
-	/* change providers if needed (and if we're not choosing provider already) */
+	if (accuracy) {
+		geoclue_accuracy_get_details (accuracy, &level, NULL, NULL);
+	}
+	if ((priv->min_distance <= 0.0 && priv->min_interval <= 0) ||
+	    !priv->emitted ||
+	    fields != priv->emitted_fields ||
+	    level != priv->emitted_level) {
+		gc_master_client_remember_position (client, fields, latitude, longitude, accuracy);
+		return TRUE;
+	}
 	
-	if (!priv->position_provider_choice_in_progress &&
-	    status_change_requires_provider_change (priv->position_providers,
-	                                            priv->position_provider,
-	                                            provider, status) &&
-	    gc_master_client_choose_position_provider (client, 
-	                                               priv->position_providers)) {
-		
-		/* we have a new position provider, force-emit position_changed */
-		gc_master_client_emit_position_changed (client);
+	if (time (NULL) - priv->emitted_time < priv->min_interval) {
+		return FALSE;
+	}
+	if (priv->min_distance > 0.0 &&
+	    fields & GEOCLUE_POSITION_FIELDS_LATITUDE &&
+	    fields & GEOCLUE_POSITION_FIELDS_LONGITUDE) {
+		/* equirectangular approximation: exact enough for thresholds */
+		east = (longitude - priv->emitted_longitude) * METRES_PER_DEGREE *
+		       cos (priv->emitted_latitude * G_PI / 180.0);
+		north = (latitude - priv->emitted_latitude) * METRES_PER_DEGREE;
+		if (east * east + north * north < priv->min_distance * priv->min_distance) {
+			return FALSE;
+		}
 	}
 	
-	if (!priv->address_provider_choice_in_progress &&
-	    status_change_requires_provider_change (priv->address_providers,
-	                                            priv->address_provider,
-	                                            provider, status) &&
-	    gc_master_client_choose_address_provider (client, 
-	                                              priv->address_providers)) {
-		
-		/* we have a new address provider, force-emit address_changed */
-		gc_master_client_emit_address_changed (client);
+	gc_master_client_remember_position (client, fields, latitude, longitude, accuracy);
+	return TRUE;
+}
+
+static void
+gc_master_client_send_position (GcMasterClient       *client,
+                                GeocluePositionFields fields,
+                                int                   timestamp,
+                                double                latitude,
+                                double                longitude,
+                                double                altitude,
+                                GeoclueAccuracy      *accuracy)
+{
+	if (!gc_master_client_position_passes_thresholds (client, fields,
+	                                                  latitude, longitude,
+	                                                  accuracy)) {
+		return;
 	}
+	gc_iface_position_emit_position_changed
+		(GC_IFACE_POSITION (client),
+		 fields,
+		 timestamp,
+		 latitude, longitude, altitude,
+		 accuracy);
 }
 
 static void
-accuracy_changed (GcMasterProvider     *provider,
-                  GcInterfaceFlags      interface,
-                  GeoclueAccuracyLevel  level,
-                  GcMasterClient       *client)
+gc_master_client_send_pending_position (gpointer data)
 {
+	GcMasterClient *client = data;
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcInterfaceAccuracy *accuracy_data;
-	
-	accuracy_data = g_new0 (GcInterfaceAccuracy, 1);
-	g_debug ("client: %s accuracy changed (%d)", 
-	         gc_master_provider_get_name (provider), level);
-	
-	accuracy_data->interface = interface;
-	accuracy_data->accuracy_level = priv->min_accuracy;
-	switch (interface) {
-		case GC_IFACE_POSITION:
-			priv->position_providers = 
-				g_list_sort_with_data (priv->position_providers, 
-						       (GCompareDataFunc)gc_master_provider_compare,
-						       accuracy_data);
-			if (priv->position_provider_choice_in_progress) {
-				g_debug ("        ...but provider choice in progress");
-			} else if (gc_master_client_choose_position_provider (client, 
-									      priv->position_providers)) {
-				gc_master_client_emit_position_changed (client);
-			}
-			break;
-			
-		case GC_IFACE_ADDRESS:
-			priv->address_providers = 
-				g_list_sort_with_data (priv->address_providers, 
-						       (GCompareDataFunc)gc_master_provider_compare,
-						       accuracy_data);
-			if (priv->address_provider_choice_in_progress) {
-				g_debug ("        ...but provider choice in progress");
-			} else if (gc_master_client_choose_address_provider (client, 
-								      priv->address_providers)) {
-				gc_master_client_emit_address_changed (client);
-			}
-			break;
-			
-		default:
-			g_assert_not_reached ();
+	GeoclueAccuracy *accuracy;
+	
+	if (!priv->pending) {
+		return;
+	}
+	priv->pending = FALSE;
+	accuracy = priv->pending_accuracy;
+	priv->pending_accuracy = NULL;
+	
+	gc_master_client_send_position (client,
+	                                priv->pending_fields,
+	                                priv->pending_timestamp,
+	                                priv->pending_latitude,
+	                                priv->pending_longitude,
+	                                priv->pending_altitude,
+	                                accuracy);
+	geoclue_accuracy_free (accuracy);
+}
+
+/* Sends the position now, or when min_time has passed since the 
+ * last emitted one */
+static void
+gc_master_client_queue_position (GcMasterClient       *client,
+                                 GeocluePositionFields fields,
+                                 int                   timestamp,
+                                 double                latitude,
+                                 double                longitude,
+                                 double                altitude,
+                                 GeoclueAccuracy      *accuracy)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	time_t wait = 0;
+	
+	if (priv->min_time > 0 && priv->emitted) {
+		wait = priv->emitted_time + priv->min_time - time (NULL);
+	}
+	if (wait <= 0 && !priv->pending) {
+		gc_master_client_send_position (client, fields, timestamp,
+		                                latitude, longitude, altitude,
+		                                accuracy);
+		return;
+	}
+	
+	priv->pending = TRUE;
+	priv->pending_fields = fields;
+	priv->pending_timestamp = timestamp;
+	priv->pending_latitude = latitude;
+	priv->pending_longitude = longitude;
+	priv->pending_altitude = altitude;
+	if (priv->pending_accuracy) {
+		geoclue_accuracy_free (priv->pending_accuracy);
+	}
+	priv->pending_accuracy = accuracy ? geoclue_accuracy_copy (accuracy) :
+		geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
+	
+	if (!gc_timer_wheel_is_scheduled (&priv->pending_timer)) {
+		gc_timer_wheel_schedule (&priv->pending_timer, MAX (wait, 1),
+		                         gc_master_client_send_pending_position,
+		                         client);
 	}
-	g_free (accuracy_data);
 }
 
 static void
@@ -224,88 +362,123 @@ position_changed (GcMasterProvider     *provider,
                   GeoclueAccuracy      *accuracy,
                   GcMasterClient       *client)
 {
-	gc_iface_position_emit_position_changed
-		(GC_IFACE_POSITION (client),
-		 fields,
-		 timestamp,
-		 latitude, longitude, altitude,
-		 accuracy);
+	gc_master_client_queue_position (client, fields, timestamp,
+	                                 latitude, longitude, altitude,
+	                                 accuracy);
+}
+
+static void
+gc_master_client_emit_fused_position (GcMasterClient *client, gboolean force)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GeocluePositionFields fields;
+	int timestamp = 0;
+	double latitude = 0.0, longitude = 0.0, altitude = 0.0;
+	GeoclueAccuracy *accuracy = NULL;
+	
+	fields = gc_position_fusion_get (priv->fusion, &timestamp,
+	                                 &latitude, &longitude, &altitude,
+	                                 &accuracy);
+	if (force) {
+		gc_master_client_remember_position (client, fields, latitude, longitude, accuracy);
+		gc_iface_position_emit_position_changed
+			(GC_IFACE_POSITION (client),
+			 fields,
+			 timestamp,
+			 latitude, longitude, altitude,
+			 accuracy);
+	} else {
+		gc_master_client_queue_position (client, fields, timestamp,
+		                                 latitude, longitude, altitude,
+		                                 accuracy);
+	}
+	geoclue_accuracy_free (accuracy);
+}
+
+static void
+fused_position_changed (GcMasterProvider     *provider,
+                        GeocluePositionFields fields,
+                        int                   timestamp,
+                        double                latitude,
+                        double                longitude,
+                        double                altitude,
+                        GeoclueAccuracy      *accuracy,
+                        GcMasterClient       *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	if (gc_position_fusion_update (priv->fusion, provider, fields, timestamp,
+	                               latitude, longitude, altitude,
+	                               accuracy)) {
+		gc_master_client_emit_fused_position (client, FALSE);
+	}
 }
 
 static void
 address_changed (GcMasterProvider     *provider,
                  int                   timestamp,
-                 GHashTable           *details,
+                 GcAddressSnapshot    *details,
                  GeoclueAccuracy      *accuracy,
                  GcMasterClient       *client)
 {
+	/* every client of the provider emits the same shared table */
 	gc_iface_address_emit_address_changed
 		(GC_IFACE_ADDRESS (client),
 		 timestamp,
-		 details,
+		 gc_address_snapshot_get_table (details),
 		 accuracy);
 }
 
-/*if changed_provider status changes, do we need to choose a new provider? */
+
+
+
 static gboolean
-status_change_requires_provider_change (GList            *provider_list,
-                                        GcMasterProvider *current_provider,
-                                        GcMasterProvider *changed_provider,
-                                        GeoclueStatus     status)
+disconnect_fusion_signal (GcMasterProvider *provider,
+                          gpointer          handler_id,
+                          GList            *keep)
 {
-	if (!provider_list) {
+	if (g_list_find (keep, provider)) {
 		return FALSE;
-		
-	} else if (current_provider == NULL) {
-		return (status == GEOCLUE_STATUS_AVAILABLE);
-		
-	} else if (current_provider == changed_provider) {
-		return (status != GEOCLUE_STATUS_AVAILABLE);
-		
-	}else if (status != GEOCLUE_STATUS_AVAILABLE) {
-		return FALSE;
-		
 	}
+	g_signal_handler_disconnect (provider, GPOINTER_TO_UINT (handler_id));
+	return TRUE;
+}
+
+/* listen to the positions of exactly the providers in the list */
+static void
+gc_master_client_connect_fusion_signals (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GList *l;
 	
-	while (provider_list) {
-		GcMasterProvider *p = provider_list->data;
-		if (p == current_provider) {
-			/* not interested in worse-than-current providers */
-			return FALSE;
-		}
-		if (p == changed_provider) {
-			/* changed_provider is better than current */
-			return (status == GEOCLUE_STATUS_AVAILABLE);
+	g_hash_table_foreach_remove (priv->fusion_signals,
+	                             (GHRFunc) disconnect_fusion_signal,
+	                             POSITION_PROVIDERS (priv));
+	for (l = POSITION_PROVIDERS (priv); l; l = l->next) {
+		guint id;
+		
+		if (g_hash_table_lookup (priv->fusion_signals, l->data)) {
+			continue;
 		}
-		provider_list = provider_list->next;
+		id = g_signal_connect (G_OBJECT (l->data),
+		                       "position-changed",
+		                       G_CALLBACK (fused_position_changed),
+		                       client);
+		g_hash_table_insert (priv->fusion_signals, l->data, GUINT_TO_POINTER (id));
 	}
-	return FALSE;
 }
 
 static void
-gc_master_client_connect_common_signals (GcMasterClient *client, GList *providers)
+gc_master_client_subscribe_providers (GcMasterClient *client, GList *provider_list, GcInterfaceFlags iface)
 {
-	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	GList *l;
 	
-	/* connect to common signals if the provider is not already connected */
-	l = providers;
-	while (l) {
-		GcMasterProvider *p = l->data;
-		if (!g_list_find (priv->address_providers, p) &&
-		    !g_list_find (priv->position_providers, p)) {
-			g_debug ("client: connecting to '%s' accuracy-changed and status-changed", gc_master_provider_get_name (p));
-			g_signal_connect (G_OBJECT (p),
-					  "status-changed",
-					  G_CALLBACK (status_changed),
-					  client);
-			g_signal_connect (G_OBJECT (p),
-					  "accuracy-changed",
-					  G_CALLBACK (accuracy_changed),
-					  client);
-		}
-		l = l->next;
+	/* starting providers may re-sort the original list */
+	provider_list = g_list_copy (provider_list);
+	for (l = provider_list; l; l = l->next) {
+		gc_master_provider_subscribe (l->data, client, iface);
 	}
+	g_list_free (provider_list);
 }
 
 static void
@@ -320,49 +493,10 @@ gc_master_client_unsubscribe_providers (GcMasterClient *client, GList *provider_
 	
 }
 
-/* get_best_provider will return the best provider with status == GEOCLUE_STATUS_AVAILABLE.
- * It will also "subscribe" to that provider and all better ones, and unsubscribe from worse.*/
-static GcMasterProvider *
-gc_master_client_get_best_provider (GcMasterClient    *client,
-                                    GList            **provider_list,
-                                    GcInterfaceFlags   iface)
-{
-	GList *l = *provider_list;
-	/* TODO: should maybe choose a acquiring provider if better ones are are not available */
-	
-	g_debug ("client: choosing best provider");
-	
-	while (l) {
-		GcMasterProvider *provider = l->data;
-		
-		g_debug ("        ...trying provider %s", gc_master_provider_get_name (provider));
-		if (gc_master_provider_subscribe (provider, client, iface)) {
-			/* provider was started, so accuracy may have changed 
-			   (which re-sorts provider lists), restart provider selection */
-			/* TODO re-think this: restarting provider selection leads to potentially
-			   never-ending looping */
-			g_debug ("        ...started %s (status %d), re-starting provider selection",
-			         gc_master_provider_get_name (provider),
-			         gc_master_provider_get_status (provider));
-			l = *provider_list;
-			continue;
-		}
-		/* provider did not need to be started */
-		
-		/* TODO: currently returning even providers that are worse than priv->min_accuracy,
-		 * if nothing else is available */
-		if (gc_master_provider_get_status (provider) == GEOCLUE_STATUS_AVAILABLE) {
-			/* unsubscribe from all providers worse than this */
-			gc_master_client_unsubscribe_providers (client, l->next, iface);
-			return provider;
-		}
-		l = l->next;
-	}
-	
-	/* no provider found */
-	gc_master_client_unsubscribe_providers (client, *provider_list, iface);
-	return NULL;
-}
+
+
+
+
 
 static void
 gc_master_client_emit_position_changed (GcMasterClient *client)
@@ -374,9 +508,15 @@ gc_master_client_emit_position_changed (GcMasterClient *client)
 	GeoclueAccuracy *accuracy = NULL;
 	GError *error = NULL;
 	
+	if (priv->fusion && priv->fusion->valid) {
+		gc_master_client_emit_fused_position (client, TRUE);
+		return;
+	}
 	
 	if (priv->position_provider == NULL) {
 		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
+		gc_master_client_remember_position (client, GEOCLUE_POSITION_FIELDS_NONE,
+		                                    0.0, 0.0, accuracy);
 		gc_iface_position_emit_position_changed
 			(GC_IFACE_POSITION (client),
 			 GEOCLUE_POSITION_FIELDS_NONE,
@@ -401,6 +541,7 @@ gc_master_client_emit_position_changed (GcMasterClient *client)
 		g_error_free (error);
 		return;
 	}
+	gc_master_client_remember_position (client, fields, latitude, longitude, accuracy);
 	gc_iface_position_emit_position_changed
 		(GC_IFACE_POSITION (client),
 		 fields,
@@ -414,19 +555,20 @@ gc_master_client_emit_address_changed (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	int timestamp;
-	GHashTable *details = NULL;
+	GHashTable *empty;
+	GcAddressSnapshot *details = NULL;
 	GeoclueAccuracy *accuracy = NULL;
 	GError *error = NULL;
 	
 	if (priv->address_provider == NULL) {
 		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
-		details = g_hash_table_new (g_str_hash, g_str_equal);
+		empty = g_hash_table_new (g_str_hash, g_str_equal);
 		gc_iface_address_emit_address_changed
 			(GC_IFACE_ADDRESS (client),
 			 time (NULL),
-			 details,
+			 empty,
 			 accuracy);
-		g_hash_table_destroy (details);
+		g_hash_table_destroy (empty);
 		geoclue_accuracy_free (accuracy);
 		return;
 	}
@@ -446,24 +588,18 @@ gc_master_client_emit_address_changed (GcMasterClient *client)
 	gc_iface_address_emit_address_changed
 		(GC_IFACE_ADDRESS (client),
 		 timestamp,
-		 details,
+		 gc_address_snapshot_get_table (details),
 		 accuracy);
+	gc_address_snapshot_unref (details);
+	geoclue_accuracy_free (accuracy);
 }
 
-/* return true if a _new_ provider was chosen */
+/* return true if a _new_ provider was set */
 static gboolean
-gc_master_client_choose_position_provider (GcMasterClient *client, 
-                                           GList *providers)
+gc_master_client_set_position_provider (GcMasterClient   *client, 
+                                        GcMasterProvider *new_p)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcMasterProvider *new_p;
-	
-	/* choose and start provider */
-	priv->position_provider_choice_in_progress = TRUE;
-	new_p = gc_master_client_get_best_provider (client, 
-	                                            &priv->position_providers, 
-	                                            GC_IFACE_POSITION);
-	priv->position_provider_choice_in_progress = FALSE;
 	
 	if (priv->position_provider && new_p == priv->position_provider) {
 		return FALSE;
@@ -490,29 +626,22 @@ gc_master_client_choose_position_provider (GcMasterClient *client,
 		       gc_master_provider_get_description (priv->position_provider),
 		       gc_master_provider_get_service (priv->position_provider),
 		       gc_master_provider_get_path (priv->position_provider));
-	priv->signals[POSITION_CHANGED] =
-		g_signal_connect (G_OBJECT (priv->position_provider),
-				  "position-changed",
-				  G_CALLBACK (position_changed),
-				  client);
+	if (!priv->fusion) {
+		priv->signals[POSITION_CHANGED] =
+			g_signal_connect (G_OBJECT (priv->position_provider),
+					  "position-changed",
+					  G_CALLBACK (position_changed),
+					  client);
+	}
 	return TRUE;
 }
 
-/* return true if a _new_ provider was chosen */
+/* return true if a _new_ provider was set */
 static gboolean
-gc_master_client_choose_address_provider (GcMasterClient *client, 
-                                          GList *providers)
+gc_master_client_set_address_provider (GcMasterClient   *client, 
+                                       GcMasterProvider *new_p)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcMasterProvider *new_p;
-	
-	
-	/* choose and start provider */
-	priv->address_provider_choice_in_progress = TRUE;
-	new_p = gc_master_client_get_best_provider (client, 
-	                                            &priv->address_providers, 
-	                                            GC_IFACE_ADDRESS);
-	priv->address_provider_choice_in_progress = FALSE;
 	
 	if (priv->address_provider != NULL && new_p == priv->address_provider) {
 		/* keep using the same provider */
@@ -549,90 +678,109 @@ gc_master_client_choose_address_provider (GcMasterClient *client,
 }
 
 static void
-gc_master_provider_set_position_providers (GcMasterClient *client, 
-                                           GList *providers)
+position_group_changed (GcSelectionGroup *group, gpointer data)
 {
-	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcInterfaceAccuracy *accuracy_data;
-	
-	accuracy_data = g_new0(GcInterfaceAccuracy, 1);
-	accuracy_data->interface = GC_IFACE_POSITION;
-	accuracy_data->accuracy_level = priv->min_accuracy;
+	GcMasterClient *client = data;
 	
-	gc_master_client_connect_common_signals (client, providers);
-	priv->position_providers = 
-		g_list_sort_with_data (providers,
-		                       (GCompareDataFunc)gc_master_provider_compare,
-		                       accuracy_data);
+	if (gc_master_client_set_position_provider (client, 
+	                                            gc_selection_group_get_provider (group))) {
+		/* we have a new position provider, force-emit position_changed */
+		gc_master_client_emit_position_changed (client);
+	}
+}
+
+static void
+address_group_changed (GcSelectionGroup *group, gpointer data)
+{
+	GcMasterClient *client = data;
 	
-	g_free (accuracy_data);
+	if (gc_master_client_set_address_provider (client, 
+	                                           gc_selection_group_get_provider (group))) {
+		/* we have a new address provider, force-emit address_changed */
+		gc_master_client_emit_address_changed (client);
+	}
 }
 
+/* Fusion needs every provider running, so the client subscribes to 
+ * them itself on top of the group's subscriptions */
 static void
-gc_master_provider_set_address_providers (GcMasterClient *client, 
-                                           GList *providers)
+gc_master_client_start_fusion (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcInterfaceAccuracy *accuracy_data;
-	
-	accuracy_data = g_new0(GcInterfaceAccuracy, 1);
-	accuracy_data->interface = GC_IFACE_ADDRESS;
-	accuracy_data->accuracy_level = priv->min_accuracy;
 	
-	gc_master_client_connect_common_signals (client, providers);
-	priv->address_providers = 
-		g_list_sort_with_data (providers,
-		                       (GCompareDataFunc)gc_master_provider_compare,
-		                       accuracy_data);
+	gc_master_client_subscribe_providers (client, 
+	                                      POSITION_PROVIDERS (priv), 
+	                                      GC_IFACE_POSITION);
+	gc_master_client_connect_fusion_signals (client);
+}
+
+static void
+gc_master_client_stop_fusion (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	g_free (accuracy_data);
+	g_hash_table_foreach_remove (priv->fusion_signals,
+	                             (GHRFunc) disconnect_fusion_signal,
+	                             NULL);
+	gc_master_client_unsubscribe_providers (client, 
+	                                        POSITION_PROVIDERS (priv), 
+	                                        GC_IFACE_POSITION);
 }
 
 static void
 gc_master_client_init_position_providers (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GList *providers;
+	GcSelectionGroup *group;
 	
 	if (!priv->position_started) {
 		return;
 	}
-	 
-	/* TODO: free priv->position_providers */
 	
-	providers = gc_master_get_providers (GC_IFACE_POSITION,
-	                                     priv->min_accuracy,
-	                                     priv->require_updates,
-	                                     priv->allowed_resources,
-	                                     NULL);
-	g_debug ("client: %d position providers matching requirements found, now choosing current provider", 
-	         g_list_length (providers));
+	group = gc_selection_group_get (GC_IFACE_POSITION,
+	                                priv->min_accuracy,
+	                                priv->require_updates,
+	                                priv->allowed_resources);
+	if (priv->position_group) {
+		if (priv->fusion) {
+			gc_master_client_stop_fusion (client);
+		}
+		gc_selection_group_remove_member (priv->position_group, client);
+		gc_selection_group_unref (priv->position_group);
+	}
+	priv->position_group = group;
+	gc_selection_group_add_member (group, position_group_changed, client);
+	if (priv->fusion) {
+		gc_master_client_start_fusion (client);
+	}
 	
-	gc_master_provider_set_position_providers (client, providers);
-	gc_master_client_choose_position_provider (client, priv->position_providers);
+	gc_master_client_set_position_provider (client, 
+	                                        gc_selection_group_get_provider (group));
 }
+
 static void
 gc_master_client_init_address_providers (GcMasterClient *client)
 {
-	GList *providers;
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcSelectionGroup *group;
 	
 	if (!priv->address_started) {
 		return;
 	}
-	 
-	/* TODO: free priv->address_providers */
 	
-	providers = gc_master_get_providers (GC_IFACE_ADDRESS,
-	                                     priv->min_accuracy,
-	                                     priv->require_updates,
-	                                     priv->allowed_resources,
-	                                     NULL);
-	g_debug ("client: %d address providers matching requirements found, now choosing current provider", 
-	         g_list_length (providers));
+	group = gc_selection_group_get (GC_IFACE_ADDRESS,
+	                                priv->min_accuracy,
+	                                priv->require_updates,
+	                                priv->allowed_resources);
+	if (priv->address_group) {
+		gc_selection_group_remove_member (priv->address_group, client);
+		gc_selection_group_unref (priv->address_group);
+	}
+	priv->address_group = group;
+	gc_selection_group_add_member (group, address_group_changed, client);
 	
-	gc_master_provider_set_address_providers (client, providers);
-	gc_master_client_choose_address_provider (client, priv->address_providers);
+	gc_master_client_set_address_provider (client, 
+	                                       gc_selection_group_get_provider (group));
 }
 
 static gboolean
@@ -656,6 +804,117 @@ gc_iface_master_client_set_requirements (GcMasterClient        *client,
 	return TRUE;
 }
 
+static gboolean
+gc_iface_master_client_set_allow_old_data (GcMasterClient  *client,
+                                           gboolean         allow_old_data,
+                                           int              max_age,
+                                           GError         **error)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	priv->allow_old_data = allow_old_data;
+	priv->max_age = MAX (max_age, 0);
+	
+	return TRUE;
+}
+
+static gboolean
+gc_iface_master_client_set_position_fusion (GcMasterClient  *client,
+                                            gboolean         enable,
+                                            GError         **error)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	if (enable == (priv->fusion != NULL)) {
+		return TRUE;
+	}
+	
+	if (enable) {
+		if (priv->signals[POSITION_CHANGED] > 0) {
+			g_signal_handler_disconnect (priv->position_provider, 
+			                             priv->signals[POSITION_CHANGED]);
+			priv->signals[POSITION_CHANGED] = 0;
+		}
+		priv->fusion = gc_position_fusion_new (FUSION_ACCELERATION);
+		priv->fusion_signals = g_hash_table_new (g_direct_hash, g_direct_equal);
+		
+		if (priv->position_group) {
+			gc_master_client_start_fusion (client);
+		}
+		return TRUE;
+	}
+	
+	gc_master_client_stop_fusion (client);
+	g_hash_table_destroy (priv->fusion_signals);
+	priv->fusion_signals = NULL;
+	gc_position_fusion_free (priv->fusion);
+	priv->fusion = NULL;
+	
+	if (priv->position_provider) {
+		priv->signals[POSITION_CHANGED] =
+			g_signal_connect (G_OBJECT (priv->position_provider),
+					  "position-changed",
+					  G_CALLBACK (position_changed),
+					  client);
+	}
+	return TRUE;
+}
+
+static gboolean
+gc_iface_master_client_set_position_thresholds (GcMasterClient  *client,
+                                                double           min_distance,
+                                                int              min_interval,
+                                                GError         **error)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	priv->min_distance = MAX (min_distance, 0.0);
+	priv->min_interval = MAX (min_interval, 0);
+	
+	return TRUE;
+}
+
+/* Answers from the history of the current position provider, 
+ * which is shared by all its clients */
+static gboolean
+gc_iface_master_client_get_position_history (GcMasterClient  *client,
+                                             int              since,
+                                             int              max,
+                                             GArray         **fields,
+                                             GArray         **timestamps,
+                                             GArray         **latitudes,
+                                             GArray         **longitudes,
+                                             GArray         **altitudes,
+                                             GArray         **accuracy_levels,
+                                             GArray         **horizontal_accuracies,
+                                             GArray         **vertical_accuracies,
+                                             GError         **error)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcPositionHistoryRange range;
+	
+	if (priv->position_provider == NULL) {
+		if (error) {
+			*error = g_error_new (GEOCLUE_ERROR,
+			                      GEOCLUE_ERROR_NOT_AVAILABLE,
+			                      "Geoclue master client has no usable Position providers");
+		}
+		return FALSE;
+	}
+	
+	gc_master_provider_get_position_history (priv->position_provider,
+	                                         since, MAX (max, 0), &range);
+	*fields = range.fields;
+	*timestamps = range.timestamps;
+	*latitudes = range.latitudes;
+	*longitudes = range.longitudes;
+	*altitudes = range.altitudes;
+	*accuracy_levels = range.levels;
+	*horizontal_accuracies = range.horizontal;
+	*vertical_accuracies = range.vertical;
+	
+	return TRUE;
+}
 
 static gboolean 
 gc_iface_master_client_position_start (GcMasterClient *client, 
@@ -663,7 +922,7 @@ gc_iface_master_client_position_start (GcMasterClient *client,
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	if (priv->position_providers) {
+	if (priv->position_group) {
 		if (error) {
 			*error = g_error_new (GEOCLUE_ERROR,
 			                      GEOCLUE_ERROR_FAILED,
@@ -685,7 +944,7 @@ gc_iface_master_client_address_start (GcMasterClient *client,
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	if (priv->address_providers) {
+	if (priv->address_group) {
 		if (error) {
 			*error = g_error_new (GEOCLUE_ERROR,
 					      GEOCLUE_ERROR_FAILED,
@@ -773,16 +1032,27 @@ finalize (GObject *object)
 	GcMasterClient *client = GC_MASTER_CLIENT (object);
 	GcMasterClientPrivate *priv = GET_PRIVATE (object);
 	
-	/* do not free contents of the lists, Master takes care of them */
-	if (priv->position_providers) {
-		gc_master_client_unsubscribe_providers (client, priv->position_providers, GC_IFACE_ALL);
-		g_list_free (priv->position_providers);
-		priv->position_providers = NULL;
+	if (priv->fusion) {
+		gc_master_client_stop_fusion (client);
+		g_hash_table_destroy (priv->fusion_signals);
+		gc_position_fusion_free (priv->fusion);
 	}
-	if (priv->address_providers) {
-		gc_master_client_unsubscribe_providers (client, priv->address_providers, GC_IFACE_ALL);
-		g_list_free (priv->address_providers);
-		priv->address_providers = NULL;
+	
+	gc_timer_wheel_cancel (&priv->pending_timer);
+	if (priv->pending_accuracy) {
+		geoclue_accuracy_free (priv->pending_accuracy);
+	}
+	
+	/* the groups keep their providers subscribed for other members */
+	if (priv->position_group) {
+		gc_selection_group_remove_member (priv->position_group, client);
+		gc_selection_group_unref (priv->position_group);
+		priv->position_group = NULL;
+	}
+	if (priv->address_group) {
+		gc_selection_group_remove_member (priv->address_group, client);
+		gc_selection_group_unref (priv->address_group);
+		priv->address_group = NULL;
 	}
 	
 	((GObjectClass *) gc_master_client_parent_class)->finalize (object);
@@ -825,16 +1095,25 @@ gc_master_client_init (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	priv->position_provider_choice_in_progress = FALSE;
-	priv->address_provider_choice_in_progress = FALSE;
-	
 	priv->position_started = FALSE;
 	priv->position_provider = NULL;
-	priv->position_providers = NULL;
+	priv->position_group = NULL;
 	
 	priv->address_started = FALSE;
 	priv->address_provider = NULL;
-	priv->address_providers = NULL;
+	priv->address_group = NULL;
+	
+	priv->allow_old_data = FALSE;
+	priv->max_age = 0;
+	
+	priv->fusion = NULL;
+	priv->fusion_signals = NULL;
+	
+	priv->min_distance = 0.0;
+	priv->min_interval = 0;
+	priv->emitted = FALSE;
+	priv->pending = FALSE;
+	priv->pending_accuracy = NULL;
 }
 
 static gboolean
@@ -850,6 +1129,36 @@ get_position (GcIfacePosition       *iface,
 	GcMasterClient *client = GC_MASTER_CLIENT (iface);
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
+	if (priv->fusion && priv->fusion->valid) {
+		*fields = gc_position_fusion_get (priv->fusion, timestamp,
+		                                  latitude, longitude, altitude,
+		                                  accuracy);
+		return TRUE;
+	}
+	
+	if (priv->allow_old_data) {
+		GList *l;
+		
+		/* the current provider first, then any that has data */
+		if (priv->position_provider &&
+		    gc_master_provider_get_old_position (priv->position_provider,
+		                                         priv->max_age, fields,
+		                                         timestamp,
+		                                         latitude, longitude, altitude,
+		                                         accuracy)) {
+			return TRUE;
+		}
+		for (l = POSITION_PROVIDERS (priv); l && !priv->position_provider; l = l->next) {
+			if (gc_master_provider_get_old_position (l->data,
+			                                         priv->max_age, fields,
+			                                         timestamp,
+			                                         latitude, longitude, altitude,
+			                                         accuracy)) {
+				return TRUE;
+			}
+		}
+	}
+	
 	if (priv->position_provider == NULL) {
 		if (error) {
 			*error = g_error_new (GEOCLUE_ERROR,
@@ -868,6 +1177,8 @@ get_position (GcIfacePosition       *iface,
 	return (!*error);
 }
 
+/* the address goes out over D-Bus, so this is where the 
+ * shared details become a table of their own */
 static gboolean 
 get_address (GcIfaceAddress   *iface,
              int              *timestamp,
@@ -877,22 +1188,47 @@ get_address (GcIfaceAddress   *iface,
 {
 	GcMasterClient *client = GC_MASTER_CLIENT (iface);
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcAddressSnapshot *details = NULL;
+	gboolean ret = FALSE;
 	
-	if (priv->address_provider == NULL) {
-		if (error) {
-			*error = g_error_new (GEOCLUE_ERROR,
-			                      GEOCLUE_ERROR_NOT_AVAILABLE,
-			                      "Geoclue master client has no usable Address providers");
+	if (priv->allow_old_data) {
+		GList *l;
+		
+		/* the current provider first, then any that has data */
+		if (priv->address_provider) {
+			ret = gc_master_provider_get_old_address (priv->address_provider,
+			                                          priv->max_age, timestamp,
+			                                          &details, accuracy);
+		}
+		for (l = ADDRESS_PROVIDERS (priv); l && !ret && !priv->address_provider; l = l->next) {
+			ret = gc_master_provider_get_old_address (l->data,
+			                                          priv->max_age, timestamp,
+			                                          &details, accuracy);
 		}
-		return FALSE;
 	}
 	
-	return gc_master_provider_get_address
-		(priv->address_provider,
-		 timestamp,
-		 address,
-		 accuracy,
-		 error);
+	if (!ret) {
+		if (priv->address_provider == NULL) {
+			if (error) {
+				*error = g_error_new (GEOCLUE_ERROR,
+				                      GEOCLUE_ERROR_NOT_AVAILABLE,
+				                      "Geoclue master client has no usable Address providers");
+			}
+			return FALSE;
+		}
+		
+		ret = gc_master_provider_get_address (priv->address_provider,
+		                                      timestamp,
+		                                      &details,
+		                                      accuracy,
+		                                      error);
+	}
+	
+	if (ret) {
+		*address = gc_address_snapshot_to_hash_table (details);
+	}
+	gc_address_snapshot_unref (details);
+	return ret;
 }
 
 static gboolean
@@ -0,0 +1,222 @@
+/*
+ * Geoclue
+ * master-index.c - Bitset index matching providers to requirements
+ *
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* Providers do not change once loaded, so they are matched against 
+ * requirements with bitsets built at load time: bit n of every set 
+ * stands for providers[n], and the candidates for a requirement tuple 
+ * are the AND of the sets it selects. Results are kept per tuple. */
+
+#include <string.h>
+
+#include "master-index.h"
+
+#define INDEX_IFACE_BITS 6
+#define INDEX_RESOURCE_BITS 10
+#define INDEX_ACCURACY_LEVELS (GEOCLUE_ACCURACY_LEVEL_DETAILED + 1)
+
+#define INDEX_WORD(n) ((n) / 32)
+#define INDEX_BIT(n) (1u << ((n) % 32))
+
+typedef struct _GcMasterIndex {
+	GcMasterProvider **providers;
+	guint n_providers;
+	guint words;    /* words in each set */
+	guint32 *sets;  /* storage for all the sets below */
+	
+	guint32 *all;
+	guint32 *ifaces[INDEX_IFACE_BITS];           /* implements the interface */
+	guint32 *updates;                             /* sends updates */
+	guint32 *accuracy[INDEX_ACCURACY_LEVELS];    /* expected accuracy at least level */
+	guint32 *resources[INDEX_RESOURCE_BITS];     /* requires the resource */
+	
+	GHashTable *results; /* requirement tuple -> GList of providers */
+} GcMasterIndex;
+
+static GcMasterIndex provider_index;
+
+static void
+gc_master_index_clear (GcMasterIndex *index)
+{
+	g_free (index->providers);
+	g_free (index->sets);
+	if (index->results) {
+		g_hash_table_destroy (index->results);
+	}
+	memset (index, 0, sizeof (GcMasterIndex));
+}
+
+/* Fills the sets by asking each provider about one requirement at a 
+ * time, so gc_master_provider_is_good () stays the only definition of 
+ * a match. The providers must not change while the index is in use. */
+void
+gc_master_index_build (GList *providers)
+{
+	GcMasterIndex *index = &provider_index;
+	guint32 *set;
+	GList *l;
+	guint i, n;
+	
+	gc_master_index_clear (index);
+	index->n_providers = g_list_length (providers);
+	index->providers = g_new0 (GcMasterProvider *, index->n_providers);
+	index->words = MAX (INDEX_WORD (index->n_providers + 31), 1);
+	index->sets = g_new0 (guint32, index->words * 
+	                      (2 + INDEX_IFACE_BITS + INDEX_ACCURACY_LEVELS + INDEX_RESOURCE_BITS));
+	
+	set = index->sets;
+	index->all = set;
+	set += index->words;
+	index->updates = set;
+	set += index->words;
+	for (i = 0; i < INDEX_IFACE_BITS; i++) {
+		index->ifaces[i] = set;
+		set += index->words;
+	}
+	for (i = 0; i < INDEX_ACCURACY_LEVELS; i++) {
+		index->accuracy[i] = set;
+		set += index->words;
+	}
+	for (i = 0; i < INDEX_RESOURCE_BITS; i++) {
+		index->resources[i] = set;
+		set += index->words;
+	}
+	
+	for (l = providers, n = 0; l; l = l->next, n++) {
+		GcMasterProvider *provider = l->data;
+		guint word = INDEX_WORD (n);
+		guint32 bit = INDEX_BIT (n);
+		
+		index->providers[n] = provider;
+		index->all[word] |= bit;
+		if (gc_master_provider_is_good (provider, GC_IFACE_NONE, GEOCLUE_ACCURACY_LEVEL_NONE,
+		                                TRUE, GEOCLUE_RESOURCE_ALL)) {
+			index->updates[word] |= bit;
+		}
+		for (i = 0; i < INDEX_IFACE_BITS; i++) {
+			if (gc_master_provider_is_good (provider, 1 << i, GEOCLUE_ACCURACY_LEVEL_NONE,
+			                                FALSE, GEOCLUE_RESOURCE_ALL)) {
+				index->ifaces[i][word] |= bit;
+			}
+		}
+		for (i = 0; i < INDEX_ACCURACY_LEVELS; i++) {
+			if (gc_master_provider_is_good (provider, GC_IFACE_NONE, i,
+			                                FALSE, GEOCLUE_RESOURCE_ALL)) {
+				index->accuracy[i][word] |= bit;
+			}
+		}
+		for (i = 0; i < INDEX_RESOURCE_BITS; i++) {
+			if (!gc_master_provider_is_good (provider, GC_IFACE_NONE, GEOCLUE_ACCURACY_LEVEL_NONE,
+			                                 FALSE, GEOCLUE_RESOURCE_ALL & ~(1 << i))) {
+				index->resources[i][word] |= bit;
+			}
+		}
+	}
+	
+	index->results = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                        g_free, (GDestroyNotify) g_list_free);
+	g_debug ("Provider index built for %u providers", index->n_providers);
+}
+
+static GList *
+gc_master_index_match (GcInterfaceFlags      iface_type,
+                       GeoclueAccuracyLevel  min_accuracy,
+                       gboolean              can_update,
+                       GeoclueResourceFlags  allowed)
+{
+	GcMasterIndex *index = &provider_index;
+	guint32 *set;
+	GList *p = NULL;
+	guint i, w;
+	
+	set = g_new (guint32, index->words);
+	memcpy (set, index->all, index->words * sizeof (guint32));
+	for (i = 0; i < INDEX_IFACE_BITS; i++) {
+		if (iface_type & (1 << i)) {
+			for (w = 0; w < index->words; w++) {
+				set[w] &= index->ifaces[i][w];
+			}
+		}
+	}
+	if (can_update) {
+		for (w = 0; w < index->words; w++) {
+			set[w] &= index->updates[w];
+		}
+	}
+	for (w = 0; w < index->words; w++) {
+		set[w] &= index->accuracy[min_accuracy][w];
+	}
+	for (i = 0; i < INDEX_RESOURCE_BITS; i++) {
+		if (!(allowed & (1 << i))) {
+			for (w = 0; w < index->words; w++) {
+				set[w] &= ~index->resources[i][w];
+			}
+		}
+	}
+	
+	/* same order as a scan of the providers list */
+	for (i = 0; i < index->n_providers; i++) {
+		if (set[INDEX_WORD (i)] & INDEX_BIT (i)) {
+			p = g_list_prepend (p, index->providers[i]);
+		}
+	}
+	g_free (set);
+	
+	return p;
+}
+
+/* A list of the matching providers, for the caller to free. The 
+ * providers belong to the index. The requirements come from clients, 
+ * so they are normalized before they become a key: only tuples that 
+ * can match something are kept, and there are finitely many of them. */
+GList *
+gc_master_index_get_providers (GcInterfaceFlags      iface_type,
+                               GeoclueAccuracyLevel  min_accuracy,
+                               gboolean              can_update,
+                               GeoclueResourceFlags  allowed)
+{
+	GList *p;
+	char *key;
+	
+	if (!provider_index.results) {
+		return NULL;
+	}
+	if ((iface_type & ~GC_IFACE_ALL) ||
+	    min_accuracy > GEOCLUE_ACCURACY_LEVEL_DETAILED) {
+		/* nobody provides these */
+		return NULL;
+	}
+	min_accuracy = MAX (min_accuracy, GEOCLUE_ACCURACY_LEVEL_NONE);
+	allowed &= GEOCLUE_RESOURCE_ALL;
+	
+	key = g_strdup_printf ("%d:%d:%d:%d", iface_type, min_accuracy,
+	                       can_update ? 1 : 0, allowed);
+	if (g_hash_table_lookup_extended (provider_index.results, key,
+	                                  NULL, (gpointer *) &p)) {
+		g_free (key);
+	} else {
+		p = gc_master_index_match (iface_type, min_accuracy, 
+		                           can_update, allowed);
+		g_hash_table_insert (provider_index.results, key, p);
+	}
+	
+	return g_list_copy (p);
+}
@@ -0,0 +1,40 @@
+/*
+ * Geoclue
+ * master-index.h - Bitset index matching providers to requirements
+ *
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _MASTER_INDEX_H_
+#define _MASTER_INDEX_H_
+
+#include <glib.h>
+#include <geoclue/geoclue-types.h>
+#include "master-provider.h"
+
+G_BEGIN_DECLS
+
+void gc_master_index_build (GList *providers);
+GList *gc_master_index_get_providers (GcInterfaceFlags      iface_type,
+                                      GeoclueAccuracyLevel  min_accuracy,
+                                      gboolean              can_update,
+                                      GeoclueResourceFlags  allowed);
+
+G_END_DECLS
+
+#endif /* _MASTER_INDEX_H_ */
@@ -28,26 +28,29 @@
  *  Provider object for GcMaster. Takes care of cacheing 
  *  queried data.
  * 
- *  Should probably start/stop the actual providers as needed
- *  in the future
+ *  Providers are started when the first client subscribes and
+ *  stopped when the last one has been gone for LingerTimeout seconds.
  *  
- *  Cache could also be used to save "stale" data for situations when 
- *  current data is not available (MasterClient api would have to 
- *  have a "allowOldData" setting)
+ *  The last successfully queried data is kept apart from the cache, 
+ *  so clients that set "allow old data" can be answered right away 
+ *  (and when current data is not available) while a refresh runs in 
+ *  the background.
  * 
- * TODO: 
- * 	figure out what to do if get_* returns GEOCLUE_ERROR_NOT_AVAILABLE.
- * 	Should try again, but when?
+ *  Providers that fail with GEOCLUE_ERROR_NOT_AVAILABLE are taken 
+ *  out of use by a circuit breaker and re-probed with backoff.
  * 
+ * TODO: 
  * 	implement velocity
  * 
  * 	implement other (non-updating) ifaces
  **/
 
 #include <string.h>
+#include <time.h>
 
 #include "main.h"
 #include "master-provider.h"
+#include "position-history.h"
 #include <geoclue/geoclue-position.h>
 #include <geoclue/geoclue-address.h>
 #include <geoclue/geoclue-marshal.h>
@@ -58,6 +61,40 @@ typedef enum _GeoclueProvideFlags {
 	GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION = 1 << 1,	/* data can be queried on new connection, and cached until connection ends */
 } GeoclueProvideFlags;
 
+/* Circuit breaker for providers that depend on a remote service:
+ * after FailureThreshold consecutive "not available" errors the breaker
+ * opens and the provider is reported unavailable. A timer with 
+ * exponential backoff (RetryDelay doubling up to MaxRetryDelay, 
+ * jittered so providers do not retry in lockstep) half-opens it again:
+ * the next query is let through as a probe, and closes the breaker on
+ * success or re-opens it with a longer delay on failure. */
+typedef enum {
+	GC_BREAKER_CLOSED,
+	GC_BREAKER_OPEN,
+	GC_BREAKER_HALF_OPEN
+} GcBreakerState;
+
+/* seconds a provider keeps running after its last client has left,
+ * so clients coming and going do not restart it every time */
+#define GC_MASTER_PROVIDER_DEFAULT_LINGER_TIMEOUT 30
+
+#define GC_MASTER_PROVIDER_DEFAULT_HISTORY_SIZE 64
+
+#define GC_BREAKER_DEFAULT_THRESHOLD 2
+#define GC_BREAKER_DEFAULT_RETRY_DELAY 15
+#define GC_BREAKER_DEFAULT_MAX_RETRY_DELAY 600
+
+typedef struct _GcBreaker {
+	GcBreakerState state;
+	int failures;     /* consecutive, while closed */
+	int trips;        /* times opened since last success */
+	guint timer;
+	
+	int threshold;
+	int retry_delay;  /* seconds */
+	int max_retry_delay;
+} GcBreaker;
+
 typedef struct _GcPositionCache {
 	int timestamp;
 	GeocluePositionFields fields;
@@ -70,7 +107,7 @@ typedef struct _GcPositionCache {
 
 typedef struct _GcAddressCache {
 	int timestamp;
-	GHashTable *details;
+	GcAddressSnapshot *details;
 	GeoclueAccuracy *accuracy;
 	GError *error;
 } GcAddressCache;
@@ -102,6 +139,31 @@ typedef struct _GcMasterProviderPrivate {
 	GeoclueAddress *address;
 	GcAddressCache address_cache;
 	
+	GHashTable *options; /* [Options] from .provider-file, or NULL */
+	
+	GcBreaker breaker;
+	
+	/* last data queried without error, for clients that allow old data */
+	GcPositionCache good_position;
+	time_t good_position_time; /* when it was stored, 0 if never */
+	GcAddressCache good_address;
+	time_t good_address_time;
+	guint refresh_source;
+	
+	GcPositionHistory *history; /* positions queried without error */
+	
+	/* D-Bus calls of initialize and update_cache still in flight */
+	int init_pending;
+	int update_pending;
+	gboolean init_failed;
+	gboolean update_failed;
+	gboolean deinit_pending; /* deinitialize once they have returned */
+	gboolean linger_deinit_pending; /* ...because the linger timer expired */
+	
+	int linger_timeout; /* seconds */
+	guint linger_source;
+	guint starts;
+	guint starts_avoided; /* clients that came back while lingering */
 } GcMasterProviderPrivate;
 
 enum {
@@ -109,6 +171,7 @@ enum {
 	ACCURACY_CHANGED,
 	POSITION_CHANGED,
 	ADDRESS_CHANGED,
+	CACHE_UPDATED,
 	LAST_SIGNAL
 };
 static guint32 signals[LAST_SIGNAL] = {0, };
@@ -156,7 +219,8 @@ gc_master_provider_get_provider (GcMasterProvider *master_provider)
 	return NULL;
 }
 
-static gboolean
+/* TRUE while the provider has been initialized and not stopped */
+gboolean
 gc_master_provider_is_running (GcMasterProvider *master_provider)
 {
 	return (gc_master_provider_get_provider (master_provider) != NULL);
@@ -169,7 +233,7 @@ gc_master_provider_handle_new_position_accuracy (GcMasterProvider *provider,
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
 	GeoclueAccuracyLevel old_level;
 	GeoclueAccuracyLevel new_level = GEOCLUE_ACCURACY_LEVEL_NONE;
-	double new_hor_acc, new_vert_acc;
+	double new_hor_acc = 0.0, new_vert_acc = 0.0;
 	
 	geoclue_accuracy_get_details (priv->position_cache.accuracy,
 	                              &old_level, NULL, NULL);
@@ -193,7 +257,7 @@ gc_master_provider_handle_new_address_accuracy (GcMasterProvider *provider,
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
 	GeoclueAccuracyLevel old_level;
 	GeoclueAccuracyLevel new_level = GEOCLUE_ACCURACY_LEVEL_NONE;
-	double new_hor_acc, new_vert_acc;
+	double new_hor_acc = 0.0, new_vert_acc = 0.0;
 	
 	geoclue_accuracy_get_details (priv->address_cache.accuracy,
 	                              &old_level, NULL, NULL);
@@ -210,6 +274,87 @@ gc_master_provider_handle_new_address_accuracy (GcMasterProvider *provider,
 	}
 }
 
+static void
+gc_master_provider_store_good_position (GcMasterProvider      *provider,
+                                        GeocluePositionFields  fields,
+                                        int                    timestamp,
+                                        double                 latitude,
+                                        double                 longitude,
+                                        double                 altitude,
+                                        GeoclueAccuracy       *accuracy)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->good_position.fields = fields;
+	priv->good_position.timestamp = timestamp;
+	priv->good_position.latitude = latitude;
+	priv->good_position.longitude = longitude;
+	priv->good_position.altitude = altitude;
+	if (accuracy) {
+		*priv->good_position.accuracy = *accuracy;
+	} else {
+		geoclue_accuracy_set_details (priv->good_position.accuracy,
+		                              GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
+	}
+	priv->good_position_time = time (NULL);
+	
+	gc_position_history_append (priv->history, fields, timestamp,
+	                            latitude, longitude, altitude, 
+	                            priv->good_position.accuracy);
+}
+
+static void
+gc_master_provider_store_good_address (GcMasterProvider  *provider,
+                                       int                timestamp,
+                                       GcAddressSnapshot *details,
+                                       GeoclueAccuracy   *accuracy)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->good_address.timestamp = timestamp;
+	gc_address_snapshot_ref (details);
+	gc_address_snapshot_unref (priv->good_address.details);
+	priv->good_address.details = details;
+	if (accuracy) {
+		*priv->good_address.accuracy = *accuracy;
+	} else {
+		geoclue_accuracy_set_details (priv->good_address.accuracy,
+		                              GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
+	}
+	priv->good_address_time = time (NULL);
+}
+
+static gboolean
+gc_master_provider_position_is_cached (GcMasterProvider      *provider,
+                                       GeocluePositionFields  fields,
+                                       int                    timestamp,
+                                       double                 latitude,
+                                       double                 longitude,
+                                       double                 altitude,
+                                       GeoclueAccuracy       *accuracy)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE, cached_level;
+	double horizontal = 0.0, vertical = 0.0, cached_horizontal, cached_vertical;
+	
+	if (priv->position_cache.error ||
+	    priv->position_cache.fields != fields ||
+	    priv->position_cache.timestamp != timestamp ||
+	    priv->position_cache.latitude != latitude ||
+	    priv->position_cache.longitude != longitude ||
+	    priv->position_cache.altitude != altitude) {
+		return FALSE;
+	}
+	if (accuracy) {
+		geoclue_accuracy_get_details (accuracy, &level, &horizontal, &vertical);
+	}
+	geoclue_accuracy_get_details (priv->position_cache.accuracy,
+	                              &cached_level, &cached_horizontal, &cached_vertical);
+	return (level == cached_level &&
+	        horizontal == cached_horizontal &&
+	        vertical == cached_vertical);
+}
+
 static void
 gc_master_provider_set_position (GcMasterProvider      *provider,
                                  GeocluePositionFields  fields,
@@ -235,6 +380,9 @@ gc_master_provider_set_position (GcMasterProvider      *provider,
 	gc_master_provider_handle_new_position_accuracy (provider, accuracy);
 	
 	if (!error) {
+		gc_master_provider_store_good_position (provider, fields, timestamp,
+		                                        latitude, longitude, altitude,
+		                                        priv->position_cache.accuracy);
 		g_signal_emit (provider, signals[POSITION_CHANGED], 0, 
 		               fields, timestamp, 
 		               latitude, longitude, altitude, 
@@ -253,11 +401,12 @@ gc_master_provider_set_address (GcMasterProvider *provider,
 	
 	priv->address_cache.timestamp = timestamp;
 	
-	g_hash_table_destroy (priv->address_cache.details);
+	/* the only copy of the details: the cache, the clients and the 
+	 * signal all share it. A failed update has no details, keep the
+	 * old ones */
 	if (details) {
-		priv->address_cache.details = geoclue_address_details_copy (details);
-	}else {
-		priv->address_cache.details = geoclue_address_details_new ();
+		gc_address_snapshot_unref (priv->address_cache.details);
+		priv->address_cache.details = gc_address_snapshot_new (details);
 	}
 	copy_error (&priv->address_cache.error, error);
 	
@@ -266,6 +415,10 @@ gc_master_provider_set_address (GcMasterProvider *provider,
 	gc_master_provider_handle_new_address_accuracy (provider, accuracy);
 	
 	if (!error) {
+		gc_master_provider_store_good_address (provider, 
+		                                       priv->address_cache.timestamp,
+		                                       priv->address_cache.details,
+		                                       priv->address_cache.accuracy);
 		g_signal_emit (provider, signals[ADDRESS_CHANGED], 0, 
 		               priv->address_cache.timestamp, 
 		               priv->address_cache.details, 
@@ -351,6 +504,98 @@ parse_accuracy_string (char *str)
 	return level;
 }
 
+static gboolean
+gc_master_provider_uses_breaker (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	return (priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION ||
+	        priv->required_resources & GEOCLUE_RESOURCE_NETWORK);
+}
+
+static void
+gc_master_provider_breaker_stop_timer (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (priv->breaker.timer) {
+		g_source_remove (priv->breaker.timer);
+		priv->breaker.timer = 0;
+	}
+}
+
+static gboolean update_cache_and_deinit (GcMasterProvider *provider);
+static void gc_master_provider_update_cache (GcMasterProvider *master_provider);
+static void gc_master_provider_handle_status_change (GcMasterProvider *provider);
+
+static gboolean
+gc_master_provider_breaker_expired (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->breaker.timer = 0;
+	if (priv->net_status != GEOCLUE_CONNECTIVITY_ONLINE &&
+	    priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION) {
+		/* stay open, going online will probe */
+		return FALSE;
+	}
+	
+	g_debug ("%s: circuit breaker half-open, probing", priv->name);
+	priv->breaker.state = GC_BREAKER_HALF_OPEN;
+	
+	if (!(priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION)) {
+		/* next client query is the probe */
+		gc_master_provider_handle_status_change (provider);
+	} else if (gc_master_provider_get_provider (provider)) {
+		gc_master_provider_update_cache (provider);
+	} else {
+		update_cache_and_deinit (provider);
+	}
+	return FALSE;
+}
+
+static void
+gc_master_provider_breaker_open (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	GcBreaker *breaker = &priv->breaker;
+	double delay;
+	int i;
+	
+	delay = breaker->retry_delay;
+	for (i = 0; i < breaker->trips && delay < breaker->max_retry_delay; i++) {
+		delay *= 2;
+	}
+	delay = MIN (delay, breaker->max_retry_delay);
+	delay *= g_random_double_range (0.75, 1.25);
+	
+	breaker->state = GC_BREAKER_OPEN;
+	breaker->failures = 0;
+	breaker->trips++;
+	
+	gc_master_provider_breaker_stop_timer (provider);
+	breaker->timer = g_timeout_add ((guint) (delay * 1000),
+	                                (GSourceFunc) gc_master_provider_breaker_expired,
+	                                provider);
+	g_debug ("%s: circuit breaker open, retrying in %.1f s", 
+	         priv->name, delay);
+}
+
+/* a query went through, close the breaker */
+static void
+gc_master_provider_handle_success (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (priv->breaker.state != GC_BREAKER_CLOSED) {
+		g_debug ("%s: circuit breaker closed", priv->name);
+		gc_master_provider_breaker_stop_timer (provider);
+		priv->breaker.state = GC_BREAKER_CLOSED;
+	}
+	priv->breaker.failures = 0;
+	priv->breaker.trips = 0;
+}
+
 static void
 gc_master_provider_handle_error (GcMasterProvider *provider, GError *error)
 {
@@ -361,12 +606,38 @@ gc_master_provider_handle_error (GcMasterProvider *provider, GError *error)
 	priv = GET_PRIVATE (provider);
 	g_debug ("%s handling error %d", priv->name, error->code);
 	
-	/* web service providers that are unavailable */
-	if (priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION && 
-	    error->code == GEOCLUE_ERROR_NOT_AVAILABLE) {
-		priv->master_status = GEOCLUE_STATUS_UNAVAILABLE;
-		/* TODO set timer to re-check availability */
+	/* providers whose (web) service is unavailable */
+	if (error->code != GEOCLUE_ERROR_NOT_AVAILABLE ||
+	    !gc_master_provider_uses_breaker (provider)) {
+		return;
 	}
+	
+	switch (priv->breaker.state) {
+		case GC_BREAKER_CLOSED:
+			priv->breaker.failures++;
+			if (priv->breaker.failures >= priv->breaker.threshold) {
+				gc_master_provider_breaker_open (provider);
+			}
+			break;
+		case GC_BREAKER_HALF_OPEN:
+			/* the probe failed */
+			gc_master_provider_breaker_open (provider);
+			break;
+		case GC_BREAKER_OPEN:
+			break;
+	}
+}
+
+/* feeds the result of a query made on behalf of a client to the breaker */
+static void
+gc_master_provider_handle_result (GcMasterProvider *provider, GError *error)
+{
+	if (error) {
+		gc_master_provider_handle_error (provider, error);
+	} else {
+		gc_master_provider_handle_success (provider);
+	}
+	gc_master_provider_handle_status_change (provider);
 }
 
 /* Sets master_status based on provider status and net_status
@@ -405,6 +676,10 @@ gc_master_provider_handle_status_change (GcMasterProvider *provider)
 		new_master_status = priv->status;
 	}
 	
+	if (priv->breaker.state == GC_BREAKER_OPEN) {
+		new_master_status = GEOCLUE_STATUS_UNAVAILABLE;
+	}
+	
 	if (new_master_status != priv->master_status) {
 		priv->master_status = new_master_status;
 		
@@ -413,6 +688,104 @@ gc_master_provider_handle_status_change (GcMasterProvider *provider)
 }
 
 
+static void gc_master_provider_deinitialize (GcMasterProvider *provider);
+
+/* Called as each update_cache query returns */
+static void
+gc_master_provider_update_done (GcMasterProvider *master_provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	
+	priv->update_pending--;
+	if (priv->update_pending > 0) {
+		return;
+	}
+	
+	if (!priv->update_failed) {
+		gc_master_provider_handle_success (master_provider);
+	}
+	gc_master_provider_handle_status_change (master_provider);
+	
+	if (priv->deinit_pending) {
+		gc_master_provider_deinitialize (master_provider);
+	}
+	g_signal_emit (master_provider, signals[CACHE_UPDATED], 0);
+}
+
+static void
+update_position_callback (GeocluePosition       *position,
+                          GeocluePositionFields  fields,
+                          int                    timestamp,
+                          double                 latitude,
+                          double                 longitude,
+                          double                 altitude,
+                          GeoclueAccuracy       *accuracy,
+                          GError                *error,
+                          GcMasterProvider      *master_provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	
+	if (error) {
+		/* the out arguments of a failed call are not set */
+		g_warning ("Error updating position cache: %s", error->message);
+		gc_master_provider_handle_error (master_provider, error);
+		priv->update_failed = TRUE;
+		gc_master_provider_set_position (master_provider,
+		                                 GEOCLUE_POSITION_FIELDS_NONE, 0,
+		                                 0.0, 0.0, 0.0,
+		                                 NULL, error);
+		g_error_free (error);
+	} else {
+		gc_master_provider_set_position (master_provider,
+		                                 fields, timestamp,
+		                                 latitude, longitude, altitude,
+		                                 accuracy, NULL);
+		geoclue_accuracy_free (accuracy);
+	}
+	
+	gc_master_provider_update_done (master_provider);
+	g_object_unref (position);
+	g_object_unref (master_provider);
+}
+
+static void
+update_address_callback (GeoclueAddress   *address,
+                         int               timestamp,
+                         GHashTable       *details,
+                         GeoclueAccuracy  *accuracy,
+                         GError           *error,
+                         GcMasterProvider *master_provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	
+	if (error) {
+		/* the out arguments of a failed call are not set */
+		g_warning ("Error updating address cache: %s", error->message);
+		gc_master_provider_handle_error (master_provider, error);
+		priv->update_failed = TRUE;
+		gc_master_provider_set_address (master_provider, 0,
+		                                NULL, NULL, error);
+		g_error_free (error);
+	} else {
+		gc_master_provider_set_address (master_provider,
+		                                timestamp,
+		                                details,
+		                                accuracy,
+		                                NULL);
+		if (details) {
+			g_hash_table_destroy (details);
+		}
+		geoclue_accuracy_free (accuracy);
+	}
+	
+	gc_master_provider_update_done (master_provider);
+	g_object_unref (address);
+	g_object_unref (master_provider);
+}
+
+/* Queries position and address from the provider without blocking: 
+ * both calls are in flight at the same time and the cache is updated 
+ * as the replies come in. Status is ACQUIRING until both have returned. */
 static void 
 gc_master_provider_update_cache (GcMasterProvider *master_provider)
 {
@@ -425,55 +798,41 @@ gc_master_provider_update_cache (GcMasterProvider *master_provider)
 		/* non-cacheable provider or provider not running */
 		return;
 	}
+	if (priv->init_pending > 0 || priv->update_pending > 0) {
+		/* initialization ends with an update, or one is in flight */
+		return;
+	}
 	
 	g_debug ("%s: Updating cache ", priv->name);
 	priv->master_status = GEOCLUE_STATUS_ACQUIRING;
 	g_signal_emit (master_provider, signals[STATUS_CHANGED], 0, priv->master_status);
 	
+	priv->update_failed = FALSE;
 	if (priv->position) {
-		int timestamp;
-		double lat, lon, alt;
-		GeocluePositionFields fields;
-		GeoclueAccuracy *accuracy = NULL;
-		GError *error = NULL;
-		
-		fields = geoclue_position_get_position (priv->position,
-							&timestamp,
-							&lat, &lon, &alt,
-							&accuracy, 
-							&error);
-		if (error){
-			g_warning ("Error updating position cache: %s", error->message);
-			gc_master_provider_handle_error (master_provider, error);
-		}
-		gc_master_provider_set_position (master_provider,
-		                                 fields, timestamp,
-		                                 lat, lon, alt,
-		                                 accuracy, error);
+		priv->update_pending++;
 	}
-	
 	if (priv->address) {
-		int timestamp;
-		GHashTable *details = NULL;
-		GeoclueAccuracy *accuracy = NULL;
-		GError *error = NULL;
-		
-		if (!geoclue_address_get_address (priv->address,
-		                                  &timestamp,
-		                                  &details,
-		                                  &accuracy,
-		                                  &error)) {
-			g_warning ("Error updating address cache: %s", error->message);
-			gc_master_provider_handle_error (master_provider, error);
-		}
-		gc_master_provider_set_address (master_provider,
-		                                timestamp,
-		                                details,
-		                                accuracy,
-		                                error);
+		priv->update_pending++;
+	}
+	if (priv->update_pending == 0) {
+		/* nothing to cache */
+		gc_master_provider_handle_status_change (master_provider);
+		g_signal_emit (master_provider, signals[CACHE_UPDATED], 0);
+		return;
 	}
 	
-	gc_master_provider_handle_status_change (master_provider);
+	if (priv->position) {
+		g_object_ref (master_provider);
+		geoclue_position_get_position_async (g_object_ref (priv->position),
+		                                     (GeocluePositionCallback) update_position_callback,
+		                                     master_provider);
+	}
+	if (priv->address) {
+		g_object_ref (master_provider);
+		geoclue_address_get_address_async (g_object_ref (priv->address),
+		                                   (GeoclueAddressCallback) update_address_callback,
+		                                   master_provider);
+	}
 }
 
 /* signal handlers for the actual providers signals */
@@ -499,8 +858,14 @@ position_changed (GeocluePosition      *position,
                   GeoclueAccuracy      *accuracy,
                   GcMasterProvider     *provider)
 {
-	/* is there a situation when we'd need to check against cache 
-	 * if data has really changed? probably not */
+	/* providers may re-send an unchanged position, e.g. when 
+	 * another client of theirs asks for it: nobody needs to hear it twice */
+	if (gc_master_provider_position_is_cached (provider,
+	                                           fields, timestamp,
+	                                           latitude, longitude, altitude,
+	                                           accuracy)) {
+		return;
+	}
 	gc_master_provider_set_position (provider,
 	                                 fields, timestamp,
 	                                 latitude, longitude, altitude,
@@ -531,6 +896,10 @@ finalize (GObject *object)
 	
 	geoclue_accuracy_free (priv->position_cache.accuracy);
 	geoclue_accuracy_free (priv->address_cache.accuracy);
+	geoclue_accuracy_free (priv->good_position.accuracy);
+	geoclue_accuracy_free (priv->good_address.accuracy);
+	gc_position_history_free (priv->history);
+	gc_address_snapshot_unref (priv->good_address.details);
 	if (priv->position_cache.error) {
 		g_error_free (priv->position_cache.error);
 	}
@@ -543,6 +912,10 @@ finalize (GObject *object)
 	g_free (priv->service);
 	g_free (priv->path);
 	
+	if (priv->options) {
+		g_hash_table_destroy (priv->options);
+	}
+	
 	g_free (priv->position_clients);
 	g_free (priv->address_clients);
 	
@@ -554,6 +927,16 @@ dispose (GObject *object)
 {
 	GcMasterProviderPrivate *priv = GET_PRIVATE (object);
 	
+	gc_master_provider_breaker_stop_timer (GC_MASTER_PROVIDER (object));
+	if (priv->refresh_source) {
+		g_source_remove (priv->refresh_source);
+		priv->refresh_source = 0;
+	}
+	if (priv->linger_source) {
+		g_source_remove (priv->linger_source);
+		priv->linger_source = 0;
+	}
+	
 	if (priv->position) {
 		g_object_unref (priv->position);
 		priv->position = NULL;
@@ -564,7 +947,7 @@ dispose (GObject *object)
 		priv->address = NULL;
 	}
 	if (priv->address_cache.details) {
-		g_hash_table_destroy (priv->address_cache.details);
+		gc_address_snapshot_unref (priv->address_cache.details);
 		priv->address_cache.details = NULL;
 	}
 	
@@ -621,6 +1004,14 @@ gc_master_provider_class_init (GcMasterProviderClass *klass)
 						 G_TYPE_INT, 
 						 G_TYPE_POINTER,
 						 G_TYPE_POINTER);
+	signals[CACHE_UPDATED] = g_signal_new ("cache-updated",
+					       G_TYPE_FROM_CLASS (klass),
+					       G_SIGNAL_RUN_FIRST |
+					       G_SIGNAL_NO_RECURSE,
+					       G_STRUCT_OFFSET (GcMasterProviderClass, cache_updated), 
+					       NULL, NULL,
+					       g_cclosure_marshal_VOID__VOID,
+					       G_TYPE_NONE, 0);
 }
 
 static void
@@ -641,8 +1032,39 @@ gc_master_provider_init (GcMasterProvider *provider)
 	priv->address = NULL;
 	priv->address_cache.accuracy = 
 		geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0 ,0);
-	priv->address_cache.details = geoclue_address_details_new ();
+	priv->address_cache.details = gc_address_snapshot_new (NULL);
 	priv->address_cache.error = NULL;
+	
+	priv->breaker.state = GC_BREAKER_CLOSED;
+	priv->breaker.failures = 0;
+	priv->breaker.trips = 0;
+	priv->breaker.timer = 0;
+	priv->breaker.threshold = GC_BREAKER_DEFAULT_THRESHOLD;
+	priv->breaker.retry_delay = GC_BREAKER_DEFAULT_RETRY_DELAY;
+	priv->breaker.max_retry_delay = GC_BREAKER_DEFAULT_MAX_RETRY_DELAY;
+	
+	memset (&priv->good_position, 0, sizeof (GcPositionCache));
+	memset (&priv->good_address, 0, sizeof (GcAddressCache));
+	priv->good_position.accuracy = 
+		geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0 ,0);
+	priv->good_address.accuracy = 
+		geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0 ,0);
+	priv->good_position_time = 0;
+	priv->good_address_time = 0;
+	priv->refresh_source = 0;
+	priv->history = NULL;
+	
+	priv->init_pending = 0;
+	priv->update_pending = 0;
+	priv->init_failed = FALSE;
+	priv->update_failed = FALSE;
+	priv->deinit_pending = FALSE;
+	priv->linger_deinit_pending = FALSE;
+	
+	priv->linger_timeout = GC_MASTER_PROVIDER_DEFAULT_LINGER_TIMEOUT;
+	priv->linger_source = 0;
+	priv->starts = 0;
+	priv->starts_avoided = 0;
 }
 
 #if DEBUG_INFO
@@ -690,7 +1112,7 @@ static void
 gc_master_provider_dump_address (GcMasterProvider *provider)
 {
 	int time;
-	GHashTable *details;
+	GcAddressSnapshot *details;
 	GError *error = NULL;
 	
 	g_print ("     Address Information:\n");
@@ -704,7 +1126,9 @@ gc_master_provider_dump_address (GcMasterProvider *provider)
 		return;
 	}
 	g_print ("       Timestamp: %d\n", time);
-	g_hash_table_foreach (details, (GHFunc)dump_address_key_and_value, NULL);
+	g_hash_table_foreach (gc_address_snapshot_get_table (details), 
+	                      (GHFunc)dump_address_key_and_value, NULL);
+	gc_address_snapshot_unref (details);
 	
 }
 
@@ -768,42 +1192,147 @@ gc_master_provider_dump_provider_details (GcMasterProvider *provider)
 }
 #endif
 
-static gboolean
-gc_master_provider_initialize_geoclue (GcMasterProvider *master_provider)
+static void
+copy_option (gpointer key, gpointer value, gpointer user_data)
 {
-	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
-	GeoclueProvider *geoclue;
-	GError *error = NULL;
+	g_hash_table_insert ((GHashTable *) user_data,
+	                     g_strdup (key), g_strdup (value));
+}
+
+/* Returns the options to send to the provider: main options, 
+ * overridden by options from the .provider-file with the same name. */
+static GHashTable *
+gc_master_provider_build_options (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	GHashTable *main_options, *options;
 	
-	geoclue = gc_master_provider_get_provider (master_provider);
+	options = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	main_options = geoclue_get_main_options ();
+	if (main_options) {
+		g_hash_table_foreach (main_options, copy_option, options);
+	}
+	if (priv->options) {
+		g_hash_table_foreach (priv->options, copy_option, options);
+	}
+	return options;
+}
+
+static void gc_master_provider_initialize_done (GcMasterProvider *provider);
+
+static void
+init_options_callback (GeoclueProvider  *geoclue,
+                       GError           *error,
+                       GcMasterProvider *master_provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
 	
-	if (!geoclue_provider_set_options (geoclue,
-	                                   geoclue_get_main_options (),
-	                                   &error)) {
+	if (error) {
 		g_warning ("Error setting provider options: %s\n", error->message);
 		g_error_free (error);
-		return FALSE;
+		priv->init_failed = TRUE;
 	}
+	gc_master_provider_initialize_done (master_provider);
+	g_object_unref (geoclue);
+	g_object_unref (master_provider);
+}
+
+static void
+init_info_callback (GeoclueProvider  *geoclue,
+                    char             *name,
+                    char             *description,
+                    GError           *error,
+                    GcMasterProvider *master_provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
 	
-	/* priv->name has been read from .provider-file earlier...
-	 * could ask the provider anyway, just to be consistent */
-	if (!geoclue_provider_get_provider_info (geoclue, NULL, 
-	                                         &priv->description, &error)) {
+	if (error) {
 		g_warning ("Error getting provider info: %s\n", error->message);
 		g_error_free (error);
-		return FALSE;
+		priv->init_failed = TRUE;
+	} else {
+		/* priv->name has been read from .provider-file earlier...
+		 * could use the provider's, just to be consistent */
+		g_free (priv->description);
+		priv->description = description;
+		description = NULL;
+	}
+	g_free (name);
+	g_free (description);
+	
+	gc_master_provider_initialize_done (master_provider);
+	g_object_unref (geoclue);
+	g_object_unref (master_provider);
+}
+
+static void
+init_status_callback (GeoclueProvider  *geoclue,
+                      GeoclueStatus     status,
+                      GError           *error,
+                      GcMasterProvider *master_provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	
+	if (error) {
+		g_warning ("Error getting provider status: %s\n", error->message);
+		g_error_free (error);
+		priv->init_failed = TRUE;
+	} else {
+		priv->status = status;
 	}
+	gc_master_provider_initialize_done (master_provider);
+	g_object_unref (geoclue);
+	g_object_unref (master_provider);
+}
+
+static void
+options_callback (GeoclueProvider  *geoclue,
+                  GError           *error,
+                  GcMasterProvider *master_provider)
+{
+	if (error) {
+		g_warning ("Error setting provider options: %s\n", error->message);
+		g_error_free (error);
+	}
+	g_object_unref (geoclue);
+	g_object_unref (master_provider);
+}
+
+/* Sends options, and asks for provider info and status. The calls 
+ * are made at once, so their round trips overlap; 
+ * gc_master_provider_initialize_done() runs when all have returned. */
+static void
+gc_master_provider_initialize_geoclue (GcMasterProvider *master_provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	GeoclueProvider *geoclue;
+	GHashTable *options;
+	
+	geoclue = gc_master_provider_get_provider (master_provider);
 	
 	g_signal_connect (G_OBJECT (geoclue), "status-changed",
 			  G_CALLBACK (provider_status_changed), master_provider);
 	
-	
-	if (!geoclue_provider_get_status (geoclue, &priv->status, &error)) {
-		g_warning ("Error getting provider status: %s\n", error->message);
-		g_error_free (error);
-		return FALSE;
-	}
-	return TRUE;
+	priv->init_failed = FALSE;
+	priv->init_pending = 3;
+	
+	/* the arguments are marshalled right away */
+	options = gc_master_provider_build_options (master_provider);
+	g_object_ref (master_provider);
+	geoclue_provider_set_options_async (g_object_ref (geoclue), options,
+	                                    (GeoclueProviderOptionsCallback) init_options_callback,
+	                                    master_provider);
+	g_hash_table_destroy (options);
+	
+	g_object_ref (master_provider);
+	geoclue_provider_get_provider_info_async (g_object_ref (geoclue),
+	                                          (GeoclueProviderInfoCallback) init_info_callback,
+	                                          master_provider);
+	
+	g_object_ref (master_provider);
+	geoclue_provider_get_status_async (g_object_ref (geoclue),
+	                                   (GeoclueProviderStatusCallback) init_status_callback,
+	                                   master_provider);
 }
 
 static gboolean
@@ -835,14 +1364,15 @@ gc_master_provider_initialize_interfaces (GcMasterProvider *provider)
 		                  G_CALLBACK (address_changed), provider);
 	}
 	
-	if (!gc_master_provider_initialize_geoclue (provider)) {
-		return FALSE;
-	}
+	gc_master_provider_initialize_geoclue (provider);
 	
 	return TRUE;
 }
 
 
+/* Starts the provider. Returns FALSE if that failed right away; 
+ * otherwise the provider is ACQUIRING until it has answered the 
+ * initialization calls and the first update_cache. */
 static gboolean
 gc_master_provider_initialize (GcMasterProvider *provider)
 {
@@ -850,22 +1380,70 @@ gc_master_provider_initialize (GcMasterProvider *provider)
 	 
 	priv = GET_PRIVATE (provider);
 	
+	priv->deinit_pending = FALSE;
+	priv->linger_deinit_pending = FALSE;
 	if (!gc_master_provider_initialize_interfaces (provider)) {
+		gc_master_provider_deinitialize (provider);
 		return FALSE;
 	}
 	
-	gc_master_provider_update_cache (provider);
+	priv->master_status = GEOCLUE_STATUS_ACQUIRING;
+	g_signal_emit (provider, signals[STATUS_CHANGED], 0, priv->master_status);
+	return TRUE;
+}
+
+static void
+gc_master_provider_initialize_done (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->init_pending--;
+	if (priv->init_pending > 0) {
+		return;
+	}
+	
+	if (priv->init_failed) {
+		g_warning ("Could not initialize %s", priv->name);
+		gc_master_provider_deinitialize (provider);
+		priv->status = GEOCLUE_STATUS_ERROR;
+		gc_master_provider_handle_status_change (provider);
+		g_signal_emit (provider, signals[CACHE_UPDATED], 0);
+		return;
+	}
+	
+	if (priv->provides & GEOCLUE_PROVIDE_UPDATES) {
+		gc_master_provider_update_cache (provider);
+	} else {
+		gc_master_provider_handle_status_change (provider);
+		if (priv->deinit_pending) {
+			gc_master_provider_deinitialize (provider);
+		}
+	}
 #if DEBUG_INFO
 	gc_master_provider_dump_provider_details (provider);
 #endif
-	return TRUE;
 }
 
+/* Stops using the provider, once the calls in flight have returned */
 static void
 gc_master_provider_deinitialize (GcMasterProvider *provider)
 {
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	GeoclueProvider *geoclue;
+	
+	if (priv->init_pending > 0 || priv->update_pending > 0) {
+		priv->deinit_pending = TRUE;
+		return;
+	}
+	priv->deinit_pending = FALSE;
+	priv->linger_deinit_pending = FALSE;
 	
+	geoclue = gc_master_provider_get_provider (provider);
+	if (geoclue) {
+		g_signal_handlers_disconnect_by_func (geoclue, 
+		                                      provider_status_changed,
+		                                      provider);
+	}
 	if (priv->position) {
 		g_object_unref (priv->position);
 		priv->position = NULL;
@@ -890,10 +1468,13 @@ network_status_changed (gpointer *connectivity,
 	/* update connection-cacheable providers */
 	if (status == GEOCLUE_CONNECTIVITY_ONLINE &&
 	    priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION) {
-		/* intialize to fill cache (this will handle status change) */
-		if (gc_master_provider_initialize (provider)) {
-			gc_master_provider_deinitialize (provider);
+		/* a new connection is worth a probe even if the breaker is open */
+		if (priv->breaker.state == GC_BREAKER_OPEN) {
+			gc_master_provider_breaker_stop_timer (provider);
+			priv->breaker.state = GC_BREAKER_HALF_OPEN;
 		}
+		/* GcMaster warms up the cache (this will handle status change),
+		 * see gc_master_provider_warm_up () */
 	} else {
 		gc_master_provider_handle_status_change (provider);
 	}
@@ -903,7 +1484,13 @@ network_status_changed (gpointer *connectivity,
 static gboolean
 update_cache_and_deinit (GcMasterProvider *provider)
 {
-	/* fill cache */
+	if (gc_master_provider_is_running (provider)) {
+		/* still running from an earlier call */
+		gc_master_provider_update_cache (provider);
+		return FALSE;
+	}
+	
+	/* fill cache, deinitialize when done */
 	if (gc_master_provider_initialize (provider)) {
 		gc_master_provider_deinitialize (provider);
 	}
@@ -911,6 +1498,20 @@ update_cache_and_deinit (GcMasterProvider *provider)
 }
 
 
+static int
+get_positive_integer (GKeyFile *keyfile, const char *key, int default_value)
+{
+	GError *error = NULL;
+	int value;
+	
+	value = g_key_file_get_integer (keyfile, "Geoclue Provider", key, &error);
+	if (error) {
+		g_error_free (error);
+		return default_value;
+	}
+	return value > 0 ? value : default_value;
+}
+
 /* public methods (for GcMaster and GcMasterClient) */
 
 /* Loads provider details from 'filename' */ 
@@ -924,7 +1525,7 @@ gc_master_provider_new (const char *filename,
 	GError *error = NULL;
 	gboolean ret;
 	char *accuracy_str; 
-	char **flags, **interfaces;
+	char **flags, **interfaces, **keys;
 	
 	keyfile = g_key_file_new ();
 	ret = g_key_file_load_from_file (keyfile, filename, 
@@ -1000,6 +1601,20 @@ gc_master_provider_new (const char *filename,
 		priv->net_status = geoclue_connectivity_get_status (connectivity);
 	}
 	
+	priv->linger_timeout = get_positive_integer (keyfile, "LingerTimeout",
+	                                             priv->linger_timeout);
+	priv->history = gc_position_history_new 
+		(get_positive_integer (keyfile, "HistorySize",
+		                       GC_MASTER_PROVIDER_DEFAULT_HISTORY_SIZE));
+	
+	/* optional circuit breaker tuning */
+	priv->breaker.threshold = get_positive_integer (keyfile, "FailureThreshold",
+	                                                priv->breaker.threshold);
+	priv->breaker.retry_delay = get_positive_integer (keyfile, "RetryDelay",
+	                                                  priv->breaker.retry_delay);
+	priv->breaker.max_retry_delay = get_positive_integer (keyfile, "MaxRetryDelay",
+	                                                      priv->breaker.max_retry_delay);
+	
 	priv->interfaces = GC_IFACE_GEOCLUE;
 	interfaces = g_key_file_get_string_list (keyfile, 
 	                                         "Geoclue Provider",
@@ -1010,14 +1625,44 @@ gc_master_provider_new (const char *filename,
 		g_strfreev (interfaces);
 	}
 	
-	if (priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION &&
-	    priv->net_status == GEOCLUE_CONNECTIVITY_ONLINE) {
-		/* do this as idle so we can return without waiting for http queries */
-		g_idle_add ((GSourceFunc)update_cache_and_deinit, provider);
+	/* provider specific options to pass in SetOptions */
+	keys = g_key_file_get_keys (keyfile, "Options", NULL, NULL);
+	if (keys) {
+		int i;
+		
+		priv->options = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                       g_free, g_free);
+		for (i = 0; keys[i]; i++) {
+			g_hash_table_insert (priv->options, g_strdup (keys[i]),
+			                     g_key_file_get_value (keyfile, "Options",
+			                                           keys[i], NULL));
+		}
+		g_strfreev (keys);
 	}
+	
+	/* GcMaster warms up the cache of connection-cacheable providers */
 	return provider;
 }
 
+/* GcMaster calls this to fill the cache of a connection-cacheable 
+ * provider when the connection comes up. Returns TRUE if an update 
+ * was started: "cache-updated" is emitted when it has finished. */
+gboolean
+gc_master_provider_warm_up (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (!(priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION) ||
+	    priv->net_status != GEOCLUE_CONNECTIVITY_ONLINE) {
+		return FALSE;
+	}
+	
+	update_cache_and_deinit (provider);
+	
+	/* still running while the update is in flight */
+	return gc_master_provider_is_running (provider);
+}
+
 /* client calls this when it wants to use the provider. 
    Returns true if provider was actually started, and 
    client should assume accuracy has changed. 
@@ -1031,10 +1676,32 @@ gc_master_provider_subscribe (GcMasterProvider *provider,
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
 	gboolean started = FALSE;
 	
+	if (priv->linger_source) {
+		/* still running, no need to start it again */
+		g_source_remove (priv->linger_source);
+		priv->linger_source = 0;
+		priv->starts_avoided++;
+		g_debug ("%s has a client again (%u starts, %u avoided)", 
+		         priv->name, priv->starts, priv->starts_avoided);
+	} else if (priv->linger_deinit_pending) {
+		/* the linger timer expired while calls were in flight: 
+		 * keep the provider instead of stopping it when they return.
+		 * Other deferred deinits, such as the one that follows a
+		 * cache update of a connection-cacheable provider, stay. */
+		priv->deinit_pending = FALSE;
+		priv->linger_deinit_pending = FALSE;
+		priv->starts_avoided++;
+		g_debug ("%s has a client again before stopping (%u starts, %u avoided)", 
+		         priv->name, priv->starts, priv->starts_avoided);
+	}
+	
 	/* decide wether to run initialize or not */
 	if (!gc_master_provider_is_running (provider)) {
 		if (!(priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION)) {
 			started = gc_master_provider_initialize (provider);
+			if (started) {
+				priv->starts++;
+			}
 		}
 	}
 	
@@ -1053,6 +1720,19 @@ gc_master_provider_subscribe (GcMasterProvider *provider,
 	return started;
 }
 
+static gboolean
+gc_master_provider_linger_expired (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->linger_source = 0;
+	g_debug ("%s unused for %d s, shutting down", 
+	         priv->name, priv->linger_timeout);
+	gc_master_provider_deinitialize (provider);
+	priv->linger_deinit_pending = priv->deinit_pending;
+	return FALSE;
+}
+
 /* client calls this when it does not intend to use the provider */
 void
 gc_master_provider_unsubscribe (GcMasterProvider *provider,
@@ -1070,11 +1750,18 @@ gc_master_provider_unsubscribe (GcMasterProvider *provider,
 	
 	if (!priv->position_clients &&
 	    !priv->address_clients) {
-		/* no one is using this provider, shutdown... */
+		/* no one is using this provider, shutdown after a while... */
 		/* not clearing cached accuracies on purpose */
 		g_debug ("%s without clients", priv->name);
 		
-		/* gc_master_provider_deinitialize (provider); */
+		if (!(priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION) &&
+		    gc_master_provider_is_running (provider) &&
+		    priv->linger_source == 0) {
+			priv->linger_source = 
+				g_timeout_add_seconds (priv->linger_timeout,
+				                       (GSourceFunc) gc_master_provider_linger_expired,
+				                       provider);
+		}
 	}
 }
 
@@ -1115,22 +1802,37 @@ gc_master_provider_get_position (GcMasterProvider *provider,
 		}
 		return priv->position_cache.fields;
 	} else {
-		return geoclue_position_get_position (priv->position,
-		                                      timestamp,
-		                                      latitude, 
-		                                      longitude, 
-		                                      altitude,
-		                                      accuracy, 
-		                                      error);
+		GeocluePositionFields fields;
+		GError *position_error = NULL;
+		
+		fields = geoclue_position_get_position (priv->position,
+		                                        timestamp,
+		                                        latitude, 
+		                                        longitude, 
+		                                        altitude,
+		                                        accuracy, 
+		                                        &position_error);
+		gc_master_provider_handle_result (provider, position_error);
+		if (position_error) {
+			g_propagate_error (error, position_error);
+		} else {
+			gc_master_provider_store_good_position (provider, fields, 
+			                                        timestamp ? *timestamp : time (NULL),
+			                                        latitude ? *latitude : 0.0,
+			                                        longitude ? *longitude : 0.0,
+			                                        altitude ? *altitude : 0.0,
+			                                        accuracy ? *accuracy : NULL);
+		}
+		return fields;
 	}
 }
 
 gboolean 
-gc_master_provider_get_address (GcMasterProvider  *provider,
-                                int               *timestamp,
-                                GHashTable       **details,
-                                GeoclueAccuracy  **accuracy,
-                                GError           **error)
+gc_master_provider_get_address (GcMasterProvider   *provider,
+                                int                *timestamp,
+                                GcAddressSnapshot **details,
+                                GeoclueAccuracy   **accuracy,
+                                GError            **error)
 {
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
 	if (priv->provides & GEOCLUE_PROVIDE_UPDATES) {
@@ -1139,7 +1841,7 @@ gc_master_provider_get_address (GcMasterProvider  *provider,
 			*timestamp = priv->address_cache.timestamp;
 		}
 		if (details != NULL) {
-			*details = geoclue_address_details_copy (priv->address_cache.details);
+			*details = gc_address_snapshot_ref (priv->address_cache.details);
 		}
 		if (accuracy != NULL) {
 			*accuracy = geoclue_accuracy_copy (priv->address_cache.accuracy);
@@ -1150,15 +1852,223 @@ gc_master_provider_get_address (GcMasterProvider  *provider,
 		}
 		return (!priv->address_cache.error);
 	} else {
+		gboolean ret;
+		GHashTable *address_details = NULL;
+		GcAddressSnapshot *snapshot;
+		GError *address_error = NULL;
+		
 		g_assert (priv->address);
-		return geoclue_address_get_address (priv->address,
-		                                    timestamp,
-		                                    details, 
-		                                    accuracy, 
-		                                    error);
+		ret = geoclue_address_get_address (priv->address,
+		                                   timestamp,
+		                                   &address_details, 
+		                                   accuracy, 
+		                                   &address_error);
+		gc_master_provider_handle_result (provider, address_error);
+		if (address_error) {
+			g_propagate_error (error, address_error);
+			return ret;
+		}
+		
+		snapshot = gc_address_snapshot_new (address_details);
+		if (address_details) {
+			g_hash_table_destroy (address_details);
+		}
+		gc_master_provider_store_good_address (provider, 
+		                                       timestamp ? *timestamp : time (NULL),
+		                                       snapshot,
+		                                       accuracy ? *accuracy : NULL);
+		if (details != NULL) {
+			*details = snapshot;
+		} else {
+			gc_address_snapshot_unref (snapshot);
+		}
+		return ret;
 	}
 }
 
+static void
+refresh_position_callback (GeocluePosition       *position,
+                           GeocluePositionFields  fields,
+                           int                    timestamp,
+                           double                 latitude,
+                           double                 longitude,
+                           double                 altitude,
+                           GeoclueAccuracy       *accuracy,
+                           GError                *error,
+                           GcMasterProvider      *provider)
+{
+	gc_master_provider_handle_result (provider, error);
+	if (error) {
+		g_error_free (error);
+	} else {
+		gc_master_provider_store_good_position (provider, fields, timestamp,
+		                                        latitude, longitude, altitude,
+		                                        accuracy);
+		geoclue_accuracy_free (accuracy);
+	}
+	g_object_unref (position);
+	g_object_unref (provider);
+}
+
+static void
+refresh_address_callback (GeoclueAddress   *address,
+                          int               timestamp,
+                          GHashTable       *details,
+                          GeoclueAccuracy  *accuracy,
+                          GError           *error,
+                          GcMasterProvider *provider)
+{
+	gc_master_provider_handle_result (provider, error);
+	if (error) {
+		g_error_free (error);
+	} else {
+		GcAddressSnapshot *snapshot;
+		
+		snapshot = gc_address_snapshot_new (details);
+		gc_master_provider_store_good_address (provider, timestamp,
+		                                       snapshot, accuracy);
+		gc_address_snapshot_unref (snapshot);
+		if (details) {
+			g_hash_table_destroy (details);
+		}
+		geoclue_accuracy_free (accuracy);
+	}
+	g_object_unref (address);
+	g_object_unref (provider);
+}
+
+static gboolean
+gc_master_provider_refresh_idle (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->refresh_source = 0;
+	g_debug ("%s: refreshing old data", priv->name);
+	
+	if (priv->provides & GEOCLUE_PROVIDE_UPDATES) {
+		if (gc_master_provider_is_running (provider)) {
+			gc_master_provider_update_cache (provider);
+		} else if (priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION &&
+		           priv->breaker.state != GC_BREAKER_OPEN &&
+		           priv->net_status == GEOCLUE_CONNECTIVITY_ONLINE) {
+			update_cache_and_deinit (provider);
+		}
+	} else {
+		/* query the pass-through provider without blocking the 
+		 * master; the callbacks store the result */
+		if (priv->position) {
+			g_object_ref (provider);
+			geoclue_position_get_position_async (g_object_ref (priv->position),
+			                                     (GeocluePositionCallback) refresh_position_callback,
+			                                     provider);
+		}
+		if (priv->address) {
+			g_object_ref (provider);
+			geoclue_address_get_address_async (g_object_ref (priv->address),
+			                                   (GeoclueAddressCallback) refresh_address_callback,
+			                                   provider);
+		}
+	}
+	return FALSE;
+}
+
+/* Queries the provider for new data from the main loop, unless that
+ * has been scheduled already */
+static void
+gc_master_provider_refresh (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (priv->refresh_source == 0) {
+		priv->refresh_source = 
+			g_idle_add ((GSourceFunc) gc_master_provider_refresh_idle, 
+			            provider);
+	}
+}
+
+/* Answers from the last data queried without error, if there is any
+ * that is at most @max_age seconds old (0 for any age), and schedules
+ * a refresh. Returns FALSE if there is no such data. */
+gboolean
+gc_master_provider_get_old_position (GcMasterProvider       *provider,
+                                     int                     max_age,
+                                     GeocluePositionFields  *fields,
+                                     int                    *timestamp,
+                                     double                 *latitude,
+                                     double                 *longitude,
+                                     double                 *altitude,
+                                     GeoclueAccuracy       **accuracy)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (priv->good_position_time == 0 ||
+	    (max_age > 0 && time (NULL) - priv->good_position_time > max_age)) {
+		return FALSE;
+	}
+	
+	*fields = priv->good_position.fields;
+	if (timestamp != NULL) {
+		*timestamp = priv->good_position.timestamp;
+	}
+	if (latitude != NULL) {
+		*latitude = priv->good_position.latitude;
+	}
+	if (longitude != NULL) {
+		*longitude = priv->good_position.longitude;
+	}
+	if (altitude != NULL) {
+		*altitude = priv->good_position.altitude;
+	}
+	if (accuracy != NULL) {
+		*accuracy = geoclue_accuracy_copy (priv->good_position.accuracy);
+	}
+	
+	gc_master_provider_refresh (provider);
+	return TRUE;
+}
+
+gboolean
+gc_master_provider_get_old_address (GcMasterProvider   *provider,
+                                    int                 max_age,
+                                    int                *timestamp,
+                                    GcAddressSnapshot **details,
+                                    GeoclueAccuracy   **accuracy)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (priv->good_address_time == 0 ||
+	    (max_age > 0 && time (NULL) - priv->good_address_time > max_age)) {
+		return FALSE;
+	}
+	
+	if (timestamp != NULL) {
+		*timestamp = priv->good_address.timestamp;
+	}
+	if (details != NULL) {
+		*details = gc_address_snapshot_ref (priv->good_address.details);
+	}
+	if (accuracy != NULL) {
+		*accuracy = geoclue_accuracy_copy (priv->good_address.accuracy);
+	}
+	
+	gc_master_provider_refresh (provider);
+	return TRUE;
+}
+
+/* Fills @range with the positions the provider has reported since 
+ * @since (a unix time), at most @max (0 for all) of the newest ones. 
+ * All clients of the provider share the one history. */
+void
+gc_master_provider_get_position_history (GcMasterProvider       *provider,
+                                         int                     since,
+                                         guint                   max,
+                                         GcPositionHistoryRange *range)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	gc_position_history_get (priv->history, since, max, range);
+}
+
 gboolean
 gc_master_provider_is_good (GcMasterProvider     *provider,
                             GcInterfaceFlags      iface_type,
@@ -1192,16 +2102,20 @@ void
 gc_master_provider_update_options (GcMasterProvider *provider)
 {
 	GeoclueProvider *geoclue;
-	GError *error = NULL;
+	GHashTable *options;
 	
 	geoclue = gc_master_provider_get_provider (provider);
-	
-	if (!geoclue_provider_set_options (geoclue,
-	                                   geoclue_get_main_options (),
-	                                   &error)) {
-		g_warning ("Error setting provider options: %s\n", error->message);
-		g_error_free (error);
+	if (!geoclue) {
+		/* sent on initialize */
+		return;
 	}
+	
+	options = gc_master_provider_build_options (provider);
+	g_object_ref (provider);
+	geoclue_provider_set_options_async (g_object_ref (geoclue), options,
+	                                    (GeoclueProviderOptionsCallback) options_callback,
+	                                    provider);
+	g_hash_table_destroy (options);
 }
 
 GeoclueStatus 
@@ -1233,6 +2147,14 @@ gc_master_provider_get_accuracy (GcMasterProvider *provider, GcInterfaceFlags if
 	return acc_level;
 }
 
+GeoclueResourceFlags
+gc_master_provider_get_required_resources (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	return priv->required_resources;
+}
+
 /*returns a reference, but is not meant for editing...*/
 char * 
 gc_master_provider_get_name (GcMasterProvider *provider)
@@ -30,6 +30,8 @@
 #include <geoclue/geoclue-types.h>
 #include <geoclue/geoclue-accuracy.h>
 #include "connectivity.h"
+#include "position-history.h"
+#include "address-snapshot.h"
 
 G_BEGIN_DECLS
 
@@ -69,10 +71,11 @@ typedef struct _GcMasterProviderClass {
 	                           double                longitude,
 	                           double                altitude,
 	                           GeoclueAccuracy      *accuracy);
-	void (* address_changed) (GcMasterProvider *master_provider,
-	                          int               timestamp,
-	                          GHashTable       *details,
-	                          GeoclueAccuracy  *accuracy);
+	void (* address_changed) (GcMasterProvider  *master_provider,
+	                          int                timestamp,
+	                          GcAddressSnapshot *details,
+	                          GeoclueAccuracy   *accuracy);
+	void (* cache_updated) (GcMasterProvider *master_provider);
 } GcMasterProviderClass;
 
 GType gc_master_provider_get_type (void);
@@ -80,6 +83,8 @@ GType gc_master_provider_get_type (void);
 GcMasterProvider *gc_master_provider_new (const char *filename,
                                           GeoclueConnectivity *connectivity);
 
+gboolean gc_master_provider_warm_up (GcMasterProvider *provider);
+gboolean gc_master_provider_is_running (GcMasterProvider *provider);
 gboolean gc_master_provider_subscribe (GcMasterProvider *provider, 
                                        gpointer          client,
                                        GcInterfaceFlags  interface);
@@ -97,6 +102,25 @@ gint gc_master_provider_compare (GcMasterProvider *a,
                                  GcMasterProvider *b,
                                  GcInterfaceAccuracy *iface_min_accuracy);
 
+gboolean gc_master_provider_get_old_position (GcMasterProvider       *provider,
+                                              int                     max_age,
+                                              GeocluePositionFields  *fields,
+                                              int                    *timestamp,
+                                              double                 *latitude,
+                                              double                 *longitude,
+                                              double                 *altitude,
+                                              GeoclueAccuracy       **accuracy);
+gboolean gc_master_provider_get_old_address (GcMasterProvider   *provider,
+                                             int                 max_age,
+                                             int                *timestamp,
+                                             GcAddressSnapshot **details,
+                                             GeoclueAccuracy   **accuracy);
+
+void gc_master_provider_get_position_history (GcMasterProvider       *provider,
+                                              int                     since,
+                                              guint                   max,
+                                              GcPositionHistoryRange *range);
+
 gboolean gc_master_provider_is_good (GcMasterProvider     *provider,
                                      GcInterfaceFlags      iface_types,
                                      GeoclueAccuracyLevel  min_accuracy,
@@ -114,6 +138,7 @@ char* gc_master_provider_get_path (GcMasterProvider *provider);
 
 GeoclueStatus gc_master_provider_get_status (GcMasterProvider *provider);
 GeoclueAccuracyLevel gc_master_provider_get_accuracy (GcMasterProvider *provider, GcInterfaceFlags iface);
+GeoclueResourceFlags gc_master_provider_get_required_resources (GcMasterProvider *provider);
 
 GeocluePositionFields gc_master_provider_get_position (GcMasterProvider *master_provider,
                                                        int              *timestamp,
@@ -123,11 +148,11 @@ GeocluePositionFields gc_master_provider_get_position (GcMasterProvider *master_
                                                        GeoclueAccuracy **accuracy,
                                                        GError          **error);
 
-gboolean gc_master_provider_get_address (GcMasterProvider  *master_provider,
-                                         int               *timestamp,
-                                         GHashTable       **details,
-                                         GeoclueAccuracy  **accuracy,
-                                         GError           **error);
+gboolean gc_master_provider_get_address (GcMasterProvider   *master_provider,
+                                         int                *timestamp,
+                                         GcAddressSnapshot **details,
+                                         GeoclueAccuracy   **accuracy,
+                                         GError            **error);
 
 
 G_END_DECLS
@@ -31,6 +31,7 @@
 #include "master.h"
 #include "client.h"
 #include "master-provider.h"
+#include "master-index.h"
 
 #ifdef HAVE_NETWORK_MANAGER
 #include "connectivity-networkmanager.h"
@@ -51,6 +52,20 @@ G_DEFINE_TYPE (GcMaster, gc_master, G_TYPE_OBJECT);
 
 static GList *providers = NULL;
 
+/* Connection-cacheable providers fill their caches when the connection
+ * comes up. They are started in parallel (each waits on D-Bus 
+ * activation and HTTP), but at most this many at a time */
+#define GC_MASTER_WARM_UP_CONCURRENCY 4
+
+typedef struct _GcMasterWarmUp {
+	GQueue queue;      /* providers waiting for their turn */
+	GList *running;    /* providers updating their cache */
+	GTimer *timer;
+	guint count;       /* providers warmed up in this round */
+} GcMasterWarmUp;
+
+static GcMasterWarmUp warm_up = {G_QUEUE_INIT, NULL, NULL, 0};
+
 static gboolean gc_iface_master_create (GcMaster    *master,
 					const char **object_path,
 					GError     **error);
@@ -95,6 +110,79 @@ gc_master_class_init (GcMasterClass *klass)
 						  G_TYPE_HASH_TABLE);
 }
 
+static void gc_master_warm_up_next (void);
+
+static void
+warm_up_cache_updated (GcMasterProvider *provider,
+                       gpointer          user_data)
+{
+	GList *link;
+	
+	link = g_list_find (warm_up.running, provider);
+	if (!link) {
+		/* an update not started by warm-up */
+		return;
+	}
+	warm_up.running = g_list_delete_link (warm_up.running, link);
+	warm_up.count++;
+	
+	gc_master_warm_up_next ();
+}
+
+/* Starts queued providers while there is room */
+static void
+gc_master_warm_up_next (void)
+{
+	while (g_list_length (warm_up.running) < GC_MASTER_WARM_UP_CONCURRENCY &&
+	       !g_queue_is_empty (&warm_up.queue)) {
+		GcMasterProvider *provider = g_queue_pop_head (&warm_up.queue);
+		
+		/* in the list before starting, "cache-updated" may follow right away */
+		warm_up.running = g_list_prepend (warm_up.running, provider);
+		if (!gc_master_provider_warm_up (provider)) {
+			warm_up.running = g_list_remove (warm_up.running, provider);
+		}
+	}
+	
+	if (!warm_up.running && warm_up.timer) {
+		g_debug ("Cache warm-up of %u providers took %.3f s", 
+		         warm_up.count, g_timer_elapsed (warm_up.timer, NULL));
+		g_timer_destroy (warm_up.timer);
+		warm_up.timer = NULL;
+	}
+}
+
+/* Queues every provider whose cache should be filled on connection, 
+ * unless it is queued or warming up already */
+static gboolean
+gc_master_warm_up (gpointer user_data)
+{
+	GList *l;
+	
+	if (!warm_up.timer) {
+		warm_up.timer = g_timer_new ();
+		warm_up.count = 0;
+	}
+	for (l = providers; l; l = l->next) {
+		if (!g_queue_find (&warm_up.queue, l->data) &&
+		    !g_list_find (warm_up.running, l->data)) {
+			g_queue_push_tail (&warm_up.queue, l->data);
+		}
+	}
+	gc_master_warm_up_next ();
+	return FALSE;
+}
+
+static void
+network_status_changed (GeoclueConnectivity *connectivity,
+                        GeoclueNetworkStatus status,
+                        GcMaster            *master)
+{
+	if (status == GEOCLUE_CONNECTIVITY_ONLINE) {
+		gc_master_warm_up (master);
+	}
+}
+
 /* Load the provider details out of a keyfile */
 static void
 gc_master_add_new_provider (GcMaster   *master,
@@ -111,6 +199,8 @@ gc_master_add_new_provider (GcMaster   *master,
 	}
 	
 	providers = g_list_prepend (providers, provider);
+	g_signal_connect (provider, "cache-updated",
+	                  G_CALLBACK (warm_up_cache_updated), NULL);
 }
 
 /* Scan a directory for .provider files */
@@ -157,6 +247,8 @@ gc_master_load_providers (GcMaster *master)
 	}
 
 	g_dir_close (dir);
+	
+	gc_master_index_build (providers);
 }
 
 static void
@@ -182,6 +274,19 @@ gc_master_init (GcMaster *master)
 #endif
 	
 	gc_master_load_providers (master);
+	
+	if (master->connectivity) {
+		/* connected after the providers, so they see the new 
+		 * status before warm-up */
+		g_signal_connect (master->connectivity, "status-changed",
+		                  G_CALLBACK (network_status_changed), master);
+		if (geoclue_connectivity_get_status (master->connectivity) == 
+		    GEOCLUE_CONNECTIVITY_ONLINE) {
+			/* do this as idle so we can return without waiting 
+			 * for http queries */
+			g_idle_add (gc_master_warm_up, master);
+		}
+	}
 }
 
 
@@ -192,23 +297,11 @@ gc_master_get_providers (GcInterfaceFlags      iface_type,
                          GeoclueResourceFlags  allowed,
                          GError              **error)
 {
-	GList *l, *p = NULL;
-	
 	if (providers == NULL) {
 		return NULL;
 	}
 	
-	for (l = providers; l; l = l->next) {
-		GcMasterProvider *provider = l->data;
-		
-		if (gc_master_provider_is_good (provider,
-		                                iface_type, 
-		                                min_accuracy, 
-		                                can_update, 
-		                                allowed)) {
-			p = g_list_prepend (p, provider);
-		}
-	}
-	
-	return p;
+	/* the caller owns the list, not the providers */
+	return gc_master_index_get_providers (iface_type, min_accuracy,
+	                                      can_update, allowed);
 }
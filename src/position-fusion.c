@@ -0,0 +1,341 @@
+/*
+ * Geoclue
+ * position-fusion.c - Kalman filter combining positions from several providers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <math.h>
+
+#include "position-fusion.h"
+
+#define EARTH_RADIUS 6371000.0
+#define METRES_PER_DEGREE (EARTH_RADIUS * G_PI / 180.0)
+
+/* variance of the velocity before anything is known about it, (m/s)^2 */
+#define INITIAL_VELOCITY_VARIANCE 100.0
+
+/* a fix further than this from the estimate (in squared standard
+ * deviations) means the estimate is wrong: start over from the fix */
+#define OUTLIER_GATE 100.0
+
+/* Radius assumed for fixes that only have an accuracy level */
+static double
+level_to_metres (GeoclueAccuracyLevel level)
+{
+	switch (level) {
+		case GEOCLUE_ACCURACY_LEVEL_COUNTRY:
+			return 500000.0;
+		case GEOCLUE_ACCURACY_LEVEL_REGION:
+			return 100000.0;
+		case GEOCLUE_ACCURACY_LEVEL_LOCALITY:
+			return 10000.0;
+		case GEOCLUE_ACCURACY_LEVEL_POSTALCODE:
+			return 2000.0;
+		case GEOCLUE_ACCURACY_LEVEL_STREET:
+			return 500.0;
+		case GEOCLUE_ACCURACY_LEVEL_DETAILED:
+			return 50.0;
+		default:
+			return 0.0;
+	}
+}
+
+static GeoclueAccuracyLevel
+metres_to_level (double metres)
+{
+	if (metres <= 50.0) {
+		return GEOCLUE_ACCURACY_LEVEL_DETAILED;
+	} else if (metres <= 500.0) {
+		return GEOCLUE_ACCURACY_LEVEL_STREET;
+	} else if (metres <= 2000.0) {
+		return GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
+	} else if (metres <= 10000.0) {
+		return GEOCLUE_ACCURACY_LEVEL_LOCALITY;
+	} else if (metres <= 100000.0) {
+		return GEOCLUE_ACCURACY_LEVEL_REGION;
+	}
+	return GEOCLUE_ACCURACY_LEVEL_COUNTRY;
+}
+
+static void
+axis_reset (GcFusionAxis *axis, double variance)
+{
+	axis->position = 0.0;
+	axis->velocity = 0.0;
+	axis->p00 = variance;
+	axis->p01 = 0.0;
+	axis->p11 = INITIAL_VELOCITY_VARIANCE;
+}
+
+/* x' = F x, P' = F P F^T + Q with white noise acceleration of
+ * spectral density q */
+static void
+axis_predict (GcFusionAxis *axis, double dt, double q)
+{
+	axis->position += axis->velocity * dt;
+	axis->p00 += dt * (2.0 * axis->p01 + dt * axis->p11) + q * dt * dt * dt / 3.0;
+	axis->p01 += dt * axis->p11 + q * dt * dt / 2.0;
+	axis->p11 += q * dt;
+}
+
+static void
+axis_correct (GcFusionAxis *axis, double measured, double variance)
+{
+	double innovation, s, k0, k1;
+
+	innovation = measured - axis->position;
+	s = axis->p00 + variance;
+	k0 = axis->p00 / s;
+	k1 = axis->p01 / s;
+
+	axis->position += k0 * innovation;
+	axis->velocity += k1 * innovation;
+
+	axis->p11 -= k1 * axis->p01;
+	axis->p01 *= 1.0 - k0;
+	axis->p00 *= 1.0 - k0;
+}
+
+static double
+normalize_longitude (double longitude)
+{
+	while (longitude > 180.0) {
+		longitude -= 360.0;
+	}
+	while (longitude < -180.0) {
+		longitude += 360.0;
+	}
+	return longitude;
+}
+
+static void
+fusion_restart (GcPositionFusion *fusion,
+                int               timestamp,
+                double            latitude,
+                double            longitude,
+                double            variance)
+{
+	fusion->valid = TRUE;
+	fusion->timestamp = timestamp;
+	fusion->latitude = latitude;
+	fusion->longitude = longitude;
+	axis_reset (&fusion->east, variance);
+	axis_reset (&fusion->north, variance);
+}
+
+GcPositionFusion *
+gc_position_fusion_new (double acceleration)
+{
+	GcPositionFusion *fusion;
+
+	fusion = g_new0 (GcPositionFusion, 1);
+	fusion->acceleration = acceleration;
+	fusion->last_fixes = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                                            NULL, g_free);
+
+	return fusion;
+}
+
+void
+gc_position_fusion_free (GcPositionFusion *fusion)
+{
+	g_hash_table_destroy (fusion->last_fixes);
+	g_free (fusion);
+}
+
+void
+gc_position_fusion_reset (GcPositionFusion *fusion)
+{
+	fusion->valid = FALSE;
+	fusion->has_altitude = FALSE;
+	g_hash_table_remove_all (fusion->last_fixes);
+}
+
+/* Remembers the fix from @source. Returns FALSE if it is the same as
+ * the last one, apart from the timestamp */
+static gboolean
+fusion_remember_fix (GcPositionFusion      *fusion,
+                     gconstpointer          source,
+                     GeocluePositionFields  fields,
+                     double                 latitude,
+                     double                 longitude,
+                     double                 altitude,
+                     GeoclueAccuracy       *accuracy)
+{
+	GcFusionFix *fix;
+
+	fix = g_hash_table_lookup (fusion->last_fixes, source);
+	if (fix &&
+	    fix->fields == fields &&
+	    fix->latitude == latitude &&
+	    fix->longitude == longitude &&
+	    (!(fields & GEOCLUE_POSITION_FIELDS_ALTITUDE) ||
+	     fix->altitude == altitude) &&
+	    fix->accuracy.level == accuracy->level &&
+	    fix->accuracy.horizontal_accuracy == accuracy->horizontal_accuracy &&
+	    fix->accuracy.vertical_accuracy == accuracy->vertical_accuracy) {
+		return FALSE;
+	}
+	if (!fix) {
+		fix = g_new (GcFusionFix, 1);
+		g_hash_table_insert (fusion->last_fixes, (gpointer) source, fix);
+	}
+	fix->fields = fields;
+	fix->latitude = latitude;
+	fix->longitude = longitude;
+	fix->altitude = altitude;
+	fix->accuracy = *accuracy;
+	return TRUE;
+}
+
+/* Adds a fix from @source to the estimate. Fixes without a latitude,
+ * longitude and some accuracy are ignored and FALSE is returned, and
+ * so are fixes that repeat the last one from the same source with a
+ * new timestamp: the same measurement used twice would make the
+ * estimate look more accurate than it is. Fixes older than the
+ * estimate are used as if they were current. */
+gboolean
+gc_position_fusion_update (GcPositionFusion      *fusion,
+                           gconstpointer          source,
+                           GeocluePositionFields  fields,
+                           int                    timestamp,
+                           double                 latitude,
+                           double                 longitude,
+                           double                 altitude,
+                           GeoclueAccuracy       *accuracy)
+{
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	double horizontal = 0.0, vertical = 0.0;
+	double variance, q, dt, scale, east, north, distance;
+
+	if (!(fields & GEOCLUE_POSITION_FIELDS_LATITUDE &&
+	      fields & GEOCLUE_POSITION_FIELDS_LONGITUDE)) {
+		return FALSE;
+	}
+	if (accuracy) {
+		geoclue_accuracy_get_details (accuracy, &level, &horizontal, &vertical);
+	}
+	if (horizontal <= 0.0) {
+		horizontal = level_to_metres (level);
+	}
+	if (horizontal <= 0.0) {
+		return FALSE;
+	}
+	if (!fusion_remember_fix (fusion, source, fields,
+	                          latitude, longitude, altitude, accuracy)) {
+		return FALSE;
+	}
+	variance = horizontal * horizontal;
+
+	dt = 0.0;
+	if (!fusion->valid) {
+		fusion_restart (fusion, timestamp, latitude, longitude, variance);
+	} else {
+		if (timestamp > fusion->timestamp) {
+			dt = timestamp - fusion->timestamp;
+			fusion->timestamp = timestamp;
+		}
+		q = fusion->acceleration * fusion->acceleration;
+		axis_predict (&fusion->east, dt, q);
+		axis_predict (&fusion->north, dt, q);
+
+		scale = cos (fusion->latitude * G_PI / 180.0);
+		east = normalize_longitude (longitude - fusion->longitude) * METRES_PER_DEGREE * scale;
+		north = (latitude - fusion->latitude) * METRES_PER_DEGREE;
+
+		distance = (east - fusion->east.position) * (east - fusion->east.position) /
+		           (fusion->east.p00 + variance) +
+		           (north - fusion->north.position) * (north - fusion->north.position) /
+		           (fusion->north.p00 + variance);
+		if (distance > OUTLIER_GATE) {
+			g_debug ("fusion: fix is %.0f sigma from estimate, restarting", sqrt (distance));
+			fusion_restart (fusion, fusion->timestamp, latitude, longitude, variance);
+		} else {
+			axis_correct (&fusion->east, east, variance);
+			axis_correct (&fusion->north, north, variance);
+
+			/* move the reference to the estimate */
+			fusion->latitude = CLAMP (fusion->latitude + fusion->north.position / METRES_PER_DEGREE,
+			                          -90.0, 90.0);
+			if (scale > 0.0) {
+				fusion->longitude = normalize_longitude (fusion->longitude +
+				                                         fusion->east.position / (METRES_PER_DEGREE * scale));
+			}
+			fusion->east.position = 0.0;
+			fusion->north.position = 0.0;
+		}
+	}
+
+	/* altitude drifts as fast as the position may accelerate */
+	if (fusion->has_altitude) {
+		fusion->altitude_variance += fusion->acceleration * fusion->acceleration * dt * dt;
+	}
+	if (fields & GEOCLUE_POSITION_FIELDS_ALTITUDE) {
+		if (vertical <= 0.0) {
+			vertical = horizontal;
+		}
+		if (!fusion->has_altitude) {
+			fusion->has_altitude = TRUE;
+			fusion->altitude = altitude;
+			fusion->altitude_variance = vertical * vertical;
+		} else {
+			double k;
+
+			k = fusion->altitude_variance / (fusion->altitude_variance + vertical * vertical);
+			fusion->altitude += k * (altitude - fusion->altitude);
+			fusion->altitude_variance *= 1.0 - k;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Returns the estimate at the time of the newest fix. The accuracy
+ * is the standard deviation along the less certain axis. */
+GeocluePositionFields
+gc_position_fusion_get (GcPositionFusion  *fusion,
+                        int               *timestamp,
+                        double            *latitude,
+                        double            *longitude,
+                        double            *altitude,
+                        GeoclueAccuracy  **accuracy)
+{
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double horizontal = 0.0, vertical = 0.0;
+
+	if (!fusion->valid) {
+		*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
+		return fields;
+	}
+
+	fields = GEOCLUE_POSITION_FIELDS_LATITUDE | GEOCLUE_POSITION_FIELDS_LONGITUDE;
+	*timestamp = fusion->timestamp;
+	*latitude = fusion->latitude;
+	*longitude = fusion->longitude;
+	horizontal = sqrt (MAX (fusion->east.p00, fusion->north.p00));
+
+	if (fusion->has_altitude) {
+		fields |= GEOCLUE_POSITION_FIELDS_ALTITUDE;
+		*altitude = fusion->altitude;
+		vertical = sqrt (fusion->altitude_variance);
+	}
+
+	*accuracy = geoclue_accuracy_new (metres_to_level (horizontal),
+	                                  horizontal, vertical);
+	return fields;
+}
@@ -0,0 +1,91 @@
+/*
+ * Geoclue
+ * position-fusion.h - Kalman filter combining positions from several providers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _POSITION_FUSION_H_
+#define _POSITION_FUSION_H_
+
+#include <glib.h>
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+G_BEGIN_DECLS
+
+/* Constant velocity model along one axis (metres, metres/second).
+ * The axes are independent as long as fixes have circular accuracy. */
+typedef struct _GcFusionAxis {
+	double position;
+	double velocity;
+	double p00, p01, p11; /* symmetric covariance */
+} GcFusionAxis;
+
+/* The last fix used from one source */
+typedef struct _GcFusionFix {
+	GeocluePositionFields fields;
+	double latitude;
+	double longitude;
+	double altitude;
+	GeoclueAccuracy accuracy;
+} GcFusionFix;
+
+typedef struct _GcPositionFusion {
+	gboolean valid;
+	int timestamp;
+
+	/* the axes are in metres east and north of the reference,
+	 * which is moved to the estimate after each fix */
+	double latitude;
+	double longitude;
+	GcFusionAxis east;
+	GcFusionAxis north;
+
+	/* altitude is a random walk: no velocity */
+	gboolean has_altitude;
+	double altitude;
+	double altitude_variance;
+
+	double acceleration; /* process noise, metres/second^2 */
+
+	GHashTable *last_fixes; /* source -> GcFusionFix */
+} GcPositionFusion;
+
+GcPositionFusion *gc_position_fusion_new (double acceleration);
+void gc_position_fusion_free (GcPositionFusion *fusion);
+void gc_position_fusion_reset (GcPositionFusion *fusion);
+
+gboolean gc_position_fusion_update (GcPositionFusion      *fusion,
+                                    gconstpointer          source,
+                                    GeocluePositionFields  fields,
+                                    int                    timestamp,
+                                    double                 latitude,
+                                    double                 longitude,
+                                    double                 altitude,
+                                    GeoclueAccuracy       *accuracy);
+
+GeocluePositionFields gc_position_fusion_get (GcPositionFusion  *fusion,
+                                              int               *timestamp,
+                                              double            *latitude,
+                                              double            *longitude,
+                                              double            *altitude,
+                                              GeoclueAccuracy  **accuracy);
+
+G_END_DECLS
+
+#endif /* _POSITION_FUSION_H_ */
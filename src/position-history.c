@@ -0,0 +1,181 @@
+/*
+ * Geoclue
+ * position-history.c - Fixed size history of positions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "position-history.h"
+
+/* index of the n:th oldest entry */
+#define HISTORY_INDEX(h, n) (((h)->head + (n)) % (h)->capacity)
+
+GcPositionHistory *
+gc_position_history_new (guint capacity)
+{
+	GcPositionHistory *history;
+	
+	g_return_val_if_fail (capacity > 0, NULL);
+	
+	history = g_new0 (GcPositionHistory, 1);
+	history->capacity = capacity;
+	history->timestamps = g_new (int, capacity);
+	history->fields = g_new (int, capacity);
+	history->latitudes = g_new (double, capacity);
+	history->longitudes = g_new (double, capacity);
+	history->altitudes = g_new (double, capacity);
+	history->levels = g_new (int, capacity);
+	history->horizontal = g_new (double, capacity);
+	history->vertical = g_new (double, capacity);
+	
+	return history;
+}
+
+void
+gc_position_history_free (GcPositionHistory *history)
+{
+	if (!history) {
+		return;
+	}
+	g_free (history->timestamps);
+	g_free (history->fields);
+	g_free (history->latitudes);
+	g_free (history->longitudes);
+	g_free (history->altitudes);
+	g_free (history->levels);
+	g_free (history->horizontal);
+	g_free (history->vertical);
+	g_free (history);
+}
+
+/* Adds a position, overwriting the oldest one when full. 
+ * The same position reported twice is stored once, and positions 
+ * older than the newest one are dropped to keep the timestamps sorted. */
+void
+gc_position_history_append (GcPositionHistory     *history,
+                            GeocluePositionFields  fields,
+                            int                    timestamp,
+                            double                 latitude,
+                            double                 longitude,
+                            double                 altitude,
+                            GeoclueAccuracy       *accuracy)
+{
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	double horizontal = 0.0, vertical = 0.0;
+	guint i;
+	
+	if (history->length > 0) {
+		i = HISTORY_INDEX (history, history->length - 1);
+		if (timestamp < history->timestamps[i]) {
+			return;
+		}
+		if (history->timestamps[i] == timestamp &&
+		    history->fields[i] == fields &&
+		    history->latitudes[i] == latitude &&
+		    history->longitudes[i] == longitude &&
+		    history->altitudes[i] == altitude) {
+			return;
+		}
+	}
+	
+	if (history->length < history->capacity) {
+		i = HISTORY_INDEX (history, history->length);
+		history->length++;
+	} else {
+		i = history->head;
+		history->head = HISTORY_INDEX (history, 1);
+	}
+	
+	if (accuracy) {
+		geoclue_accuracy_get_details (accuracy, &level, 
+		                              &horizontal, &vertical);
+	}
+	history->timestamps[i] = timestamp;
+	history->fields[i] = fields;
+	history->latitudes[i] = latitude;
+	history->longitudes[i] = longitude;
+	history->altitudes[i] = altitude;
+	history->levels[i] = level;
+	history->horizontal[i] = horizontal;
+	history->vertical[i] = vertical;
+}
+
+/* Appends entries [start, start + n) of the ring array @data, 
+ * with @size byte elements, to @array */
+static GArray *
+history_copy (GcPositionHistory *history,
+              gconstpointer      data,
+              gsize              size,
+              guint              start,
+              guint              n)
+{
+	GArray *array;
+	guint first;
+	
+	array = g_array_sized_new (FALSE, FALSE, size, n);
+	first = MIN (n, history->capacity - start);
+	g_array_append_vals (array, (const char *) data + start * size, first);
+	g_array_append_vals (array, data, n - first);
+	return array;
+}
+
+/* Fills @range with new arrays holding the positions with a timestamp 
+ * of at least @since, at most @max (0 for all) of the newest ones */
+void
+gc_position_history_get (GcPositionHistory      *history,
+                         int                     since,
+                         guint                   max,
+                         GcPositionHistoryRange *range)
+{
+	guint lo, hi, n, start;
+	
+	/* timestamps grow along the ring: binary search for the first match */
+	lo = 0;
+	hi = history->length;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		
+		if (history->timestamps[HISTORY_INDEX (history, mid)] < since) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	n = history->length - lo;
+	if (max > 0 && n > max) {
+		lo += n - max;
+		n = max;
+	}
+	start = HISTORY_INDEX (history, lo);
+	
+	range->fields = history_copy (history, history->fields, 
+	                              sizeof (int), start, n);
+	range->timestamps = history_copy (history, history->timestamps, 
+	                                  sizeof (int), start, n);
+	range->latitudes = history_copy (history, history->latitudes, 
+	                                 sizeof (double), start, n);
+	range->longitudes = history_copy (history, history->longitudes, 
+	                                  sizeof (double), start, n);
+	range->altitudes = history_copy (history, history->altitudes, 
+	                                 sizeof (double), start, n);
+	range->levels = history_copy (history, history->levels, 
+	                              sizeof (int), start, n);
+	range->horizontal = history_copy (history, history->horizontal, 
+	                                  sizeof (double), start, n);
+	range->vertical = history_copy (history, history->vertical, 
+	                                sizeof (double), start, n);
+}
@@ -0,0 +1,80 @@
+/*
+ * Geoclue
+ * position-history.h - Fixed size history of positions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _POSITION_HISTORY_H_
+#define _POSITION_HISTORY_H_
+
+#include <glib.h>
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+G_BEGIN_DECLS
+
+/* Ring buffer of positions. Each field is kept in an array of its own,
+ * so time range lookups only touch the timestamps and the results can 
+ * be copied out array by array. */
+typedef struct _GcPositionHistory {
+	guint capacity;
+	guint head;    /* index of the oldest entry */
+	guint length;
+	
+	int *timestamps;
+	int *fields;
+	double *latitudes;
+	double *longitudes;
+	double *altitudes;
+	int *levels;
+	double *horizontal;
+	double *vertical;
+} GcPositionHistory;
+
+/* Entries returned by gc_position_history_get (), oldest first. 
+ * Each member is a GArray of the matching type */
+typedef struct _GcPositionHistoryRange {
+	GArray *fields;      /* int */
+	GArray *timestamps;  /* int */
+	GArray *latitudes;   /* double */
+	GArray *longitudes;  /* double */
+	GArray *altitudes;   /* double */
+	GArray *levels;      /* int, GeoclueAccuracyLevel */
+	GArray *horizontal;  /* double */
+	GArray *vertical;    /* double */
+} GcPositionHistoryRange;
+
+GcPositionHistory *gc_position_history_new (guint capacity);
+void gc_position_history_free (GcPositionHistory *history);
+
+void gc_position_history_append (GcPositionHistory     *history,
+                                 GeocluePositionFields  fields,
+                                 int                    timestamp,
+                                 double                 latitude,
+                                 double                 longitude,
+                                 double                 altitude,
+                                 GeoclueAccuracy       *accuracy);
+
+void gc_position_history_get (GcPositionHistory      *history,
+                              int                     since,
+                              guint                   max,
+                              GcPositionHistoryRange *range);
+
+G_END_DECLS
+
+#endif /* _POSITION_HISTORY_H_ */
@@ -0,0 +1,159 @@
+/*
+ * Geoclue
+ * provider-index.c - Ranked provider lists shared by master clients
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* Each index keeps the accuracy level every provider was ranked by,
+ * so an accuracy change moves only that provider, and only once no
+ * matter how many clients share the index. */
+
+#include "provider-index.h"
+#include "master.h"
+
+/* levels are stored off by one, so that NONE is not NULL */
+#define LEVEL_TO_POINTER(l) GINT_TO_POINTER ((l) + 1)
+#define POINTER_TO_LEVEL(p) ((GeoclueAccuracyLevel) (GPOINTER_TO_INT (p) - 1))
+
+/* key -> GcProviderIndex, for indexes that have references */
+static GHashTable *indexes = NULL;
+
+/* same order as gc_master_provider_compare (), from the cached levels */
+static gint
+provider_index_compare (GcMasterProvider *a,
+                        GcMasterProvider *b,
+                        GcProviderIndex  *index)
+{
+	GeoclueAccuracyLevel level_a, level_b;
+	int diff;
+
+	level_a = POINTER_TO_LEVEL (g_hash_table_lookup (index->levels, a));
+	level_b = POINTER_TO_LEVEL (g_hash_table_lookup (index->levels, b));
+
+	if (level_a >= index->min_accuracy &&
+	    level_b >= index->min_accuracy) {
+		diff = gc_master_provider_get_required_resources (a) -
+		       gc_master_provider_get_required_resources (b);
+		if (diff != 0) {
+			return diff;
+		}
+	}
+	return level_b - level_a;
+}
+
+GcProviderIndex *
+gc_provider_index_get (GcInterfaceFlags      iface,
+                       GeoclueAccuracyLevel  min_accuracy,
+                       gboolean              can_update,
+                       GeoclueResourceFlags  allowed)
+{
+	GcProviderIndex *index;
+	GList *l;
+	char *key;
+
+	key = g_strdup_printf ("%d:%d:%d:%d", iface, min_accuracy,
+	                       can_update ? 1 : 0, allowed);
+	if (!indexes) {
+		indexes = g_hash_table_new (g_str_hash, g_str_equal);
+	}
+	index = g_hash_table_lookup (indexes, key);
+	if (index) {
+		g_free (key);
+		return gc_provider_index_ref (index);
+	}
+
+	index = g_new0 (GcProviderIndex, 1);
+	index->ref_count = 1;
+	index->key = key;
+	index->iface = iface;
+	index->min_accuracy = min_accuracy;
+	index->levels = g_hash_table_new (g_direct_hash, g_direct_equal);
+	index->providers = gc_master_get_providers (iface, min_accuracy,
+	                                            can_update, allowed,
+	                                            NULL);
+	for (l = index->providers; l; l = l->next) {
+		g_hash_table_insert (index->levels, l->data,
+		                     LEVEL_TO_POINTER (gc_master_provider_get_accuracy (l->data, iface)));
+	}
+	index->providers = g_list_sort_with_data (index->providers,
+	                                          (GCompareDataFunc) provider_index_compare,
+	                                          index);
+	g_hash_table_insert (indexes, index->key, index);
+
+	return index;
+}
+
+GcProviderIndex *
+gc_provider_index_ref (GcProviderIndex *index)
+{
+	index->ref_count++;
+	return index;
+}
+
+void
+gc_provider_index_unref (GcProviderIndex *index)
+{
+	if (!index || --index->ref_count > 0) {
+		return;
+	}
+	g_hash_table_remove (indexes, index->key);
+	g_hash_table_destroy (index->levels);
+	g_list_free (index->providers);
+	g_free (index->key);
+	g_free (index);
+}
+
+/* the list belongs to the index and changes when providers move */
+GList *
+gc_provider_index_get_providers (GcProviderIndex *index)
+{
+	return index ? index->providers : NULL;
+}
+
+gboolean
+gc_provider_index_contains (GcProviderIndex  *index,
+                            GcMasterProvider *provider)
+{
+	return (index && g_hash_table_lookup (index->levels, provider) != NULL);
+}
+
+/* Moves the provider to its place if its accuracy has changed.
+ * Returns TRUE if it had. */
+gboolean
+gc_provider_index_update (GcProviderIndex  *index,
+                          GcMasterProvider *provider)
+{
+	GeoclueAccuracyLevel level;
+	gpointer cached;
+
+	cached = g_hash_table_lookup (index->levels, provider);
+	if (!cached) {
+		return FALSE;
+	}
+	level = gc_master_provider_get_accuracy (provider, index->iface);
+	if (level == POINTER_TO_LEVEL (cached)) {
+		return FALSE;
+	}
+
+	g_hash_table_insert (index->levels, provider, LEVEL_TO_POINTER (level));
+	index->providers = g_list_remove (index->providers, provider);
+	index->providers = g_list_insert_sorted_with_data (index->providers, provider,
+	                                                   (GCompareDataFunc) provider_index_compare,
+	                                                   index);
+	return TRUE;
+}
@@ -0,0 +1,59 @@
+/*
+ * Geoclue
+ * provider-index.h - Ranked provider lists shared by master clients
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _PROVIDER_INDEX_H_
+#define _PROVIDER_INDEX_H_
+
+#include <glib.h>
+#include <geoclue/geoclue-types.h>
+#include "master-provider.h"
+
+G_BEGIN_DECLS
+
+/* The providers matching one set of requirements, best first.
+ * Clients with the same requirements share one index. */
+typedef struct _GcProviderIndex {
+	guint ref_count;
+	char *key;
+
+	GcInterfaceFlags iface;
+	GeoclueAccuracyLevel min_accuracy;
+
+	GList *providers;
+	GHashTable *levels; /* provider -> accuracy level it is ranked by */
+} GcProviderIndex;
+
+GcProviderIndex *gc_provider_index_get (GcInterfaceFlags      iface,
+                                        GeoclueAccuracyLevel  min_accuracy,
+                                        gboolean              can_update,
+                                        GeoclueResourceFlags  allowed);
+GcProviderIndex *gc_provider_index_ref (GcProviderIndex *index);
+void gc_provider_index_unref (GcProviderIndex *index);
+
+GList *gc_provider_index_get_providers (GcProviderIndex *index);
+gboolean gc_provider_index_contains (GcProviderIndex  *index,
+                                     GcMasterProvider *provider);
+gboolean gc_provider_index_update (GcProviderIndex  *index,
+                                   GcMasterProvider *provider);
+
+G_END_DECLS
+
+#endif /* _PROVIDER_INDEX_H_ */
@@ -0,0 +1,387 @@
+/*
+ * Geoclue
+ * selection-group.c - Provider selection shared by clients with the same requirements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* A provider event is handled once per group and the result is passed
+ * to the members, so the cost of an event depends on the number of
+ * distinct requirements, not on the number of clients. */
+
+#include "selection-group.h"
+
+/* per provider flags of the current round */
+#define SELECTION_SUBSCRIBED (1 << 0)
+#define SELECTION_STARTED    (1 << 1)
+
+/* passes over the provider list per event, if events keep
+ * arriving during the passes */
+#define SELECTION_MAX_PASSES 3
+
+typedef struct _GcSelectionGroupMember {
+	GcSelectionGroupFunc func;
+	gpointer user_data;
+} GcSelectionGroupMember;
+
+/* key -> GcSelectionGroup, for groups that have references */
+static GHashTable *groups = NULL;
+
+/*if changed_provider status changes, do we need to choose a new provider? */
+static gboolean
+status_change_requires_provider_change (GList            *provider_list,
+                                        GcMasterProvider *current_provider,
+                                        GcMasterProvider *changed_provider,
+                                        GeoclueStatus     status)
+{
+	if (!provider_list) {
+		return FALSE;
+
+	} else if (current_provider == NULL) {
+		return (status == GEOCLUE_STATUS_AVAILABLE);
+
+	} else if (current_provider == changed_provider) {
+		return (status != GEOCLUE_STATUS_AVAILABLE);
+
+	}else if (status != GEOCLUE_STATUS_AVAILABLE) {
+		return FALSE;
+
+	}
+
+	while (provider_list) {
+		GcMasterProvider *p = provider_list->data;
+		if (p == current_provider) {
+			/* not interested in worse-than-current providers */
+			return FALSE;
+		}
+		if (p == changed_provider) {
+			/* changed_provider is better than current */
+			return (status == GEOCLUE_STATUS_AVAILABLE);
+		}
+		provider_list = provider_list->next;
+	}
+	return FALSE;
+}
+
+static void
+selection_unsubscribe (GcSelectionGroup *group,
+                       GcMasterProvider *provider)
+{
+	guint flags;
+
+	gc_master_provider_unsubscribe (provider, group, group->iface);
+	flags = GPOINTER_TO_UINT (g_hash_table_lookup (group->round, provider));
+	flags &= ~SELECTION_SUBSCRIBED;
+	if (flags) {
+		g_hash_table_insert (group->round, provider, GUINT_TO_POINTER (flags));
+	} else {
+		g_hash_table_remove (group->round, provider);
+	}
+}
+
+/* One pass over the sorted providers: subscribes to each until an
+ * available one is found, starting a provider at most once per round.
+ * Started providers report back with status-changed, which runs the
+ * next pass, so nothing here waits or restarts. */
+static GcMasterProvider *
+selection_pass (GcSelectionGroup *group,
+                GList            *provider_list,
+                gboolean         *acquiring)
+{
+	GcMasterProvider *best = NULL;
+	GList *l;
+
+	*acquiring = FALSE;
+	group->passes++;
+	for (l = provider_list; l; l = l->next) {
+		GcMasterProvider *provider = l->data;
+		GeoclueStatus status;
+		guint flags;
+
+		flags = GPOINTER_TO_UINT (g_hash_table_lookup (group->round, provider));
+		if (!(flags & SELECTION_SUBSCRIBED)) {
+			if (flags & SELECTION_STARTED &&
+			    !gc_master_provider_is_running (provider)) {
+				/* already started and gone this round */
+				continue;
+			}
+			g_debug ("        ...trying provider %s", gc_master_provider_get_name (provider));
+			if (gc_master_provider_subscribe (provider, group, group->iface)) {
+				g_debug ("        ...started %s", gc_master_provider_get_name (provider));
+				flags |= SELECTION_STARTED;
+				group->starts++;
+			}
+			flags |= SELECTION_SUBSCRIBED;
+			g_hash_table_insert (group->round, provider, GUINT_TO_POINTER (flags));
+		}
+
+		/* TODO: currently returning even providers that are worse than min_accuracy,
+		 * if nothing else is available */
+		status = gc_master_provider_get_status (provider);
+		if (status == GEOCLUE_STATUS_AVAILABLE) {
+			best = provider;
+			break;
+		} else if (status == GEOCLUE_STATUS_ACQUIRING) {
+			*acquiring = TRUE;
+		}
+	}
+	return best;
+}
+
+/* Returns the best provider with status == GEOCLUE_STATUS_AVAILABLE.
+ * Keeps subscriptions to that provider and the better ones that are
+ * still acquiring, and unsubscribes from the rest. */
+static GcMasterProvider *
+selection_get_best_provider (GcSelectionGroup *group)
+{
+	GcMasterProvider *best = NULL;
+	GList *provider_list, *providers, *l;
+	gboolean acquiring = FALSE;
+	guint passes = 0;
+
+	g_debug ("group %s: choosing best provider", group->key);
+
+	if (group->state == GC_SELECTION_IDLE) {
+		g_hash_table_remove_all (group->round);
+		g_timer_start (group->timer);
+		group->passes = 0;
+		group->starts = 0;
+		group->state = GC_SELECTION_WAITING;
+	}
+
+	/* work on a copy: events during the pass may re-sort the list */
+	group->in_pass = TRUE;
+	do {
+		group->rescan = FALSE;
+		providers = g_list_copy (gc_provider_index_get_providers (group->index));
+		best = selection_pass (group, providers, &acquiring);
+		g_list_free (providers);
+	} while (group->rescan && ++passes < SELECTION_MAX_PASSES);
+	group->in_pass = FALSE;
+
+	/* unsubscribe from providers worse than the best one, or from the
+	 * ones not acquiring if there is no best one */
+	provider_list = gc_provider_index_get_providers (group->index);
+	l = best ? g_list_find (provider_list, best)->next : provider_list;
+	for (; l; l = l->next) {
+		if (!best &&
+		    gc_master_provider_get_status (l->data) == GEOCLUE_STATUS_ACQUIRING) {
+			continue;
+		}
+		selection_unsubscribe (group, l->data);
+	}
+
+	if (!acquiring) {
+		group->state = GC_SELECTION_IDLE;
+		g_debug ("group %s: provider selection done in %.3f s (%u passes, %u providers started)",
+		         group->key, g_timer_elapsed (group->timer, NULL),
+		         group->passes, group->starts);
+	}
+	return best;
+}
+
+/* return true if a _new_ provider was chosen */
+static gboolean
+selection_choose_provider (GcSelectionGroup *group)
+{
+	GcMasterProvider *new_p;
+
+	new_p = selection_get_best_provider (group);
+	if (group->provider && new_p == group->provider) {
+		return FALSE;
+	}
+	group->provider = new_p;
+	return TRUE;
+}
+
+static void
+selection_notify_members (GcSelectionGroup *group)
+{
+	GList *members, *l;
+
+	/* members may leave while being told */
+	members = g_list_copy (group->members);
+	for (l = members; l; l = l->next) {
+		GcSelectionGroupMember *member = l->data;
+
+		if (g_list_find (group->members, member)) {
+			member->func (group, member->user_data);
+		}
+	}
+	g_list_free (members);
+}
+
+static void
+status_changed (GcMasterProvider *provider,
+                GeoclueStatus     status,
+                GcSelectionGroup *group)
+{
+	if (group->in_pass) {
+		group->rescan = TRUE;
+		return;
+	}
+
+	/* a provider started this round has news, or the status
+	 * change calls for another provider */
+	if ((group->state == GC_SELECTION_WAITING &&
+	     g_hash_table_lookup (group->round, provider)) ||
+	    status_change_requires_provider_change (gc_provider_index_get_providers (group->index),
+	                                            group->provider,
+	                                            provider, status)) {
+		if (selection_choose_provider (group)) {
+			selection_notify_members (group);
+		}
+	}
+}
+
+static void
+accuracy_changed (GcMasterProvider     *provider,
+                  GcInterfaceFlags      interface,
+                  GeoclueAccuracyLevel  level,
+                  GcSelectionGroup     *group)
+{
+	if (interface != group->iface) {
+		return;
+	}
+
+	/* the first group of an index to hear about the change moves
+	 * the provider, for the others this is a no-op */
+	gc_provider_index_update (group->index, provider);
+	if (group->in_pass) {
+		g_debug ("        ...during provider choice, scanning again");
+		group->rescan = TRUE;
+	} else if (selection_choose_provider (group)) {
+		selection_notify_members (group);
+	}
+}
+
+GcSelectionGroup *
+gc_selection_group_get (GcInterfaceFlags      iface,
+                        GeoclueAccuracyLevel  min_accuracy,
+                        gboolean              can_update,
+                        GeoclueResourceFlags  allowed)
+{
+	GcSelectionGroup *group;
+	GList *l;
+	char *key;
+
+	key = g_strdup_printf ("%d:%d:%d:%d", iface, min_accuracy,
+	                       can_update ? 1 : 0, allowed);
+	if (!groups) {
+		groups = g_hash_table_new (g_str_hash, g_str_equal);
+	}
+	group = g_hash_table_lookup (groups, key);
+	if (group) {
+		g_free (key);
+		group->ref_count++;
+		return group;
+	}
+
+	group = g_new0 (GcSelectionGroup, 1);
+	group->ref_count = 1;
+	group->key = key;
+	group->iface = iface;
+	group->index = gc_provider_index_get (iface, min_accuracy, can_update, allowed);
+	group->state = GC_SELECTION_IDLE;
+	group->round = g_hash_table_new (g_direct_hash, g_direct_equal);
+	group->timer = g_timer_new ();
+	g_hash_table_insert (groups, group->key, group);
+
+	g_debug ("group %s: %d providers matching requirements found",
+	         group->key, g_list_length (gc_provider_index_get_providers (group->index)));
+	for (l = gc_provider_index_get_providers (group->index); l; l = l->next) {
+		g_signal_connect (G_OBJECT (l->data),
+		                  "status-changed",
+		                  G_CALLBACK (status_changed),
+		                  group);
+		g_signal_connect (G_OBJECT (l->data),
+		                  "accuracy-changed",
+		                  G_CALLBACK (accuracy_changed),
+		                  group);
+	}
+	selection_choose_provider (group);
+
+	return group;
+}
+
+void
+gc_selection_group_unref (GcSelectionGroup *group)
+{
+	GList *l;
+
+	if (!group || --group->ref_count > 0) {
+		return;
+	}
+
+	g_hash_table_remove (groups, group->key);
+	for (l = gc_provider_index_get_providers (group->index); l; l = l->next) {
+		g_signal_handlers_disconnect_by_func (l->data, status_changed, group);
+		g_signal_handlers_disconnect_by_func (l->data, accuracy_changed, group);
+		gc_master_provider_unsubscribe (l->data, group, group->iface);
+	}
+	gc_provider_index_unref (group->index);
+
+	g_list_foreach (group->members, (GFunc) g_free, NULL);
+	g_list_free (group->members);
+	g_hash_table_destroy (group->round);
+	g_timer_destroy (group->timer);
+	g_free (group->key);
+	g_free (group);
+}
+
+void
+gc_selection_group_add_member (GcSelectionGroup     *group,
+                               GcSelectionGroupFunc  func,
+                               gpointer              user_data)
+{
+	GcSelectionGroupMember *member;
+
+	member = g_new0 (GcSelectionGroupMember, 1);
+	member->func = func;
+	member->user_data = user_data;
+	group->members = g_list_prepend (group->members, member);
+}
+
+void
+gc_selection_group_remove_member (GcSelectionGroup *group,
+                                  gpointer          user_data)
+{
+	GList *l;
+
+	for (l = group->members; l; l = l->next) {
+		GcSelectionGroupMember *member = l->data;
+
+		if (member->user_data == user_data) {
+			group->members = g_list_delete_link (group->members, l);
+			g_free (member);
+			return;
+		}
+	}
+}
+
+GcMasterProvider *
+gc_selection_group_get_provider (GcSelectionGroup *group)
+{
+	return group ? group->provider : NULL;
+}
+
+/* the providers matching the requirements, best first */
+GList *
+gc_selection_group_get_providers (GcSelectionGroup *group)
+{
+	return group ? gc_provider_index_get_providers (group->index) : NULL;
+}
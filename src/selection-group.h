@@ -0,0 +1,84 @@
+/*
+ * Geoclue
+ * selection-group.h - Provider selection shared by clients with the same requirements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _SELECTION_GROUP_H_
+#define _SELECTION_GROUP_H_
+
+#include <glib.h>
+#include <geoclue/geoclue-types.h>
+#include "master-provider.h"
+#include "provider-index.h"
+
+G_BEGIN_DECLS
+
+/* A round starts when a new provider is needed and ends when no
+ * better provider is acquiring anymore; status and accuracy events
+ * move it forward meanwhile. */
+typedef enum {
+	GC_SELECTION_IDLE,
+	GC_SELECTION_WAITING
+} GcSelectionState;
+
+typedef struct _GcSelectionGroup GcSelectionGroup;
+
+/* called on every member when the group has chosen a new provider */
+typedef void (*GcSelectionGroupFunc) (GcSelectionGroup *group,
+                                      gpointer          user_data);
+
+/* Chooses the provider of one interface for all clients with the
+ * same requirements. The group, not the clients, subscribes to the
+ * providers and listens to their status and accuracy. */
+struct _GcSelectionGroup {
+	guint ref_count;
+	char *key;
+
+	GcInterfaceFlags iface;
+	GcProviderIndex *index;
+	GcMasterProvider *provider; /* current choice */
+	GList *members;
+
+	GcSelectionState state;
+	GHashTable *round; /* provider -> flags of the current round */
+	gboolean in_pass;
+	gboolean rescan;   /* an event arrived during a pass */
+	GTimer *timer;
+	guint passes;
+	guint starts;
+};
+
+GcSelectionGroup *gc_selection_group_get (GcInterfaceFlags      iface,
+                                          GeoclueAccuracyLevel  min_accuracy,
+                                          gboolean              can_update,
+                                          GeoclueResourceFlags  allowed);
+void gc_selection_group_unref (GcSelectionGroup *group);
+
+void gc_selection_group_add_member (GcSelectionGroup     *group,
+                                    GcSelectionGroupFunc  func,
+                                    gpointer              user_data);
+void gc_selection_group_remove_member (GcSelectionGroup *group,
+                                       gpointer          user_data);
+
+GcMasterProvider *gc_selection_group_get_provider (GcSelectionGroup *group);
+GList *gc_selection_group_get_providers (GcSelectionGroup *group);
+
+G_END_DECLS
+
+#endif /* _SELECTION_GROUP_H_ */
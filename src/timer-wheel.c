@@ -0,0 +1,140 @@
+/*
+ * Geoclue
+ * timer-wheel.c - Shared one second timers for many short lived timeouts
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* All timers due in the same second share a slot, and one main loop
+ * source ticks the wheel once a second while any timer is scheduled.
+ * Timers further away than the wheel size stay in their slot for
+ * more rounds. */
+
+#include "timer-wheel.h"
+
+#define WHEEL_SIZE 64
+
+/* slot number of entries that are about to fire */
+#define FIRING_SLOT WHEEL_SIZE
+
+typedef struct _GcTimerWheel {
+	GQueue slots[WHEEL_SIZE + 1];
+	time_t last;  /* the last second that has been handled */
+	guint count;  /* scheduled entries */
+	guint source;
+} GcTimerWheel;
+
+static GcTimerWheel wheel;
+
+static void
+timer_wheel_unlink (GcTimerWheelEntry *entry)
+{
+	g_queue_delete_link (&wheel.slots[entry->slot], entry->link);
+	entry->link = NULL;
+	wheel.count--;
+}
+
+static void
+timer_wheel_expire_slot (guint slot, time_t now)
+{
+	GList *l, *next;
+
+	for (l = wheel.slots[slot].head; l; l = next) {
+		GcTimerWheelEntry *entry = l->data;
+
+		next = l->next;
+		if (entry->due <= now) {
+			g_queue_unlink (&wheel.slots[slot], l);
+			g_queue_push_tail_link (&wheel.slots[FIRING_SLOT], l);
+			entry->slot = FIRING_SLOT;
+		}
+	}
+}
+
+static gboolean
+timer_wheel_tick (gpointer unused)
+{
+	time_t now = time (NULL);
+	GcTimerWheelEntry *entry;
+
+	if (now < wheel.last) {
+		/* clock went back */
+		wheel.last = now;
+	} else if (now - wheel.last >= WHEEL_SIZE) {
+		guint i;
+
+		for (i = 0; i < WHEEL_SIZE; i++) {
+			timer_wheel_expire_slot (i, now);
+		}
+	} else {
+		time_t t;
+
+		for (t = wheel.last + 1; t <= now; t++) {
+			timer_wheel_expire_slot (t % WHEEL_SIZE, now);
+		}
+	}
+	wheel.last = now;
+
+	/* callbacks may schedule and cancel timers,
+	 * including the ones waiting here */
+	while ((entry = g_queue_peek_head (&wheel.slots[FIRING_SLOT]))) {
+		timer_wheel_unlink (entry);
+		entry->func (entry->data);
+	}
+
+	if (wheel.count == 0) {
+		wheel.source = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Calls func (data) once, after about @seconds seconds.
+ * A scheduled entry is rescheduled. */
+void
+gc_timer_wheel_schedule (GcTimerWheelEntry *entry,
+                         guint              seconds,
+                         GcTimerWheelFunc   func,
+                         gpointer           data)
+{
+	time_t now = time (NULL);
+
+	if (entry->link) {
+		timer_wheel_unlink (entry);
+	}
+
+	if (wheel.source == 0) {
+		wheel.last = now;
+		wheel.source = g_timeout_add_seconds (1, timer_wheel_tick, NULL);
+	}
+
+	entry->due = MAX (now, wheel.last) + MAX (seconds, 1);
+	entry->func = func;
+	entry->data = data;
+	entry->slot = entry->due % WHEEL_SIZE;
+	g_queue_push_tail (&wheel.slots[entry->slot], entry);
+	entry->link = wheel.slots[entry->slot].tail;
+	wheel.count++;
+}
+
+void
+gc_timer_wheel_cancel (GcTimerWheelEntry *entry)
+{
+	if (entry->link) {
+		timer_wheel_unlink (entry);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ * Geoclue
+ * timer-wheel.h - Shared one second timers for many short lived timeouts
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <time.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef void (*GcTimerWheelFunc) (gpointer data);
+
+/* A timer, usually embedded in the structure it belongs to.
+ * Must be zeroed before first use. */
+typedef struct _GcTimerWheelEntry {
+	time_t due;
+	GcTimerWheelFunc func;
+	gpointer data;
+	GList *link; /* in its slot, NULL when not scheduled */
+	guint slot;
+} GcTimerWheelEntry;
+
+void gc_timer_wheel_schedule (GcTimerWheelEntry *entry,
+                              guint              seconds,
+                              GcTimerWheelFunc   func,
+                              gpointer           data);
+void gc_timer_wheel_cancel (GcTimerWheelEntry *entry);
+
+#define gc_timer_wheel_is_scheduled(entry) ((entry)->link != NULL)
+
+G_END_DECLS
+
+#endif /* _TIMER_WHEEL_H_ */
@@ -0,0 +1,266 @@
+/*
+ * Geoclue
+ * geoclue-bench.c - Micro-benchmarks for response parsing and accuracy handling
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* Each benchmark times the code as it was before the change ("old")
+ * against the code as it is now ("new"):
+ *
+ *   xpath     the nine lookups Nominatim's reverse geocoder does for
+ *             each response, parsed on every lookup versus compiled
+ *             once as GcWebService now does
+ *   accuracy  one position update: the provider creates an accuracy,
+ *             the master copies it and compares it, and it is sent
+ *             over D-Bus once. The old GeoclueAccuracy was the D-Bus
+ *             GValueArray itself; the new one is a plain struct that
+ *             is converted only when sent.
+ *
+ * Usage: geoclue-bench [iterations]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+#include <libxml/parser.h>
+#include <libxml/xpath.h>
+
+#include <geoclue/geoclue-accuracy.h>
+
+#define DEFAULT_ITERATIONS 100000
+
+static const char *nominatim_response =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+	"<reversegeocode timestamp=\"Fri, 06 Nov 2009 11:50:35 +0000\" "
+	"attribution=\"Data Copyright OpenStreetMap Contributors\" "
+	"querystring=\"format=xml&amp;lat=60.1699&amp;lon=24.9384\">"
+	"<result place_id=\"62762024\" osm_type=\"way\" osm_id=\"29953186\">"
+	"Mannerheimintie 5, Kluuvi, Helsinki, 00100, Finland</result>"
+	"<addressparts>"
+	"<house>5</house>"
+	"<road>Mannerheimintie</road>"
+	"<village>Kluuvi</village>"
+	"<suburb>Southern major district</suburb>"
+	"<city>Helsinki</city>"
+	"<county>Uusimaa</county>"
+	"<postcode>00100</postcode>"
+	"<country>Finland</country>"
+	"<country_code>fi</country_code>"
+	"</addressparts>"
+	"</reversegeocode>";
+
+/* the expressions from providers/nominatim/geoclue-nominatim.c */
+static const char *nominatim_xpaths[] = {
+	"//reversegeocode/addressparts/house",
+	"//reversegeocode/addressparts/road",
+	"//reversegeocode/addressparts/village",
+	"//reversegeocode/addressparts/suburb",
+	"//reversegeocode/addressparts/city",
+	"//reversegeocode/addressparts/postcode",
+	"//reversegeocode/addressparts/county",
+	"//reversegeocode/addressparts/country",
+	"//reversegeocode/addressparts/country_code",
+};
+
+static guint
+count_nodes (xmlXPathObject *obj)
+{
+	guint n = 0;
+
+	if (obj) {
+		if (obj->nodesetval) {
+			n = obj->nodesetval->nodeNr;
+		}
+		xmlXPathFreeObject (obj);
+	}
+	return n;
+}
+
+static void
+bench_xpath (guint iterations)
+{
+	xmlDocPtr doc;
+	xmlXPathContext *ctx;
+	xmlXPathCompExprPtr comp[G_N_ELEMENTS (nominatim_xpaths)];
+	GTimer *timer;
+	double old_time, new_time;
+	guint i, j, old_nodes = 0, new_nodes = 0;
+
+	doc = xmlReadMemory (nominatim_response, strlen (nominatim_response),
+	                     "noname.xml", NULL, 0);
+	g_assert (doc);
+	ctx = xmlXPathNewContext (doc);
+	timer = g_timer_new ();
+
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < G_N_ELEMENTS (nominatim_xpaths); j++) {
+			old_nodes += count_nodes (xmlXPathEvalExpression ((xmlChar *) nominatim_xpaths[j], ctx));
+		}
+	}
+	old_time = g_timer_elapsed (timer, NULL);
+
+	/* the compiled expressions are kept for the lifetime of the
+	 * process, so compiling them is not part of the per-response cost */
+	for (j = 0; j < G_N_ELEMENTS (nominatim_xpaths); j++) {
+		comp[j] = xmlXPathCompile ((xmlChar *) nominatim_xpaths[j]);
+		g_assert (comp[j]);
+	}
+	g_timer_start (timer);
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < G_N_ELEMENTS (nominatim_xpaths); j++) {
+			new_nodes += count_nodes (xmlXPathCompiledEval (comp[j], ctx));
+		}
+	}
+	new_time = g_timer_elapsed (timer, NULL);
+
+	g_assert_cmpuint (old_nodes, ==, new_nodes);
+	g_assert_cmpuint (new_nodes, ==, iterations * G_N_ELEMENTS (nominatim_xpaths));
+
+	g_print ("xpath: %u responses of %u lookups\n",
+	         iterations, (guint) G_N_ELEMENTS (nominatim_xpaths));
+	g_print ("  old %8.2f us/response\n", old_time * 1e6 / iterations);
+	g_print ("  new %8.2f us/response\n", new_time * 1e6 / iterations);
+
+	for (j = 0; j < G_N_ELEMENTS (nominatim_xpaths); j++) {
+		xmlXPathFreeCompExpr (comp[j]);
+	}
+	g_timer_destroy (timer);
+	xmlXPathFreeContext (ctx);
+	xmlFreeDoc (doc);
+}
+
+/* The GeoclueAccuracy functions as they were when the accuracy was
+ * the D-Bus GValueArray */
+static GValueArray *
+old_accuracy_new (GeoclueAccuracyLevel level,
+                  double               horizontal_accuracy,
+                  double               vertical_accuracy)
+{
+	GValue accuracy_struct = {0, };
+
+	g_value_init (&accuracy_struct, GEOCLUE_ACCURACY_TYPE);
+	g_value_take_boxed (&accuracy_struct,
+	                    dbus_g_type_specialized_construct
+	                    (GEOCLUE_ACCURACY_TYPE));
+
+	dbus_g_type_struct_set (&accuracy_struct,
+	                        0, level,
+	                        1, horizontal_accuracy,
+	                        2, vertical_accuracy,
+	                        G_MAXUINT);
+
+	return (GValueArray *) g_value_get_boxed (&accuracy_struct);
+}
+
+static void
+old_accuracy_get_details (GValueArray          *vals,
+                          GeoclueAccuracyLevel *level,
+                          double               *horizontal_accuracy,
+                          double               *vertical_accuracy)
+{
+	*level = g_value_get_int (g_value_array_get_nth (vals, 0));
+	*horizontal_accuracy = g_value_get_double (g_value_array_get_nth (vals, 1));
+	*vertical_accuracy = g_value_get_double (g_value_array_get_nth (vals, 2));
+}
+
+static GValueArray *
+old_accuracy_copy (GValueArray *vals)
+{
+	GeoclueAccuracyLevel level;
+	double hor, ver;
+
+	old_accuracy_get_details (vals, &level, &hor, &ver);
+	return old_accuracy_new (level, hor, ver);
+}
+
+static void
+bench_accuracy (guint iterations)
+{
+	GTimer *timer;
+	double old_time, new_time;
+	double old_sum = 0.0, new_sum = 0.0;
+	guint i;
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < iterations; i++) {
+		GValueArray *accuracy, *copy;
+		GeoclueAccuracyLevel level;
+		double hor, ver;
+
+		accuracy = old_accuracy_new (GEOCLUE_ACCURACY_LEVEL_DETAILED,
+		                             i % 100, 10.0);
+		copy = old_accuracy_copy (accuracy);
+		old_accuracy_get_details (copy, &level, &hor, &ver);
+		old_sum += hor;
+		/* the accuracy was already in its wire form */
+		g_boxed_free (GEOCLUE_ACCURACY_TYPE, copy);
+		g_boxed_free (GEOCLUE_ACCURACY_TYPE, accuracy);
+	}
+	old_time = g_timer_elapsed (timer, NULL);
+
+	g_timer_start (timer);
+	for (i = 0; i < iterations; i++) {
+		GeoclueAccuracy *accuracy, *copy;
+		GeoclueAccuracyLevel level;
+		GValueArray *vals;
+		double hor, ver;
+
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_DETAILED,
+		                                 i % 100, 10.0);
+		copy = geoclue_accuracy_copy (accuracy);
+		geoclue_accuracy_get_details (copy, &level, &hor, &ver);
+		new_sum += hor;
+		vals = geoclue_accuracy_to_value_array (copy);
+		g_boxed_free (GEOCLUE_ACCURACY_TYPE, vals);
+		geoclue_accuracy_free (copy);
+		geoclue_accuracy_free (accuracy);
+	}
+	new_time = g_timer_elapsed (timer, NULL);
+
+	g_assert_cmpfloat (old_sum, ==, new_sum);
+
+	g_print ("accuracy: %u position updates\n", iterations);
+	g_print ("  old %8.0f ns/update\n", old_time * 1e9 / iterations);
+	g_print ("  new %8.0f ns/update\n", new_time * 1e9 / iterations);
+
+	g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+	guint iterations = DEFAULT_ITERATIONS;
+
+	g_type_init ();
+
+	if (argc > 1) {
+		iterations = strtoul (argv[1], NULL, 10);
+		if (iterations == 0) {
+			g_printerr ("Usage: %s [iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	bench_xpath (iterations);
+	bench_accuracy (iterations);
+
+	return 0;
+}
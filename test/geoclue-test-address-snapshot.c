@@ -0,0 +1,83 @@
+/*
+ * Geoclue
+ * geoclue-test-address-snapshot.c - Tests for the master's address snapshots
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <glib.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-address-details.h>
+
+#include "address-snapshot.h"
+
+static void
+test_address_snapshot (void)
+{
+	GcAddressSnapshot *snapshot, *empty;
+	GHashTable *details, *table, *copy;
+	guint i;
+
+	details = geoclue_address_details_new ();
+	geoclue_address_details_insert (details, GEOCLUE_ADDRESS_KEY_COUNTRY, "Finland");
+	geoclue_address_details_insert (details, GEOCLUE_ADDRESS_KEY_LOCALITY, "Helsinki");
+	snapshot = gc_address_snapshot_new (details);
+	g_hash_table_destroy (details);
+
+	g_assert_cmpuint (snapshot->n_fields, ==, 2);
+	for (i = 0; i < snapshot->n_fields; i++) {
+		g_assert (snapshot->fields[i].key == g_intern_string (snapshot->fields[i].key));
+	}
+
+	table = gc_address_snapshot_get_table (snapshot);
+	g_assert (gc_address_snapshot_get_table (snapshot) == table);
+	g_assert_cmpuint (g_hash_table_size (table), ==, 2);
+	g_assert_cmpstr (g_hash_table_lookup (table, GEOCLUE_ADDRESS_KEY_COUNTRY), ==, "Finland");
+	g_assert_cmpstr (g_hash_table_lookup (table, GEOCLUE_ADDRESS_KEY_LOCALITY), ==, "Helsinki");
+
+	/* a copy is the caller's own */
+	copy = gc_address_snapshot_to_hash_table (snapshot);
+	geoclue_address_details_insert (copy, GEOCLUE_ADDRESS_KEY_LOCALITY, "Espoo");
+	g_assert_cmpstr (g_hash_table_lookup (table, GEOCLUE_ADDRESS_KEY_LOCALITY), ==, "Helsinki");
+	g_hash_table_destroy (copy);
+
+	g_assert (gc_address_snapshot_ref (snapshot) == snapshot);
+	g_assert_cmpuint (snapshot->ref_count, ==, 2);
+	gc_address_snapshot_unref (snapshot);
+	g_assert_cmpstr (g_hash_table_lookup (table, GEOCLUE_ADDRESS_KEY_COUNTRY), ==, "Finland");
+	gc_address_snapshot_unref (snapshot);
+
+	empty = gc_address_snapshot_new (NULL);
+	g_assert_cmpuint (empty->n_fields, ==, 0);
+	g_assert_cmpuint (g_hash_table_size (gc_address_snapshot_get_table (empty)), ==, 0);
+	gc_address_snapshot_unref (empty);
+
+	copy = gc_address_snapshot_to_hash_table (NULL);
+	g_assert_cmpuint (g_hash_table_size (copy), ==, 0);
+	g_hash_table_destroy (copy);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/master/address-snapshot", test_address_snapshot);
+
+	return g_test_run ();
+}
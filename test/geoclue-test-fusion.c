@@ -0,0 +1,135 @@
+/*
+ * Geoclue
+ * geoclue-test-fusion.c - Tests for the master's position fusion
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <math.h>
+
+#include <glib.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+#include "position-fusion.h"
+
+static double
+fusion_get_accuracy (GcPositionFusion *fusion,
+                     double           *latitude,
+                     double           *longitude)
+{
+	GeoclueAccuracy *accuracy;
+	GeocluePositionFields fields;
+	double altitude, horizontal;
+	int timestamp;
+
+	fields = gc_position_fusion_get (fusion, &timestamp, latitude, longitude,
+	                                 &altitude, &accuracy);
+	g_assert (fields & GEOCLUE_POSITION_FIELDS_LATITUDE);
+	horizontal = accuracy->horizontal_accuracy;
+	geoclue_accuracy_free (accuracy);
+	return horizontal;
+}
+
+static void
+test_position_fusion (void)
+{
+	GcPositionFusion *fusion;
+	GeoclueAccuracy *accuracy, *level_only, *estimate;
+	GeocluePositionFields fields;
+	double latitude, longitude, altitude, first, second;
+	int timestamp;
+	int source_a, source_b, source_c;
+
+	fields = GEOCLUE_POSITION_FIELDS_LATITUDE | GEOCLUE_POSITION_FIELDS_LONGITUDE;
+	accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_DETAILED, 100.0, 0.0);
+	level_only = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_LOCALITY, 0.0, 0.0);
+	fusion = gc_position_fusion_new (1.0);
+
+	/* nothing known yet */
+	g_assert_cmpint (gc_position_fusion_get (fusion, &timestamp, &latitude, &longitude,
+	                                         &altitude, &estimate), ==,
+	                 GEOCLUE_POSITION_FIELDS_NONE);
+	geoclue_accuracy_free (estimate);
+
+	/* fixes without a position or an accuracy are not used */
+	g_assert (!gc_position_fusion_update (fusion, &source_a, GEOCLUE_POSITION_FIELDS_LATITUDE,
+	                                      100, 60.0, 25.0, 0.0, accuracy));
+	g_assert (!gc_position_fusion_update (fusion, &source_a, fields,
+	                                      100, 60.0, 25.0, 0.0, NULL));
+
+	g_assert (gc_position_fusion_update (fusion, &source_a, fields,
+	                                     100, 60.0, 25.0, 0.0, accuracy));
+	first = fusion_get_accuracy (fusion, &latitude, &longitude);
+	g_assert_cmpfloat (fabs (first - 100.0), <, 0.001);
+	g_assert_cmpfloat (latitude, ==, 60.0);
+	g_assert_cmpfloat (longitude, ==, 25.0);
+
+	/* the same fix again with a new timestamp is the same measurement */
+	g_assert (!gc_position_fusion_update (fusion, &source_a, fields,
+	                                      101, 60.0, 25.0, 0.0, accuracy));
+	g_assert_cmpfloat (fusion_get_accuracy (fusion, &latitude, &longitude), ==, first);
+
+	/* from another source it is new */
+	g_assert (gc_position_fusion_update (fusion, &source_b, fields,
+	                                     100, 60.0, 25.0, 0.0, accuracy));
+	second = fusion_get_accuracy (fusion, &latitude, &longitude);
+	g_assert_cmpfloat (second, <, first);
+	g_assert_cmpfloat (fabs (latitude - 60.0), <, 1e-9);
+
+	/* a new fix from the first source is used again */
+	g_assert (gc_position_fusion_update (fusion, &source_a, fields,
+	                                     100, 60.0001, 25.0, 0.0, accuracy));
+	g_assert_cmpfloat (fusion_get_accuracy (fusion, &latitude, &longitude), <, second);
+	g_assert_cmpfloat (latitude, >, 60.0);
+	g_assert_cmpfloat (latitude, <, 60.0001);
+
+	/* a level stands in for a missing radius; a fix far outside
+	 * the estimate starts over from it */
+	g_assert (gc_position_fusion_update (fusion, &source_c, fields,
+	                                     100, 50.0, 10.0, 0.0, level_only));
+	g_assert_cmpfloat (fusion_get_accuracy (fusion, &latitude, &longitude), ==, 10000.0);
+	g_assert_cmpfloat (latitude, ==, 50.0);
+	g_assert_cmpfloat (longitude, ==, 10.0);
+
+	/* after a reset, the last fixes count again */
+	gc_position_fusion_reset (fusion);
+	g_assert (gc_position_fusion_update (fusion, &source_a, fields,
+	                                     200, 60.0001, 25.0, 0.0, accuracy));
+	g_assert (gc_position_fusion_update (fusion, &source_b, fields | GEOCLUE_POSITION_FIELDS_ALTITUDE,
+	                                     200, 60.0001, 25.0, 30.0, accuracy));
+	g_assert (gc_position_fusion_get (fusion, &timestamp, &latitude, &longitude,
+	                                  &altitude, &estimate) & GEOCLUE_POSITION_FIELDS_ALTITUDE);
+	g_assert_cmpint (timestamp, ==, 200);
+	g_assert_cmpfloat (altitude, ==, 30.0);
+	geoclue_accuracy_free (estimate);
+
+	gc_position_fusion_free (fusion);
+	geoclue_accuracy_free (accuracy);
+	geoclue_accuracy_free (level_only);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/master/position-fusion", test_position_fusion);
+
+	return g_test_run ();
+}
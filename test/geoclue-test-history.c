@@ -0,0 +1,106 @@
+/*
+ * Geoclue
+ * geoclue-test-history.c - Tests for the master's position history
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <glib.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+#include "position-history.h"
+
+static void
+history_range_free (GcPositionHistoryRange *range)
+{
+	g_array_free (range->fields, TRUE);
+	g_array_free (range->timestamps, TRUE);
+	g_array_free (range->latitudes, TRUE);
+	g_array_free (range->longitudes, TRUE);
+	g_array_free (range->altitudes, TRUE);
+	g_array_free (range->levels, TRUE);
+	g_array_free (range->horizontal, TRUE);
+	g_array_free (range->vertical, TRUE);
+}
+
+static void
+assert_history (GcPositionHistory *history,
+                int                since,
+                guint              max,
+                int                first,
+                guint              length)
+{
+	GcPositionHistoryRange range;
+	guint i;
+
+	gc_position_history_get (history, since, max, &range);
+	g_assert_cmpuint (range.timestamps->len, ==, length);
+	g_assert_cmpuint (range.latitudes->len, ==, length);
+	g_assert_cmpuint (range.vertical->len, ==, length);
+	for (i = 0; i < length; i++) {
+		g_assert_cmpint (g_array_index (range.timestamps, int, i), ==, first + i);
+		g_assert_cmpfloat (g_array_index (range.latitudes, double, i), ==, first + i);
+		g_assert_cmpint (g_array_index (range.levels, int, i), ==,
+		                 GEOCLUE_ACCURACY_LEVEL_STREET);
+		g_assert_cmpfloat (g_array_index (range.horizontal, double, i), ==, 250.0);
+	}
+	history_range_free (&range);
+}
+
+static void
+test_position_history (void)
+{
+	GcPositionHistory *history;
+	GeoclueAccuracy *accuracy;
+	GeocluePositionFields fields;
+	int t;
+
+	fields = GEOCLUE_POSITION_FIELDS_LATITUDE | GEOCLUE_POSITION_FIELDS_LONGITUDE;
+	accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_STREET, 250.0, 0.0);
+	history = gc_position_history_new (4);
+
+	assert_history (history, 0, 0, 0, 0);
+	for (t = 10; t < 16; t++) {
+		gc_position_history_append (history, fields, t, t, 25.0, 0.0, accuracy);
+	}
+	/* a repeat and an older position are dropped */
+	gc_position_history_append (history, fields, 15, 15.0, 25.0, 0.0, accuracy);
+	gc_position_history_append (history, fields, 11, 11.0, 25.0, 0.0, accuracy);
+	g_assert_cmpuint (history->length, ==, 4);
+
+	/* the oldest two have been overwritten */
+	assert_history (history, 0, 0, 12, 4);
+	assert_history (history, 14, 0, 14, 2);
+	assert_history (history, 0, 3, 13, 3);
+	assert_history (history, 13, 1, 15, 1);
+	assert_history (history, 16, 0, 0, 0);
+
+	gc_position_history_free (history);
+	geoclue_accuracy_free (accuracy);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/master/position-history", test_position_history);
+
+	return g_test_run ();
+}
@@ -0,0 +1,590 @@
+/*
+ * Geoclue
+ * geoclue-test-http.c - Tests for the HTTP client and GcWebService
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* The requests go to a server on a loopback socket, run by a thread
+ * per connection. What it answers depends on the path:
+ *
+ *   /length    a body with Content-Length
+ *   /chunked   a chunked body
+ *   /gzip      a gzip encoded body
+ *   /stale     like /length, but the connection is closed without an
+ *              answer when the next request arrives on it
+ *   /slow      nothing at all
+ *   /xml       a small XML document, after a delay
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <glib-object.h>
+#include <zlib.h>
+
+#include <geoclue/geoclue-error.h>
+#include <geoclue/gc-http.h>
+#include <geoclue/gc-web-service.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define TEST_BODY "hello"
+#define TEST_GZIP_BODY "hello, hello, hello, compressed hello"
+#define TEST_XML_DELAY 200000
+
+static const char *test_xml =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<result>"
+	"<place id=\"42\">"
+	"<name>Helsinki</name>"
+	"<lat>60.17</lat>"
+	"<lon>24.94</lon>"
+	"</place>"
+	"</result>";
+
+static int server_port;
+static GMutex server_lock;
+static guint server_connections;
+static GHashTable *server_hits;  /* path -> number of requests */
+
+/* Test server */
+
+static guint
+server_get_hits (const char *path)
+{
+	guint hits;
+
+	g_mutex_lock (&server_lock);
+	hits = GPOINTER_TO_UINT (g_hash_table_lookup (server_hits, path));
+	g_mutex_unlock (&server_lock);
+	return hits;
+}
+
+static guint
+server_get_connections (void)
+{
+	guint connections;
+
+	g_mutex_lock (&server_lock);
+	connections = server_connections;
+	g_mutex_unlock (&server_lock);
+	return connections;
+}
+
+static gboolean
+server_write (int fd, const char *data, gsize len)
+{
+	while (len > 0) {
+		gssize n = send (fd, data, len, MSG_NOSIGNAL);
+
+		if (n <= 0) {
+			return FALSE;
+		}
+		data += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+static gboolean
+server_respond (int fd, const char *path, const char *data, gsize len,
+                const char *extra_headers)
+{
+	char *headers;
+	gboolean ok;
+
+	headers = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+	                           "Content-Length: %u\r\n"
+	                           "%s"
+	                           "\r\n",
+	                           (guint) len, extra_headers);
+	ok = server_write (fd, headers, strlen (headers)) &&
+	     server_write (fd, data, len);
+	g_free (headers);
+	return ok;
+}
+
+static GString *
+gzip_compress (const char *data)
+{
+	z_stream stream;
+	GString *out;
+	int ret;
+
+	memset (&stream, 0, sizeof (stream));
+	ret = deflateInit2 (&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+	                    15 + 16, 8, Z_DEFAULT_STRATEGY);
+	g_assert_cmpint (ret, ==, Z_OK);
+
+	out = g_string_sized_new (deflateBound (&stream, strlen (data)));
+	stream.next_in = (Bytef *) data;
+	stream.avail_in = strlen (data);
+	stream.next_out = (Bytef *) out->str;
+	stream.avail_out = out->allocated_len;
+	ret = deflate (&stream, Z_FINISH);
+	g_assert_cmpint (ret, ==, Z_STREAM_END);
+	g_string_set_size (out, stream.total_out);
+	deflateEnd (&stream);
+
+	return out;
+}
+
+/* Answers one request. Returns FALSE if the connection should be
+ * closed, and sets @doomed if the next request should not be answered */
+static gboolean
+server_handle (int fd, const char *path, gboolean *doomed)
+{
+	if (strcmp (path, "/length") == 0) {
+		return server_respond (fd, path, TEST_BODY, strlen (TEST_BODY), "");
+	} else if (strcmp (path, "/stale") == 0) {
+		*doomed = TRUE;
+		return server_respond (fd, path, TEST_BODY, strlen (TEST_BODY), "");
+	} else if (strcmp (path, "/chunked") == 0) {
+		const char *response =
+			"HTTP/1.1 200 OK\r\n"
+			"Transfer-Encoding: chunked\r\n"
+			"\r\n"
+			"3\r\nhel\r\n"
+			"2\r\nlo\r\n"
+			"0\r\n\r\n";
+
+		return server_write (fd, response, strlen (response));
+	} else if (strcmp (path, "/gzip") == 0) {
+		GString *body = gzip_compress (TEST_GZIP_BODY);
+		gboolean ok;
+
+		ok = server_respond (fd, path, body->str, body->len,
+		                     "Content-Encoding: gzip\r\n");
+		g_string_free (body, TRUE);
+		return ok;
+	} else if (strcmp (path, "/slow") == 0) {
+		/* the client gives up and closes the connection */
+		return TRUE;
+	} else if (strcmp (path, "/xml") == 0) {
+		/* long enough for identical queries to find this one */
+		g_usleep (TEST_XML_DELAY);
+		return server_respond (fd, path, test_xml, strlen (test_xml),
+		                       "Content-Type: text/xml\r\n");
+	}
+	return FALSE;
+}
+
+static gpointer
+server_connection_thread (gpointer data)
+{
+	int fd = GPOINTER_TO_INT (data);
+	GString *in = g_string_new (NULL);
+	gboolean doomed = FALSE;
+
+	for (;;) {
+		char buf[1024], path[256];
+		char *end, *query;
+		gssize n;
+
+		while (!(end = strstr (in->str, "\r\n\r\n"))) {
+			n = read (fd, buf, sizeof (buf));
+			if (n <= 0) {
+				goto out;
+			}
+			g_string_append_len (in, buf, n);
+		}
+		if (sscanf (in->str, "GET %255s ", path) != 1) {
+			break;
+		}
+		g_string_erase (in, 0, end + 4 - in->str);
+		if (doomed) {
+			/* a keep-alive connection the server has given up on */
+			break;
+		}
+
+		query = strchr (path, '?');
+		if (query) {
+			*query = '\0';
+		}
+		g_mutex_lock (&server_lock);
+		g_hash_table_insert (server_hits, g_strdup (path),
+		                     GUINT_TO_POINTER (GPOINTER_TO_UINT (g_hash_table_lookup (server_hits, path)) + 1));
+		g_mutex_unlock (&server_lock);
+
+		if (!server_handle (fd, path, &doomed)) {
+			break;
+		}
+	}
+out:
+	close (fd);
+	g_string_free (in, TRUE);
+	return NULL;
+}
+
+static gpointer
+server_thread (gpointer data)
+{
+	int listen_fd = GPOINTER_TO_INT (data);
+
+	for (;;) {
+		int fd = accept (listen_fd, NULL, NULL);
+
+		if (fd < 0) {
+			continue;
+		}
+		g_mutex_lock (&server_lock);
+		server_connections++;
+		g_mutex_unlock (&server_lock);
+		g_thread_unref (g_thread_new ("test-http-connection",
+		                              server_connection_thread,
+		                              GINT_TO_POINTER (fd)));
+	}
+	return NULL;
+}
+
+static void
+server_start (void)
+{
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof (addr);
+	int fd;
+
+	fd = socket (AF_INET, SOCK_STREAM, 0);
+	g_assert_cmpint (fd, >=, 0);
+	memset (&addr, 0, sizeof (addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	g_assert_cmpint (bind (fd, (struct sockaddr *) &addr, sizeof (addr)), ==, 0);
+	g_assert_cmpint (listen (fd, 16), ==, 0);
+	g_assert_cmpint (getsockname (fd, (struct sockaddr *) &addr, &addr_len), ==, 0);
+	server_port = ntohs (addr.sin_port);
+
+	server_hits = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_thread_unref (g_thread_new ("test-http-server", server_thread,
+	                              GINT_TO_POINTER (fd)));
+}
+
+static char *
+server_url (const char *path)
+{
+	return g_strdup_printf ("http://127.0.0.1:%d%s", server_port, path);
+}
+
+/* HTTP client */
+
+typedef struct _Fetch {
+	GMainLoop *loop;
+	guint *pending;
+	GBytes *body;
+	GError *error;
+} Fetch;
+
+static void
+fetch_done (GBytes *body, GError *error, gpointer user_data)
+{
+	Fetch *fetch = user_data;
+
+	fetch->body = body;
+	fetch->error = error ? g_error_copy (error) : NULL;
+	if (--(*fetch->pending) == 0) {
+		g_main_loop_quit (fetch->loop);
+	}
+}
+
+/* Fetches @n_paths paths at the same time */
+static void
+fetch_all (const char **paths, guint n_paths, guint timeout, Fetch *fetches)
+{
+	GMainLoop *loop;
+	guint pending = n_paths;
+	guint i;
+
+	loop = g_main_loop_new (NULL, FALSE);
+	for (i = 0; i < n_paths; i++) {
+		char *url = server_url (paths[i]);
+
+		fetches[i].loop = loop;
+		fetches[i].pending = &pending;
+		fetches[i].body = NULL;
+		fetches[i].error = NULL;
+		gc_http_get (url, NULL, timeout, fetch_done, &fetches[i]);
+		g_free (url);
+	}
+	g_main_loop_run (loop);
+	g_main_loop_unref (loop);
+}
+
+static void
+fetch_clear (Fetch *fetch)
+{
+	if (fetch->body) {
+		g_bytes_unref (fetch->body);
+	}
+	g_clear_error (&fetch->error);
+}
+
+static void
+assert_fetch (const char *path, const char *expected)
+{
+	Fetch fetch;
+
+	fetch_all (&path, 1, 5000, &fetch);
+	g_assert_no_error (fetch.error);
+	g_assert (fetch.body != NULL);
+	g_assert_cmpuint (g_bytes_get_size (fetch.body), ==, strlen (expected));
+	g_assert_cmpstr (g_bytes_get_data (fetch.body, NULL), ==, expected);
+	fetch_clear (&fetch);
+}
+
+static void
+test_http_content_length (void)
+{
+	assert_fetch ("/length", TEST_BODY);
+}
+
+static void
+test_http_chunked (void)
+{
+	assert_fetch ("/chunked", TEST_BODY);
+}
+
+static void
+test_http_gzip (void)
+{
+	GcHttpPoolStats before, after;
+
+	gc_http_pool_get_stats (&before);
+	assert_fetch ("/gzip", TEST_GZIP_BODY);
+	gc_http_pool_get_stats (&after);
+	g_assert_cmpuint (after.bytes_decoded - before.bytes_decoded, ==,
+	                  strlen (TEST_GZIP_BODY));
+}
+
+static void
+test_http_keep_alive (void)
+{
+	GcHttpPoolStats before, after;
+	guint connections;
+
+	assert_fetch ("/length", TEST_BODY);
+	connections = server_get_connections ();
+	gc_http_pool_get_stats (&before);
+
+	assert_fetch ("/length", TEST_BODY);
+	assert_fetch ("/chunked", TEST_BODY);
+
+	gc_http_pool_get_stats (&after);
+	g_assert_cmpuint (server_get_connections (), ==, connections);
+	g_assert_cmpuint (after.requests - before.requests, ==, 2);
+	g_assert_cmpuint (after.reused - before.reused, ==, 2);
+	g_assert_cmpuint (after.idle_sockets, >=, 1);
+}
+
+static void
+test_http_stale (void)
+{
+	const char *paths[] = { "/stale", "/stale" };
+	Fetch fetches[G_N_ELEMENTS (paths)];
+	GcHttpPoolStats before, after;
+	guint connections, i;
+
+	/* two pooled sockets the server will close on the next request */
+	fetch_all (paths, G_N_ELEMENTS (paths), 5000, fetches);
+	for (i = 0; i < G_N_ELEMENTS (paths); i++) {
+		g_assert_no_error (fetches[i].error);
+		fetch_clear (&fetches[i]);
+	}
+	connections = server_get_connections ();
+	gc_http_pool_get_stats (&before);
+
+	/* the retry must not be handed the other stale socket */
+	assert_fetch ("/length", TEST_BODY);
+
+	gc_http_pool_get_stats (&after);
+	g_assert_cmpuint (server_get_connections (), ==, connections + 1);
+	g_assert_cmpuint (after.reused - before.reused, ==, 1);
+	g_assert_cmpuint (after.opened - before.opened, ==, 1);
+}
+
+static void
+test_http_deadline (void)
+{
+	const char *path = "/slow";
+	Fetch fetch;
+	GTimer *timer;
+
+	timer = g_timer_new ();
+	fetch_all (&path, 1, 200, &fetch);
+	g_assert_cmpfloat (g_timer_elapsed (timer, NULL), <, 5.0);
+	g_assert_error (fetch.error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE);
+	g_assert (fetch.body == NULL);
+	fetch_clear (&fetch);
+	g_timer_destroy (timer);
+}
+
+/* GcWebService */
+
+static GcWebService *
+web_service_new (void)
+{
+	GcWebService *web_service;
+	char *url;
+
+	web_service = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
+	url = server_url ("/xml");
+	gc_web_service_set_base_url (web_service, url);
+	g_free (url);
+	return web_service;
+}
+
+typedef struct _Query {
+	GMainLoop *loop;
+	guint pending;
+	guint failed;
+} Query;
+
+static void
+query_done (GcWebService *web_service, GError *error, gpointer user_data)
+{
+	Query *query = user_data;
+	char *name = NULL;
+
+	if (error || !gc_web_service_get_string (web_service, &name, "//place/name")) {
+		query->failed++;
+	}
+	g_free (name);
+	if (--query->pending == 0) {
+		g_main_loop_quit (query->loop);
+	}
+}
+
+static void
+test_web_service_coalesce (void)
+{
+	GcWebService *first, *second;
+	Query query;
+	guint hits;
+
+	first = web_service_new ();
+	second = web_service_new ();
+	hits = server_get_hits ("/xml");
+
+	query.loop = g_main_loop_new (NULL, FALSE);
+	query.pending = 2;
+	query.failed = 0;
+	g_assert (gc_web_service_query_async (first, query_done, &query,
+	                                      "q", "helsinki", (char *) NULL));
+	g_assert (gc_web_service_query_async (second, query_done, &query,
+	                                      "q", "helsinki", (char *) NULL));
+	g_main_loop_run (query.loop);
+
+	g_assert_cmpuint (query.failed, ==, 0);
+	g_assert_cmpuint (server_get_hits ("/xml"), ==, hits + 1);
+
+	g_main_loop_unref (query.loop);
+	g_object_unref (first);
+	g_object_unref (second);
+}
+
+static guint
+extract (GcWebService *web_service,
+         char        **name,
+         char        **id,
+         char        **missing,
+         double       *lat,
+         double       *lon)
+{
+	GcWebServiceField fields[] = {
+		{ "//place/name", GC_WEB_SERVICE_FIELD_STRING, name, FALSE },
+		{ "//place/@id", GC_WEB_SERVICE_FIELD_STRING, id, FALSE },
+		{ "//place/lat", GC_WEB_SERVICE_FIELD_DOUBLE, lat, FALSE },
+		{ "//place/lon", GC_WEB_SERVICE_FIELD_DOUBLE, lon, FALSE },
+		{ "//place/country", GC_WEB_SERVICE_FIELD_STRING, missing, FALSE },
+	};
+
+	*name = *id = *missing = NULL;
+	*lat = *lon = 0.0;
+	return gc_web_service_extract (web_service, fields, G_N_ELEMENTS (fields));
+}
+
+static void
+test_web_service_extract (void)
+{
+	GcWebService *web_service;
+	GError *error = NULL;
+	char *stream_name, *stream_id, *stream_missing;
+	char *tree_name, *tree_id, *tree_missing;
+	char *name = NULL;
+	double stream_lat, stream_lon, tree_lat, tree_lon;
+
+	web_service = web_service_new ();
+	g_assert (gc_web_service_query (web_service, &error,
+	                                "q", "extract", (char *) NULL));
+	g_assert_no_error (error);
+
+	/* nothing has parsed the response yet, so it is streamed */
+	g_assert_cmpuint (extract (web_service, &stream_name, &stream_id,
+	                           &stream_missing, &stream_lat, &stream_lon), ==, 4);
+
+	/* now the document exists, and the fields come from the tree */
+	g_assert (gc_web_service_get_string (web_service, &name, "//place/name"));
+	g_assert_cmpuint (extract (web_service, &tree_name, &tree_id,
+	                           &tree_missing, &tree_lat, &tree_lon), ==, 4);
+
+	g_assert_cmpstr (stream_name, ==, "Helsinki");
+	g_assert_cmpstr (stream_id, ==, "42");
+	g_assert (stream_missing == NULL);
+	g_assert_cmpfloat (stream_lat, ==, 60.17);
+	g_assert_cmpfloat (stream_lon, ==, 24.94);
+
+	g_assert_cmpstr (tree_name, ==, stream_name);
+	g_assert_cmpstr (tree_id, ==, stream_id);
+	g_assert (tree_missing == NULL);
+	g_assert_cmpfloat (tree_lat, ==, stream_lat);
+	g_assert_cmpfloat (tree_lon, ==, stream_lon);
+	g_assert_cmpstr (name, ==, stream_name);
+
+	g_free (stream_name);
+	g_free (stream_id);
+	g_free (tree_name);
+	g_free (tree_id);
+	g_free (name);
+	g_object_unref (web_service);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	server_start ();
+
+	g_test_add_func ("/http/content-length", test_http_content_length);
+	g_test_add_func ("/http/chunked", test_http_chunked);
+	g_test_add_func ("/http/gzip", test_http_gzip);
+	g_test_add_func ("/http/keep-alive", test_http_keep_alive);
+	g_test_add_func ("/http/stale", test_http_stale);
+	g_test_add_func ("/http/deadline", test_http_deadline);
+	g_test_add_func ("/web-service/coalesce", test_web_service_coalesce);
+	g_test_add_func ("/web-service/extract", test_web_service_extract);
+
+	return g_test_run ();
+}
@@ -0,0 +1,125 @@
+/*
+ * Geoclue
+ * geoclue-test-master-index.c - Tests for the master's bitset index of providers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <glib-object.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+#include "master-index.h"
+#include "test-provider.h"
+
+static void
+test_master_index (void)
+{
+	GList *providers = NULL, *found, *stray, *l, *f;
+	GRand *rand;
+	guint i;
+
+	/* more than one word of bits */
+	rand = g_rand_new_with_seed (20);
+	for (i = 0; i < 70; i++) {
+		TestProvider *provider;
+		char *name;
+
+		name = g_strdup_printf ("provider%u", i);
+		provider = test_provider_new (name,
+		                              g_rand_int_range (rand, GEOCLUE_ACCURACY_LEVEL_NONE,
+		                                                GEOCLUE_ACCURACY_LEVEL_DETAILED + 1),
+		                              g_rand_int_range (rand, 0, 1 << 3) |
+		                              (i % 11 == 0 ? 1 << 9 : 0),
+		                              GEOCLUE_STATUS_AVAILABLE);
+		provider->interfaces = g_rand_int_range (rand, 0, GC_IFACE_ALL + 1);
+		provider->updates = g_rand_boolean (rand);
+		providers = g_list_prepend (providers, provider);
+		g_free (name);
+	}
+	gc_master_index_build (providers);
+
+	for (i = 0; i < 2000; i++) {
+		GcInterfaceFlags iface;
+		GeoclueAccuracyLevel min_accuracy;
+		gboolean can_update;
+		GeoclueResourceFlags allowed;
+		GList *expected = NULL, *again;
+
+		iface = g_rand_int_range (rand, 0, GC_IFACE_ALL + 1) &
+		        g_rand_int_range (rand, 0, GC_IFACE_ALL + 1);
+		min_accuracy = g_rand_int_range (rand, GEOCLUE_ACCURACY_LEVEL_NONE,
+		                                 GEOCLUE_ACCURACY_LEVEL_DETAILED + 1);
+		can_update = g_rand_boolean (rand);
+		allowed = g_rand_boolean (rand) ? GEOCLUE_RESOURCE_ALL :
+		          g_rand_int_range (rand, 0, 1 << 3);
+
+		/* the scan the index replaces */
+		for (l = providers; l; l = l->next) {
+			if (gc_master_provider_is_good (l->data, iface, min_accuracy,
+			                                can_update, allowed)) {
+				expected = g_list_prepend (expected, l->data);
+			}
+		}
+		found = gc_master_index_get_providers (iface, min_accuracy,
+		                                       can_update, allowed);
+		again = gc_master_index_get_providers (iface, min_accuracy,
+		                                       can_update, allowed);
+		/* bits that name no resource do not change the answer */
+		stray = gc_master_index_get_providers (iface, min_accuracy, can_update,
+		                                       allowed | ~GEOCLUE_RESOURCE_ALL);
+
+		g_assert_cmpuint (g_list_length (found), ==, g_list_length (expected));
+		for (l = expected, f = found; l; l = l->next, f = f->next) {
+			g_assert (l->data == f->data);
+		}
+		g_assert_cmpuint (g_list_length (again), ==, g_list_length (found));
+		for (l = again, f = found; l; l = l->next, f = f->next) {
+			g_assert (l->data == f->data);
+		}
+		g_assert_cmpuint (g_list_length (stray), ==, g_list_length (found));
+		for (l = stray, f = found; l; l = l->next, f = f->next) {
+			g_assert (l->data == f->data);
+		}
+		g_list_free (expected);
+		g_list_free (found);
+		g_list_free (again);
+		g_list_free (stray);
+	}
+
+	/* nobody implements an unknown interface or a level above detailed */
+	g_assert (gc_master_index_get_providers (GC_IFACE_ALL + 1, GEOCLUE_ACCURACY_LEVEL_NONE,
+	                                         FALSE, GEOCLUE_RESOURCE_ALL) == NULL);
+	g_assert (gc_master_index_get_providers (GC_IFACE_NONE, GEOCLUE_ACCURACY_LEVEL_DETAILED + 1,
+	                                         FALSE, GEOCLUE_RESOURCE_ALL) == NULL);
+
+	g_rand_free (rand);
+	gc_master_index_build (NULL);
+	test_providers_free (providers);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/master/index", test_master_index);
+
+	return g_test_run ();
+}
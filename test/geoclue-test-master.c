@@ -0,0 +1,136 @@
+/*
+ * Geoclue
+ * geoclue-test-master.c - Tests for the master's provider selection
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <glib-object.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+#include "master-index.h"
+#include "selection-group.h"
+#include "test-provider.h"
+
+/* SELECTION_MAX_PASSES in selection-group.c */
+#define MAX_PASSES_PER_EVENT 3
+
+/* Provider selection */
+
+static void
+selection_changed (GcSelectionGroup *group, gpointer user_data)
+{
+	guint *changes = user_data;
+
+	(*changes)++;
+}
+
+static void
+test_selection_flapping (void)
+{
+	TestProvider *test_providers[4];
+	GcSelectionGroup *group;
+	GList *providers = NULL;
+	GRand *rand;
+	guint changes = 0, events, i, j;
+
+	test_providers[0] = test_provider_new ("gps", GEOCLUE_ACCURACY_LEVEL_DETAILED,
+	                                       GEOCLUE_RESOURCE_NONE, GEOCLUE_STATUS_ACQUIRING);
+	test_providers[1] = test_provider_new ("wifi", GEOCLUE_ACCURACY_LEVEL_STREET,
+	                                       GEOCLUE_RESOURCE_NONE, GEOCLUE_STATUS_AVAILABLE);
+	test_providers[2] = test_provider_new ("cell", GEOCLUE_ACCURACY_LEVEL_POSTALCODE,
+	                                       GEOCLUE_RESOURCE_NONE, GEOCLUE_STATUS_ERROR);
+	test_providers[3] = test_provider_new ("ip", GEOCLUE_ACCURACY_LEVEL_LOCALITY,
+	                                       GEOCLUE_RESOURCE_NONE, GEOCLUE_STATUS_AVAILABLE);
+	test_providers[1]->flap = TRUE;
+	test_providers[2]->flap = TRUE;
+	for (i = 0; i < G_N_ELEMENTS (test_providers); i++) {
+		providers = g_list_append (providers, test_providers[i]);
+	}
+	gc_master_index_build (providers);
+
+	group = gc_selection_group_get (GC_IFACE_POSITION, GEOCLUE_ACCURACY_LEVEL_NONE,
+	                                FALSE, GEOCLUE_RESOURCE_ALL);
+	gc_selection_group_add_member (group, selection_changed, &changes);
+	g_assert_cmpuint (g_list_length (gc_selection_group_get_providers (group)), ==, 4);
+	/* the choice made when the group was created */
+	events = 1;
+
+	rand = g_rand_new_with_seed (2);
+	for (i = 0; i < 1000; i++) {
+		TestProvider *provider;
+		GcMasterProvider *current;
+
+		if (group->state == GC_SELECTION_IDLE) {
+			/* a new round starts with the next choice */
+			for (j = 0; j < G_N_ELEMENTS (test_providers); j++) {
+				test_providers[j]->starts = 0;
+			}
+			group->passes = 0;
+			events = 0;
+		}
+		events++;
+
+		provider = test_providers[g_rand_int_range (rand, 0, G_N_ELEMENTS (test_providers))];
+		if (g_rand_int_range (rand, 0, 4) == 0) {
+			test_provider_set_accuracy (provider,
+			                            g_rand_int_range (rand, GEOCLUE_ACCURACY_LEVEL_COUNTRY,
+			                                              GEOCLUE_ACCURACY_LEVEL_DETAILED + 1));
+		} else {
+			test_provider_set_status (provider,
+			                          g_rand_int_range (rand, GEOCLUE_STATUS_ERROR,
+			                                            GEOCLUE_STATUS_AVAILABLE + 1));
+		}
+
+		for (j = 0; j < G_N_ELEMENTS (test_providers); j++) {
+			g_assert_cmpuint (test_providers[j]->starts, <=, 1);
+		}
+		g_assert_cmpuint (group->passes, <=, events * MAX_PASSES_PER_EVENT);
+		g_assert (!group->in_pass);
+
+		current = gc_selection_group_get_provider (group);
+		if (current) {
+			g_assert_cmpint (gc_master_provider_get_status (current), ==,
+			                 GEOCLUE_STATUS_AVAILABLE);
+			g_assert (gc_master_provider_is_running (current));
+		}
+	}
+	g_assert_cmpuint (changes, >, 0);
+
+	gc_selection_group_remove_member (group, &changes);
+	gc_selection_group_unref (group);
+	for (i = 0; i < G_N_ELEMENTS (test_providers); i++) {
+		g_assert (!gc_master_provider_is_running (GC_MASTER_PROVIDER (test_providers[i])));
+	}
+
+	g_rand_free (rand);
+	gc_master_index_build (NULL);
+	test_providers_free (providers);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/master/selection/flapping", test_selection_flapping);
+
+	return g_test_run ();
+}
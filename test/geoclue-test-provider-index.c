@@ -0,0 +1,117 @@
+/*
+ * Geoclue
+ * geoclue-test-provider-index.c - Tests for the master's ranked provider lists
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <stdarg.h>
+
+#include <glib-object.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+#include "master-index.h"
+#include "provider-index.h"
+#include "test-provider.h"
+
+static void
+assert_providers (GList *list, ...)
+{
+	va_list args;
+	TestProvider *provider;
+
+	va_start (args, list);
+	while ((provider = va_arg (args, TestProvider *))) {
+		g_assert (list != NULL);
+		g_assert_cmpstr (TEST_PROVIDER (list->data)->name, ==, provider->name);
+		list = list->next;
+	}
+	va_end (args);
+	g_assert (list == NULL);
+}
+
+static void
+test_provider_index (void)
+{
+	TestProvider *ip, *gps, *wifi, *manual;
+	GcProviderIndex *index, *same, *street;
+	GList *providers = NULL;
+
+	ip = test_provider_new ("ip", GEOCLUE_ACCURACY_LEVEL_LOCALITY,
+	                        GEOCLUE_RESOURCE_NETWORK, GEOCLUE_STATUS_AVAILABLE);
+	gps = test_provider_new ("gps", GEOCLUE_ACCURACY_LEVEL_DETAILED,
+	                         GEOCLUE_RESOURCE_GPS, GEOCLUE_STATUS_AVAILABLE);
+	wifi = test_provider_new ("wifi", GEOCLUE_ACCURACY_LEVEL_STREET,
+	                          GEOCLUE_RESOURCE_NETWORK, GEOCLUE_STATUS_AVAILABLE);
+	manual = test_provider_new ("manual", GEOCLUE_ACCURACY_LEVEL_COUNTRY,
+	                            GEOCLUE_RESOURCE_NONE, GEOCLUE_STATUS_AVAILABLE);
+	providers = g_list_prepend (providers, ip);
+	providers = g_list_prepend (providers, gps);
+	providers = g_list_prepend (providers, wifi);
+	providers = g_list_prepend (providers, manual);
+	gc_master_index_build (providers);
+
+	/* fewer resources first, then better accuracy */
+	index = gc_provider_index_get (GC_IFACE_POSITION, GEOCLUE_ACCURACY_LEVEL_NONE,
+	                               FALSE, GEOCLUE_RESOURCE_ALL);
+	assert_providers (gc_provider_index_get_providers (index),
+	                  manual, wifi, ip, gps, NULL);
+
+	same = gc_provider_index_get (GC_IFACE_POSITION, GEOCLUE_ACCURACY_LEVEL_NONE,
+	                              FALSE, GEOCLUE_RESOURCE_ALL);
+	g_assert (same == index);
+	g_assert_cmpuint (index->ref_count, ==, 2);
+	gc_provider_index_unref (same);
+
+	street = gc_provider_index_get (GC_IFACE_POSITION, GEOCLUE_ACCURACY_LEVEL_STREET,
+	                                FALSE, GEOCLUE_RESOURCE_ALL);
+	assert_providers (gc_provider_index_get_providers (street), wifi, gps, NULL);
+	g_assert (gc_provider_index_contains (street, GC_MASTER_PROVIDER (gps)));
+	g_assert (!gc_provider_index_contains (street, GC_MASTER_PROVIDER (ip)));
+
+	/* only a provider whose level changed moves */
+	g_assert (!gc_provider_index_update (index, GC_MASTER_PROVIDER (ip)));
+	ip->level = GEOCLUE_ACCURACY_LEVEL_DETAILED;
+	g_assert (gc_provider_index_update (index, GC_MASTER_PROVIDER (ip)));
+	assert_providers (gc_provider_index_get_providers (index),
+	                  manual, ip, wifi, gps, NULL);
+	g_assert (!gc_provider_index_update (index, GC_MASTER_PROVIDER (ip)));
+
+	/* below the minimum, accuracy goes before resources */
+	wifi->level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	g_assert (gc_provider_index_update (street, GC_MASTER_PROVIDER (wifi)));
+	assert_providers (gc_provider_index_get_providers (street), gps, wifi, NULL);
+	g_assert (!gc_provider_index_update (street, GC_MASTER_PROVIDER (ip)));
+
+	gc_provider_index_unref (street);
+	gc_provider_index_unref (index);
+	gc_master_index_build (NULL);
+	test_providers_free (providers);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/master/provider-index", test_provider_index);
+
+	return g_test_run ();
+}
@@ -0,0 +1,120 @@
+/*
+ * Geoclue
+ * geoclue-test-timer-wheel.c - Tests for the master's timer wheel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "timer-wheel.h"
+
+typedef struct _TimerTest TimerTest;
+
+typedef struct _TimerTestEntry {
+	GcTimerWheelEntry entry;
+	TimerTest *test;
+	const char *name;
+} TimerTestEntry;
+
+struct _TimerTest {
+	GMainLoop *loop;
+	GString *fired;
+	TimerTestEntry a, b, c, d;
+};
+
+static void
+timer_fired (gpointer data)
+{
+	TimerTestEntry *entry = data;
+	TimerTest *test = entry->test;
+
+	g_string_append (test->fired, entry->name);
+	if (strcmp (test->fired->str, "a") == 0) {
+		/* rescheduling from a callback */
+		gc_timer_wheel_schedule (&entry->entry, 1, timer_fired, entry);
+	}
+	if (test->fired->len == 4) {
+		g_main_loop_quit (test->loop);
+	}
+}
+
+static gboolean
+timer_timeout (gpointer data)
+{
+	g_assert_not_reached ();
+	return FALSE;
+}
+
+static void
+timer_schedule (TimerTest      *test,
+                TimerTestEntry *entry,
+                const char     *name,
+                guint           seconds)
+{
+	entry->test = test;
+	entry->name = name;
+	gc_timer_wheel_schedule (&entry->entry, seconds, timer_fired, entry);
+}
+
+static void
+test_timer_wheel (void)
+{
+	TimerTest test;
+	guint timeout;
+
+	memset (&test, 0, sizeof (TimerTest));
+	test.loop = g_main_loop_new (NULL, FALSE);
+	test.fired = g_string_new (NULL);
+
+	timer_schedule (&test, &test.a, "a", 1);
+	timer_schedule (&test, &test.b, "b", 2);
+	timer_schedule (&test, &test.c, "c", 1);
+	timer_schedule (&test, &test.d, "d", 1);
+	g_assert (gc_timer_wheel_is_scheduled (&test.c.entry));
+
+	/* cancelled and rescheduled entries fire at most once */
+	gc_timer_wheel_cancel (&test.c.entry);
+	g_assert (!gc_timer_wheel_is_scheduled (&test.c.entry));
+	gc_timer_wheel_cancel (&test.c.entry);
+	timer_schedule (&test, &test.d, "d", 2);
+
+	timeout = g_timeout_add_seconds (10, timer_timeout, NULL);
+	g_main_loop_run (test.loop);
+	g_source_remove (timeout);
+
+	/* in due order, and in scheduling order within a second */
+	g_assert_cmpstr (test.fired->str, ==, "abda");
+	g_assert (!gc_timer_wheel_is_scheduled (&test.a.entry));
+	g_assert (!gc_timer_wheel_is_scheduled (&test.b.entry));
+	g_assert (!gc_timer_wheel_is_scheduled (&test.d.entry));
+
+	g_string_free (test.fired, TRUE);
+	g_main_loop_unref (test.loop);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/master/timer-wheel", test_timer_wheel);
+
+	return g_test_run ();
+}
@@ -0,0 +1,220 @@
+/*
+ * Geoclue
+ * test-provider.c - A GcMasterProvider stub for the tests
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* The modules are linked from src/ without the D-Bus side of the
+ * master: GcMasterProvider is replaced by the stub below, and
+ * gc_master_get_providers () answers from the bitset index. */
+
+#include "master.h"
+#include "master-index.h"
+#include "test-provider.h"
+
+G_DEFINE_TYPE (GcMasterProvider, gc_master_provider, G_TYPE_OBJECT)
+G_DEFINE_TYPE (TestProvider, test_provider, GC_TYPE_MASTER_PROVIDER)
+
+static void
+gc_master_provider_class_init (GcMasterProviderClass *klass)
+{
+	g_signal_new ("status-changed",
+	              G_TYPE_FROM_CLASS (klass),
+	              G_SIGNAL_RUN_FIRST,
+	              G_STRUCT_OFFSET (GcMasterProviderClass, status_changed),
+	              NULL, NULL, NULL,
+	              G_TYPE_NONE, 1,
+	              G_TYPE_INT);
+	g_signal_new ("accuracy-changed",
+	              G_TYPE_FROM_CLASS (klass),
+	              G_SIGNAL_RUN_FIRST,
+	              G_STRUCT_OFFSET (GcMasterProviderClass, accuracy_changed),
+	              NULL, NULL, NULL,
+	              G_TYPE_NONE, 2,
+	              G_TYPE_INT, G_TYPE_INT);
+}
+
+static void
+gc_master_provider_init (GcMasterProvider *provider)
+{
+}
+
+static void
+test_provider_finalize (GObject *object)
+{
+	TestProvider *provider = TEST_PROVIDER (object);
+
+	g_free (provider->name);
+	g_list_free (provider->clients);
+
+	G_OBJECT_CLASS (test_provider_parent_class)->finalize (object);
+}
+
+static void
+test_provider_class_init (TestProviderClass *klass)
+{
+	GObjectClass *o_class = (GObjectClass *) klass;
+
+	o_class->finalize = test_provider_finalize;
+}
+
+static void
+test_provider_init (TestProvider *provider)
+{
+}
+
+TestProvider *
+test_provider_new (const char           *name,
+                   GeoclueAccuracyLevel  level,
+                   GeoclueResourceFlags  resources,
+                   GeoclueStatus         status)
+{
+	TestProvider *provider;
+
+	provider = g_object_new (TEST_TYPE_PROVIDER, NULL);
+	provider->name = g_strdup (name);
+	provider->interfaces = GC_IFACE_GEOCLUE | GC_IFACE_POSITION;
+	provider->updates = TRUE;
+	provider->expected = level;
+	provider->level = level;
+	provider->resources = resources;
+	provider->status = status;
+
+	return provider;
+}
+
+void
+test_providers_free (GList *providers)
+{
+	g_list_foreach (providers, (GFunc) g_object_unref, NULL);
+	g_list_free (providers);
+}
+
+void
+test_provider_set_status (TestProvider *provider, GeoclueStatus status)
+{
+	provider->status = status;
+	/* only a running provider can tell */
+	if (provider->clients) {
+		g_signal_emit_by_name (provider, "status-changed", status);
+	}
+}
+
+void
+test_provider_set_accuracy (TestProvider *provider, GeoclueAccuracyLevel level)
+{
+	provider->level = level;
+	g_signal_emit_by_name (provider, "accuracy-changed",
+	                       GC_IFACE_POSITION, level);
+}
+
+/* The parts of GcMasterProvider the modules under test use */
+
+gboolean
+gc_master_provider_is_good (GcMasterProvider     *master_provider,
+                            GcInterfaceFlags      iface_types,
+                            GeoclueAccuracyLevel  min_accuracy,
+                            gboolean              need_update,
+                            GeoclueResourceFlags  allowed_resources)
+{
+	TestProvider *provider = TEST_PROVIDER (master_provider);
+
+	return ((provider->interfaces & iface_types) == iface_types &&
+	        (provider->updates || !need_update) &&
+	        provider->expected >= min_accuracy &&
+	        (provider->resources & ~allowed_resources) == 0);
+}
+
+char *
+gc_master_provider_get_name (GcMasterProvider *master_provider)
+{
+	return TEST_PROVIDER (master_provider)->name;
+}
+
+GeoclueStatus
+gc_master_provider_get_status (GcMasterProvider *master_provider)
+{
+	return TEST_PROVIDER (master_provider)->status;
+}
+
+GeoclueAccuracyLevel
+gc_master_provider_get_accuracy (GcMasterProvider *master_provider,
+                                 GcInterfaceFlags  iface)
+{
+	return TEST_PROVIDER (master_provider)->level;
+}
+
+GeoclueResourceFlags
+gc_master_provider_get_required_resources (GcMasterProvider *master_provider)
+{
+	return TEST_PROVIDER (master_provider)->resources;
+}
+
+gboolean
+gc_master_provider_is_running (GcMasterProvider *master_provider)
+{
+	return TEST_PROVIDER (master_provider)->clients != NULL;
+}
+
+/* starts the provider on the first client, which may report a new
+ * status right away */
+gboolean
+gc_master_provider_subscribe (GcMasterProvider *master_provider,
+                              gpointer          client,
+                              GcInterfaceFlags  interface)
+{
+	TestProvider *provider = TEST_PROVIDER (master_provider);
+	gboolean started;
+
+	if (g_list_find (provider->clients, client)) {
+		return FALSE;
+	}
+	started = (provider->clients == NULL);
+	provider->clients = g_list_prepend (provider->clients, client);
+	if (started) {
+		provider->starts++;
+		if (provider->flap) {
+			test_provider_set_status (provider,
+			                          provider->status == GEOCLUE_STATUS_AVAILABLE ?
+			                          GEOCLUE_STATUS_ERROR : GEOCLUE_STATUS_AVAILABLE);
+		}
+	}
+	return started;
+}
+
+/* stops the provider on the last client */
+void
+gc_master_provider_unsubscribe (GcMasterProvider *master_provider,
+                                gpointer          client,
+                                GcInterfaceFlags  interface)
+{
+	TestProvider *provider = TEST_PROVIDER (master_provider);
+
+	provider->clients = g_list_remove (provider->clients, client);
+}
+
+GList *
+gc_master_get_providers (GcInterfaceFlags      iface_type,
+                         GeoclueAccuracyLevel  min_accuracy,
+                         gboolean              can_update,
+                         GeoclueResourceFlags  allowed,
+                         GError              **error)
+{
+	return gc_master_index_get_providers (iface_type, min_accuracy,
+	                                      can_update, allowed);
+}
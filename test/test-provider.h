@@ -0,0 +1,71 @@
+/*
+ * Geoclue
+ * test-provider.h - A GcMasterProvider stub for the tests
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _TEST_PROVIDER_H_
+#define _TEST_PROVIDER_H_
+
+#include <glib-object.h>
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+#include "master-provider.h"
+
+G_BEGIN_DECLS
+
+#define TEST_TYPE_PROVIDER (test_provider_get_type ())
+#define TEST_PROVIDER(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_PROVIDER, TestProvider))
+
+typedef struct _TestProvider {
+	GcMasterProvider parent;
+
+	char *name;
+	GcInterfaceFlags interfaces;
+	gboolean updates;
+	GeoclueAccuracyLevel expected;  /* from the .provider file */
+	GeoclueAccuracyLevel level;     /* current */
+	GeoclueResourceFlags resources;
+
+	GeoclueStatus status;
+	gboolean flap;   /* toggles its status while being started */
+	GList *clients;
+	guint starts;
+} TestProvider;
+
+typedef struct _TestProviderClass {
+	GcMasterProviderClass parent_class;
+} TestProviderClass;
+
+GType test_provider_get_type (void);
+
+TestProvider *test_provider_new (const char           *name,
+                                 GeoclueAccuracyLevel  level,
+                                 GeoclueResourceFlags  resources,
+                                 GeoclueStatus         status);
+void test_providers_free (GList *providers);
+void test_provider_set_status (TestProvider *provider,
+                               GeoclueStatus status);
+void test_provider_set_accuracy (TestProvider        *provider,
+                                 GeoclueAccuracyLevel level);
+
+G_END_DECLS
+
+#endif